@@ -38,6 +38,19 @@
 // in any edge or face) reference a dummy halfedge and can be checked via
 // the method Vertex::isIsolated().
 //
+// Mesh also caches face and vertex normals.  A call to updateNormals()
+// computes all face normals in one pass, then all vertex normals (using the
+// selected NormalScheme) from the cached face normals in a second pass.
+// After vertices have moved, invalidateNormals() must be called before the
+// next update.  Normals are looked up via Mesh::normal():
+//
+//    mesh.updateNormals( nsAngleWeighted );
+//    for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
+//    {
+//       Vector N = mesh.normal( v );
+//       // ...
+//    }
+//
 
 #ifndef DDG_MESH_H
 #define DDG_MESH_H
@@ -75,6 +88,19 @@ namespace DDG
          bool reload( void );
          // reloads a mesh from disk using the most recent input filename
 
+         void updateNormals( NormalScheme scheme );
+         // brings the cached face and vertex normals up to date, using the
+         // given scheme for vertex normals; face normals are recomputed only
+         // if they have been invalidated, vertex normals also if the scheme
+         // has changed
+
+         void invalidateNormals( void );
+         // marks all cached normals as out of date
+
+         const Vector& normal( VertexCIter v ) const;
+         const Vector& normal( FaceCIter f ) const;
+         // return a cached unit normal (valid after a call to updateNormals())
+
          std::vector<HalfEdge> halfedges;
          std::vector<Vertex>   vertices;
          std::vector<Edge>     edges;
@@ -83,6 +109,25 @@ namespace DDG
 
       protected:
          std::string inputFilename;
+
+         void updateFaceNormal( int i );
+         void updateVertexNormal( int i );
+         // recompute the cached normal of the ith face or vertex
+
+         std::vector<Vector> faceNormals;
+         // unit normal of each face
+
+         std::vector<Vector> faceAreaVectors;
+         // normal of each face scaled by its area (up to a constant factor)
+
+         std::vector<Vector> vertexNormals;
+         // unit normal of each vertex
+
+         NormalScheme normalScheme;
+         // scheme used to compute vertexNormals
+
+         bool normalsValid;
+         // false if all normals must be recomputed
    };
 }
 
@@ -6,12 +6,18 @@
 // interacting with a Mesh object.  Viewer methods are static in order
 // to make them compatible with GLUT callbacks.
 //
+// The mesh is drawn from vertex buffer objects (see MeshBuffer.h) that are
+// only updated when the data they hold changes: geometry when the mesh is
+// loaded or processed, and normals when the normal scheme changes.
+// Switching between render modes does not upload any data.
+//
 
 #ifndef DDG_VIEWER_H
 #define DDG_VIEWER_H
 
 #include "Mesh.h"
 #include "Camera.h"
+#include "MeshBuffer.h"
 
 namespace DDG
 {
@@ -29,7 +35,8 @@ namespace DDG
          static void drawSurface( void );
          static void drawMesh( void );
          static void setMeshMaterial( void );
-         static void updateDisplayList( void );
+         static void updateGeometry( void );
+         static void updateNormals( void );
          static void drawPolygons( void );
          static void drawWireframe( void );
          static void drawIsolatedVertices( void );
@@ -97,7 +104,7 @@ namespace DDG
          // keeps track of view state
 
          // viewer data
-         static GLuint surfaceDL; // display list for mesh
+         static MeshBuffer surface; // vertex buffers for mesh
    };
 }
 
@@ -1,14 +1,49 @@
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+using namespace std;
+
+#include <SuiteSparseQR.hpp>
 #include "LinearContext.h"
 
+// thread-count setters of the common BLAS and OpenMP runtimes; they are
+// declared weak, so each is null unless that library is linked in
+extern "C"
+{
+   void openblas_set_num_threads( int n ) __attribute__(( weak ));
+   void MKL_Set_Num_Threads( int n ) __attribute__(( weak ));
+   void omp_set_num_threads( int n ) __attribute__(( weak ));
+}
+
 namespace DDG
 {
    // global context for linear solvers
    LinearContext context;
 
+   static void setThreadVariable( const char* name, int n )
+   // sets (or, if n is zero, clears) an environment variable
+   // controlling the number of threads used by a library
+   {
+      if( n > 0 )
+      {
+         stringstream value;
+         value << n;
+         setenv( name, value.str().c_str(), 1 );
+      }
+      else
+      {
+         unsetenv( name );
+      }
+   }
+
    LinearContext :: LinearContext( void )
    // constructor
    {
       cholmod_l_start( &context );
+
+      orderingMethod = orderingDefault;
+      verboseOutput = false;
    }
 
    LinearContext :: ~LinearContext( void )
@@ -22,4 +57,207 @@ namespace DDG
    {
       return &context;
    }
+
+   void LinearContext :: setOrdering( OrderingMethod ordering )
+   // sets the fill-reducing ordering used by subsequent factorizations
+   {
+      orderingMethod = ordering;
+
+      if( ordering == orderingDefault )
+      {
+         context.nmethods = 0;
+      }
+      else
+      {
+         context.nmethods = 1;
+         switch( ordering )
+         {
+            case orderingNatural:          context.method[0].ordering = CHOLMOD_NATURAL; break;
+            case orderingAMD:              context.method[0].ordering = CHOLMOD_AMD;     break;
+            case orderingMETIS:            context.method[0].ordering = CHOLMOD_METIS;   break;
+            case orderingNestedDissection: context.method[0].ordering = CHOLMOD_NESDIS;  break;
+            default: break;
+         }
+      }
+      context.postorder = true;
+   }
+
+   OrderingMethod LinearContext :: ordering( void ) const
+   // returns the current fill-reducing ordering
+   {
+      return orderingMethod;
+   }
+
+   int LinearContext :: qrOrdering( void ) const
+   // returns the current ordering as an SPQR_ORDERING_* constant
+   {
+      switch( orderingMethod )
+      {
+         case orderingNatural:          return SPQR_ORDERING_FIXED;
+         case orderingAMD:              return SPQR_ORDERING_AMD;
+         case orderingMETIS:            return SPQR_ORDERING_METIS;
+         case orderingNestedDissection: return SPQR_ORDERING_METIS;
+         default:                       return SPQR_ORDERING_DEFAULT;
+      }
+   }
+
+   void LinearContext :: setFactorization( FactorizationType type )
+   // selects supernodal, simplicial, or automatic factorization
+   {
+      switch( type )
+      {
+         case factorSimplicial: context.supernodal = CHOLMOD_SIMPLICIAL; break;
+         case factorSupernodal: context.supernodal = CHOLMOD_SUPERNODAL; break;
+         default:               context.supernodal = CHOLMOD_AUTO;       break;
+      }
+   }
+
+   void LinearContext :: setFinalLL( bool ll )
+   // if true, factors are returned in LL' form
+   {
+      context.final_ll = ll;
+   }
+
+   void LinearContext :: setThreads( int n )
+   // sets the number of threads used by BLAS/LAPACK and SPQR
+   {
+      context.SPQR_nthreads = n;
+
+      // by now the BLAS and OpenMP runtimes have usually read their
+      // environment already, so call their setters directly where we can
+      int nThreads = n > 0 ? n : (int) sysconf( _SC_NPROCESSORS_ONLN );
+      if( openblas_set_num_threads ) openblas_set_num_threads( nThreads );
+      if( MKL_Set_Num_Threads      ) MKL_Set_Num_Threads( nThreads );
+      if( omp_set_num_threads      ) omp_set_num_threads( nThreads );
+
+      // there is no standard BLAS interface for this, so also set the
+      // variables understood by the common implementations (for libraries
+      // that read them lazily, and for child processes)
+      setThreadVariable( "OMP_NUM_THREADS", n );
+      setThreadVariable( "OPENBLAS_NUM_THREADS", n );
+      setThreadVariable( "MKL_NUM_THREADS", n );
+      setThreadVariable( "VECLIB_MAXIMUM_THREADS", n );
+   }
+
+   void LinearContext :: setUseGPU( bool use )
+   // enables or disables GPU acceleration
+   {
+#ifdef CHOLMOD_VER_CODE
+#if CHOLMOD_VERSION >= CHOLMOD_VER_CODE(3,0)
+      context.useGPU = use;
+#endif
+#endif
+   }
+
+   void LinearContext :: setVerbose( bool verbose )
+   // if true, solvers print statistics after each factorization
+   {
+      verboseOutput = verbose;
+   }
+
+   bool LinearContext :: verbose( void ) const
+   // returns true if solvers should print statistics
+   {
+      return verboseOutput;
+   }
+
+   double LinearContext :: flopCount( void )
+   // returns the flop count of the most recent factorization
+   {
+      return context.fl;
+   }
+
+   double LinearContext :: factorNonzeros( void )
+   // returns the number of nonzeros in the most recent factor L
+   {
+      return context.lnz;
+   }
+
+   double LinearContext :: qrFactorNonzeros( void )
+   // returns the number of nonzeros in the most recent QR factor R
+   {
+      return context.SPQR_istat[0];
+   }
+
+   double LinearContext :: peakMemory( void )
+   // returns the peak memory usage (in bytes)
+   {
+      return (double) context.memory_usage;
+   }
+
+   void LinearContext :: printStatistics( ostream& out, const char* prefix )
+   // writes solver statistics to out
+   {
+      out << prefix << " flops: " << flopCount() << "\n";
+      out << prefix << " nnz(L): " << factorNonzeros() << "\n";
+      out << prefix << " peak memory: " << peakMemory() / (1024.*1024.) << "MB" << "\n";
+   }
+
+   void LinearContext :: printQRStatistics( ostream& out, const char* prefix )
+   // writes QR statistics to out
+   {
+      out << prefix << " nnz(R): " << qrFactorNonzeros() << "\n";
+      out << prefix << " peak memory: " << peakMemory() / (1024.*1024.) << "MB" << "\n";
+   }
+
+   int LinearContext :: parseOption( int i, int argc, char** argv )
+   // if argv[i] is a solver option, applies it and returns the
+   // number of arguments it used (zero if it is not a solver option)
+   {
+      string option( argv[i] );
+
+      // options without a value
+      if( option == "-ll"    ) { setFinalLL( true );   return 1; }
+      if( option == "-ldl"   ) { setFinalLL( false );  return 1; }
+      if( option == "-nogpu" ) { setUseGPU( false );   return 1; }
+      if( option == "-stats" ) { setVerbose( true );   return 1; }
+
+      // options with a value
+      if( option != "-ordering" &&
+          option != "-factor"   &&
+          option != "-threads" )
+      {
+         return 0;
+      }
+      if( i+1 == argc ) return -1;
+      string value( argv[i+1] );
+
+      if( option == "-ordering" )
+      {
+              if( value == "default" ) setOrdering( orderingDefault );
+         else if( value == "natural" ) setOrdering( orderingNatural );
+         else if( value == "amd"     ) setOrdering( orderingAMD );
+         else if( value == "metis"   ) setOrdering( orderingMETIS );
+         else if( value == "nesdis"  ) setOrdering( orderingNestedDissection );
+         else return -1;
+      }
+      else if( option == "-factor" )
+      {
+              if( value == "auto"       ) setFactorization( factorAutomatic );
+         else if( value == "simplicial" ) setFactorization( factorSimplicial );
+         else if( value == "supernodal" ) setFactorization( factorSupernodal );
+         else return -1;
+      }
+      else // -threads
+      {
+         int n = atoi( value.c_str() );
+         if( n < 0 ) return -1;
+         setThreads( n );
+      }
+
+      return 2;
+   }
+
+   const char* LinearContext :: usage( void )
+   // returns a description of the options accepted by parseOption()
+   {
+      return
+         "solver options:\n"
+         "   -ordering default|natural|amd|metis|nesdis   fill-reducing ordering\n"
+         "   -factor auto|simplicial|supernodal           Cholesky factor storage\n"
+         "   -ll, -ldl                                    LL' or LDL' factors\n"
+         "   -threads n                                   BLAS/LAPACK and SPQR threads\n"
+         "   -nogpu                                       disable GPU acceleration\n"
+         "   -stats                                       print factorization statistics\n";
+   }
 }
@@ -1,5 +1,6 @@
 #include <map>
 #include <fstream>
+#include <cmath>
 #include "Mesh.h"
 #include "MeshIO.h"
 
@@ -8,6 +9,8 @@ using namespace std;
 namespace DDG
 {
    Mesh :: Mesh( void )
+   : normalScheme( nsEquallyWeighted ),
+     normalsValid( false )
    {}
    
    Mesh :: Mesh( const Mesh& mesh )
@@ -31,6 +34,13 @@ namespace DDG
       map<     EdgeCIter,     EdgeIter,     EdgeCIterCompare >     edgeOldToNew;
       map<     FaceCIter,     FaceIter,     FaceCIterCompare >     faceOldToNew;
    
+      // reserve storage up front, since the iterators stored in the maps
+      // below would be invalidated if a vector were reallocated
+      halfedges.reserve( mesh.halfedges.size() );
+       vertices.reserve(  mesh.vertices.size() );
+          edges.reserve(     mesh.edges.size() );
+          faces.reserve(     mesh.faces.size() );
+
       // copy geometry from the original mesh and create a
       // map from pointers in the original mesh to
       // those in the new mesh
@@ -52,6 +62,9 @@ namespace DDG
       for( VertexIter v = vertices.begin(); v != vertices.end(); v++ ) v->he = halfedgeOldToNew[ v->he ];
       for(   EdgeIter e =    edges.begin(); e !=    edges.end(); e++ ) e->he = halfedgeOldToNew[ e->he ];
       for(   FaceIter f =    faces.begin(); f !=    faces.end(); f++ ) f->he = halfedgeOldToNew[ f->he ];
+
+      // cached normals are recomputed on demand
+      invalidateNormals();
    
       return *this;
    }
@@ -59,6 +72,7 @@ namespace DDG
    int Mesh::read( const string& filename )
    {
       inputFilename = filename;
+      invalidateNormals();
       ifstream in( filename.c_str() );
 
       if( !in.is_open() )
@@ -91,5 +105,155 @@ namespace DDG
    {
       return read( inputFilename );
    }
+
+   void Mesh::updateNormals( NormalScheme scheme )
+   // brings the cached face and vertex normals up to date
+   {
+      const int F = faces.size();
+      const int V = vertices.size();
+
+      bool rebuild = !normalsValid ||
+                     (int) faceNormals.size() != F ||
+                     (int) vertexNormals.size() != V;
+
+      // face normals come first, since vertex normals are built from them;
+      // elements are independent within each pass, so both passes run in
+      // parallel when compiled with OpenMP
+      if( rebuild )
+      {
+         faceNormals.resize( F );
+         faceAreaVectors.resize( F );
+         vertexNormals.resize( V );
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+         for( int i = 0; i < F; i++ )
+         {
+            updateFaceNormal( i );
+         }
+      }
+
+      if( rebuild || scheme != normalScheme )
+      {
+         normalScheme = scheme;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+         for( int i = 0; i < V; i++ )
+         {
+            updateVertexNormal( i );
+         }
+      }
+
+      normalsValid = true;
+   }
+
+   void Mesh::invalidateNormals( void )
+   // marks all cached normals as out of date
+   {
+      normalsValid = false;
+   }
+
+   const Vector& Mesh::normal( VertexCIter v ) const
+   // returns the cached unit normal of a vertex
+   {
+      return vertexNormals[ v - vertices.begin() ];
+   }
+
+   const Vector& Mesh::normal( FaceCIter f ) const
+   // returns the cached unit normal of a face
+   {
+      return faceNormals[ f - faces.begin() ];
+   }
+
+   void Mesh::updateFaceNormal( int i )
+   // recomputes the cached normal of the ith face
+   {
+      const Face& f( faces[i] );
+
+      faceNormals[i] = f.normal();
+
+      // same weighting as Vertex::normalAreaWeighted()
+      Vector area;
+      HalfEdgeCIter he = f.he;
+      do
+      {
+         const Vector& vec1 = he->vertex->position;
+         const Vector& vec2 = he->next->vertex->position;
+
+         area += cross( vec2+vec1, vec2-vec1 );
+
+         he = he->next;
+      }
+      while( he != f.he );
+
+      faceAreaVectors[i] = area;
+   }
+
+   void Mesh::updateVertexNormal( int i )
+   // recomputes the cached normal of the ith vertex; the schemes based on
+   // face normals mirror the corresponding methods of Vertex, but look up
+   // face normals in the cache rather than recomputing them
+   {
+      const Vertex& v( vertices[i] );
+
+      if( v.isIsolated() )
+      {
+         vertexNormals[i] = Vector( 0., 0., 0. );
+         return;
+      }
+
+      Vector N( 0., 0., 0. );
+
+      switch( normalScheme )
+      {
+         case nsEquallyWeighted:
+         case nsAreaWeighted:
+         {
+            const vector<Vector>& weighted( normalScheme == nsEquallyWeighted ? faceNormals : faceAreaVectors );
+
+            HalfEdgeCIter he = v.he;
+            do
+            {
+               N += weighted[ he->face - faces.begin() ];
+               he = he->flip->next;
+            }
+            while( he != v.he );
+
+            N = N.unit();
+            break;
+         }
+         case nsAngleWeighted:
+         {
+            const Vector& p_i = v.position;
+
+            HalfEdgeCIter he = v.he->flip;
+            Vector vec1 = ( he->vertex->position - p_i ).unit();
+            FaceCIter face = he->face;
+            HalfEdgeCIter heBegin = he = he->next->flip;
+            do
+            {
+               Vector vec2 = ( he->vertex->position - p_i ).unit();
+               N += faceNormals[ face - faces.begin() ] * atan2( cross(vec1,vec2).norm(), -dot(vec1,vec2) );
+               vec1 = vec2;
+               face = he->face;
+
+               he = he->next->flip;
+            }
+            while( he != heBegin );
+
+            N = N.unit();
+            break;
+         }
+         default:
+            // the remaining schemes do not use face normals
+            N = v.normal( normalScheme );
+            break;
+      }
+
+      vertexNormals[i] = N;
+   }
 }
 
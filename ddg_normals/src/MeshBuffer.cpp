@@ -0,0 +1,159 @@
+#include "MeshBuffer.h"
+
+namespace DDG
+{
+   MeshBuffer :: MeshBuffer( void )
+   {
+      for( int i = 0; i < nStreams; i++ )
+      {
+         streamBuffer[i] = 0;
+         streamSize[i] = 0;
+         streamComponents[i] = 0;
+      }
+
+      for( int i = 0; i < nPrimitives; i++ )
+      {
+         indexBuffer[i] = 0;
+         indexCount[i] = 0;
+      }
+   }
+
+   void MeshBuffer :: clear( void )
+   // releases all buffer objects
+   {
+      for( int i = 0; i < nStreams; i++ )
+      {
+         if( streamBuffer[i] ) glDeleteBuffers( 1, &streamBuffer[i] );
+         streamBuffer[i] = 0;
+         streamSize[i] = 0;
+         streamComponents[i] = 0;
+      }
+
+      for( int i = 0; i < nPrimitives; i++ )
+      {
+         if( indexBuffer[i] ) glDeleteBuffers( 1, &indexBuffer[i] );
+         indexBuffer[i] = 0;
+         indexCount[i] = 0;
+      }
+   }
+
+   void MeshBuffer :: setStream( Stream s, const std::vector<GLfloat>& data, int nComponents )
+   // replaces the contents of a stream
+   {
+      int n = data.size() / nComponents;
+      GLsizeiptr bytes = n * nComponents * sizeof( GLfloat );
+
+      if( streamBuffer[s] == 0 ) glGenBuffers( 1, &streamBuffer[s] );
+      glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[s] );
+
+      // reuse the existing storage if the size is unchanged
+      if( n == streamSize[s] && nComponents == streamComponents[s] )
+      {
+         if( bytes > 0 ) glBufferSubData( GL_ARRAY_BUFFER, 0, bytes, &data[0] );
+      }
+      else
+      {
+         glBufferData( GL_ARRAY_BUFFER, bytes, bytes > 0 ? &data[0] : NULL, GL_STATIC_DRAW );
+      }
+
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+      streamSize[s] = n;
+      streamComponents[s] = nComponents;
+   }
+
+   void MeshBuffer :: updateStream( Stream s, int first, int count, const GLfloat* data )
+   // overwrites the values of vertices first, ..., first+count-1
+   {
+      if( streamBuffer[s] == 0 || count <= 0 || first < 0 || first+count > streamSize[s] )
+      {
+         return;
+      }
+
+      GLintptr offset = first * streamComponents[s] * sizeof( GLfloat );
+      GLsizeiptr bytes = count * streamComponents[s] * sizeof( GLfloat );
+
+      glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[s] );
+      glBufferSubData( GL_ARRAY_BUFFER, offset, bytes, data );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+   bool MeshBuffer :: hasStream( Stream s ) const
+   // returns true if data has been uploaded to the given stream
+   {
+      return streamBuffer[s] != 0 && streamSize[s] > 0;
+   }
+
+   int MeshBuffer :: size( Stream s ) const
+   // returns the number of vertices in the given stream
+   {
+      return streamSize[s];
+   }
+
+   void MeshBuffer :: setIndices( Primitive p, const std::vector<GLuint>& indices )
+   // replaces the vertex indices used to draw the given primitive type
+   {
+      GLsizeiptr bytes = indices.size() * sizeof( GLuint );
+
+      if( indexBuffer[p] == 0 ) glGenBuffers( 1, &indexBuffer[p] );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer[p] );
+
+      if( (int) indices.size() == indexCount[p] )
+      {
+         if( bytes > 0 ) glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, bytes, &indices[0] );
+      }
+      else
+      {
+         glBufferData( GL_ELEMENT_ARRAY_BUFFER, bytes, bytes > 0 ? &indices[0] : NULL, GL_STATIC_DRAW );
+      }
+
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+      indexCount[p] = indices.size();
+   }
+
+   int MeshBuffer :: size( Primitive p ) const
+   // returns the number of indices for the given primitive type
+   {
+      return indexCount[p];
+   }
+
+   void MeshBuffer :: draw( Primitive p, Stream positions, bool useNormals, bool useColors ) const
+   // draws all primitives of the given type
+   {
+      if( indexCount[p] == 0 || !hasStream( positions ))
+      {
+         return;
+      }
+
+      glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT );
+
+      glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[positions] );
+      glEnableClientState( GL_VERTEX_ARRAY );
+      glVertexPointer( streamComponents[positions], GL_FLOAT, 0, NULL );
+
+      if( useNormals && hasStream( normalStream ))
+      {
+         glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[normalStream] );
+         glEnableClientState( GL_NORMAL_ARRAY );
+         glNormalPointer( GL_FLOAT, 0, NULL );
+      }
+
+      if( useColors && hasStream( colorStream ))
+      {
+         glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[colorStream] );
+         glEnableClientState( GL_COLOR_ARRAY );
+         glColorPointer( streamComponents[colorStream], GL_FLOAT, 0, NULL );
+      }
+
+      const GLenum mode[ nPrimitives ] = { GL_TRIANGLES, GL_LINES, GL_POINTS };
+
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer[p] );
+      glDrawElements( mode[p], indexCount[p], GL_UNSIGNED_INT, NULL );
+
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+      glPopClientAttrib();
+   }
+}
@@ -5,7 +5,6 @@ using namespace std;
 #include "Vertex.h"
 #include "Mesh.h"
 #include "HalfEdge.h"
-#include "CyclicArray.h"
 
 namespace DDG
 {
@@ -92,37 +91,26 @@ namespace DDG
 
       const Vector& p_i = this->position;
       HalfEdgeIter heBegin, he;
-      int vertexDeg = 0;
-      int j;
 
-      // count vertex degree
-      he = heBegin = this->he;
-      do {
-         vertexDeg++;
-         he = he->flip->next;
-      }
-      while( he != heBegin );
-
-      // get vectors from p_i to adjacent p_j's
-      CyclicArray<Vector> p_j(vertexDeg);
+      // compute gradient of area using cot formula; each pair of consecutive
+      // neighbors p_j, p_k contributes the cotangents of the two angles
+      // opposite p_i in triangle (p_i,p_j,p_k), so the one-ring is visited
+      // in a single sweep without storing the neighbors
       he = heBegin = this->he->flip;
-      j = 0;
+      Vector p_j = he->vertex->position - p_i;
       do {
-         p_j[j] = he->vertex->position - p_i;
          he = he->next->flip;
-         j++;
-      }
-      while( he != heBegin );
+         Vector p_k = he->vertex->position - p_i;
 
-      // compute gradient of area using cot formula
-      for ( j = 0; j < vertexDeg; j++ ) {
-         double cot_a = \
-            dot( p_j[j-1]-p_j[j], p_j[j-1] ) / cross( p_j[j], p_j[j-1] ).norm();
-         double cot_b = \
-            dot( p_j[j+1]-p_j[j], p_j[j+1] ) / cross( p_j[j], p_j[j+1] ).norm();
+         double s = cross( p_j, p_k ).norm();
+         double cot_j = dot( p_j-p_k, p_j ) / s; // angle at p_j
+         double cot_k = dot( p_k-p_j, p_k ) / s; // angle at p_k
 
-         N -= (cot_a + cot_b) * p_j[j];
+         N -= cot_k * p_j + cot_j * p_k;
+
+         p_j = p_k;
       }
+      while( he != heBegin );
 
       return N.unit();
    }
@@ -12,7 +12,7 @@ namespace DDG
    // declare static member variables
    Mesh Viewer::mesh;
    Viewer::RenderMode Viewer::mode = renderShaded;
-   GLuint Viewer::surfaceDL = 0;
+   MeshBuffer Viewer::surface;
    int Viewer::windowSize[2] = { 512, 512 };
    Camera Viewer::camera;
    NormalScheme Viewer::scheme;
@@ -23,7 +23,7 @@ namespace DDG
       initGLUT();
       initGL();
    
-      updateDisplayList();
+      updateGeometry();
    
       glutMainLoop();
    }
@@ -156,13 +156,14 @@ namespace DDG
    {
       // TODO process geometry here!
 
-      updateDisplayList();
+      mesh.invalidateNormals();
+      updateGeometry();
    }
    
    void Viewer :: mResetMesh( void )
    {
       mesh.reload();
-      updateDisplayList();
+      updateGeometry();
    }
    
    void Viewer :: mWriteMesh( void )
@@ -179,13 +180,11 @@ namespace DDG
    void Viewer :: mSmoothShaded( void )
    {
       mode = renderShaded;
-      updateDisplayList();
    }
    
    void Viewer :: mWireframe( void )
    {
       mode = renderWireframe;
-      updateDisplayList();
    }
 
    void Viewer :: mZoomIn( void )
@@ -201,31 +200,31 @@ namespace DDG
    void Viewer :: mEquallyWeighted( void )
    {
       scheme = nsEquallyWeighted;
-      updateDisplayList();
+      updateNormals();
    }
    
    void Viewer :: mAreaWeighted( void )
    {
       scheme = nsAreaWeighted;
-      updateDisplayList();
+      updateNormals();
    }
    
    void Viewer :: mAngleWeighted( void )
    {
       scheme = nsAngleWeighted;
-      updateDisplayList();
+      updateNormals();
    }
    
    void Viewer :: mMeanCurvature( void )
    {
       scheme = nsMeanCurvature;
-      updateDisplayList();
+      updateNormals();
    }
    
    void Viewer :: mSphereInscribed( void )
    {
       scheme = nsSphereInscribed;
-      updateDisplayList();
+      updateNormals();
    }
    
    void Viewer :: keyboard( unsigned char c, int x, int y )
@@ -341,7 +340,8 @@ namespace DDG
       glEnable( GL_DEPTH_TEST );
       glEnable( GL_LIGHTING );
    
-      glCallList( surfaceDL );
+      setMeshMaterial();
+      drawMesh();
    
       glPopAttrib();
    }
@@ -369,35 +369,7 @@ namespace DDG
 
    void Viewer :: drawPolygons( void )
    {
-      for( FaceCIter f  = mesh.faces.begin();
-                     f != mesh.faces.end();
-                     f ++ )
-      {
-         if( f->isBoundary() ) continue;
-
-         glBegin( GL_POLYGON );
-         if( mode == renderWireframe )
-         {
-            Vector N = f->normal();
-            glNormal3dv( &N[0] );
-         }
-
-         HalfEdgeCIter he = f->he;
-         do
-         {
-            if( mode != renderWireframe )
-            {
-               Vector N = he->vertex->normal( scheme );
-               glNormal3dv( &N[0] );
-            }
-
-            glVertex3dv( &he->vertex->position[0] );
-
-            he = he->next;
-         }
-         while( he != f->he );
-         glEnd();
-      }
+      surface.draw( MeshBuffer::triangles );
    }
 
    void Viewer :: drawWireframe( void )
@@ -409,15 +381,7 @@ namespace DDG
       glEnable( GL_BLEND );
       glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 
-      glBegin( GL_LINES );
-      for( EdgeCIter e  = mesh.edges.begin();
-            e != mesh.edges.end();
-            e ++ )
-      {
-         glVertex3dv( &e->he->vertex->position[0] );
-         glVertex3dv( &e->he->flip->vertex->position[0] );
-      }
-      glEnd();
+      surface.draw( MeshBuffer::lines, MeshBuffer::positionStream, false, false );
 
       glPopAttrib();
    }
@@ -434,36 +398,82 @@ namespace DDG
       glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
       glColor4f( 1., 0., 0., 1. ); // red
 
-      glBegin( GL_POINTS );
-      for( VertexCIter v  = mesh.vertices.begin();
-                       v != mesh.vertices.end();
-                       v ++ )
+      surface.draw( MeshBuffer::points, MeshBuffer::positionStream, false, false );
+
+      glPopAttrib();
+   }
+   
+   void Viewer :: updateGeometry( void )
+   {
+      const int V = mesh.vertices.size();
+      VertexCIter v0 = mesh.vertices.begin();
+
+      vector<GLfloat> positions( 3*V );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
       {
-         if( v->isIsolated() )
+         for( int k = 0; k < 3; k++ )
          {
-            glVertex3dv( &v->position[0] );
+            positions[ 3*(v-v0)+k ] = v->position[k];
          }
       }
-      glEnd();
 
-      glPopAttrib();
+      vector<GLuint> triangles;
+      triangles.reserve( 3*mesh.faces.size() );
+      for( FaceCIter f = mesh.faces.begin(); f != mesh.faces.end(); f++ )
+      {
+         if( f->isBoundary() ) continue;
+
+         // split polygons into triangle fans around the first vertex
+         HalfEdgeCIter he = f->he->next;
+         while( he->next != f->he )
+         {
+            triangles.push_back( f->he->vertex - v0 );
+            triangles.push_back( he->vertex - v0 );
+            triangles.push_back( he->next->vertex - v0 );
+            he = he->next;
+         }
+      }
+
+      vector<GLuint> lines;
+      lines.reserve( 2*mesh.edges.size() );
+      for( EdgeCIter e = mesh.edges.begin(); e != mesh.edges.end(); e++ )
+      {
+         lines.push_back( e->he->vertex - v0 );
+         lines.push_back( e->he->flip->vertex - v0 );
+      }
+
+      vector<GLuint> points;
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
+      {
+         if( v->isIsolated() ) points.push_back( v - v0 );
+      }
+
+      surface.setStream( MeshBuffer::positionStream, positions, 3 );
+      surface.setIndices( MeshBuffer::triangles, triangles );
+      surface.setIndices( MeshBuffer::lines, lines );
+      surface.setIndices( MeshBuffer::points, points );
+
+      updateNormals();
    }
-   
-   void Viewer :: updateDisplayList( void )
+
+   void Viewer :: updateNormals( void )
    {
-      if( surfaceDL )
+      const int V = mesh.vertices.size();
+      VertexCIter v0 = mesh.vertices.begin();
+
+      mesh.updateNormals( scheme );
+
+      vector<GLfloat> normals( 3*V, 0. );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
       {
-         glDeleteLists( surfaceDL, 1 );
-         surfaceDL = 0;
+         const Vector& N = mesh.normal( v );
+         for( int k = 0; k < 3; k++ )
+         {
+            normals[ 3*(v-v0)+k ] = N[k];
+         }
       }
-   
-      surfaceDL = glGenLists( 1 );
-   
-      setMeshMaterial();
-   
-      glNewList( surfaceDL, GL_COMPILE );
-      drawMesh();
-      glEndList();
+
+      surface.setStream( MeshBuffer::normalStream, normals, 3 );
    }
    
    void Viewer :: mouse( int button, int state, int x, int y )
@@ -3,18 +3,33 @@
 using namespace std;
 
 #include "Viewer.h"
+#include "LinearContext.h"
 using namespace DDG;
 
+namespace DDG
+{
+   extern LinearContext context;
+}
+
 int main( int argc, char** argv )
 {
-   if( argc != 2 )
+   int k = 1;
+   while( k < argc-1 )
+   {
+      int n = context.parseOption( k, argc, argv );
+      if( n <= 0 ) break;
+      k += n;
+   }
+
+   if( k != argc-1 )
    {
-      cerr << "usage: " << argv[0] << " in.obj" << endl;
+      cerr << "usage: " << argv[0] << " [solver options] in.obj" << endl;
+      cerr << LinearContext::usage();
       return 1;
    }
 
    Viewer viewer;
-   viewer.mesh.read( argv[1] );
+   viewer.mesh.read( argv[k] );
    viewer.init();
 
    return 0;
@@ -8,15 +8,44 @@
 // is shared by all instances of DenseMatrix, SparseMatrix, and LinearSystem.
 // In other words, you shouldn't have to instantiate LinearContext yourself
 // unless you're doing something really fancy!
+//
+// Solver settings (fill-reducing ordering, supernodal vs. simplicial
+// factorization, etc.) can be changed through the typed interface below;
+// statistics (flop count, nnz(L) or nnz(R), peak memory) always refer to the
+// most recent factorization.  The same settings can be given on the command
+// line, e.g.,
+//
+//    ddg -ordering metis -threads 4 -stats in.obj
+//
+// (see LinearContext::parseOption() and LinearContext::usage()).
 // 
 
 #ifndef DDG_LINEARSOLVERCONTEXT
 #define DDG_LINEARSOLVERCONTEXT
 
 #include <cholmod.h>
+#include <iostream>
 
 namespace DDG
 {
+   enum OrderingMethod
+   // fill-reducing orderings
+   {
+      orderingDefault,         // let the library choose (AMD, then METIS if fill is high)
+      orderingNatural,         // no reordering
+      orderingAMD,             // approximate minimum degree
+      orderingMETIS,           // METIS nested dissection
+      orderingNestedDissection // CHOLMOD nested dissection (METIS + constrained minimum degree)
+   };
+
+   enum FactorizationType
+   // storage for Cholesky factors
+   {
+      factorAutomatic,  // choose based on the flop count per nonzero
+      factorSimplicial, // column-by-column (good for very sparse factors)
+      factorSupernodal  // dense supernodal blocks (BLAS-3)
+   };
+
    class LinearContext
    {
       public:
@@ -29,8 +58,72 @@ namespace DDG
          operator cholmod_common*( void );
          // allows LinearContext to be treated as a cholmod_common*
 
+         void setOrdering( OrderingMethod ordering );
+         // sets the fill-reducing ordering used by subsequent factorizations
+
+         OrderingMethod ordering( void ) const;
+         // returns the current fill-reducing ordering
+
+         int qrOrdering( void ) const;
+         // returns the current ordering as an SPQR_ORDERING_* constant
+         // (SPQR has no nested dissection of its own; METIS is used instead)
+
+         void setFactorization( FactorizationType type );
+         // selects supernodal, simplicial, or automatic factorization
+
+         void setFinalLL( bool ll );
+         // if true, factors are returned in LL' form; otherwise simplicial
+         // factors are returned in LDL' form
+
+         void setThreads( int n );
+         // sets the number of threads used by BLAS/LAPACK and SPQR (zero
+         // means one per processor); OpenBLAS, MKL, and OpenMP are updated
+         // immediately (OpenMP only for the calling thread), while other BLAS
+         // implementations may read their thread count only once, so this
+         // should be called before the first solve
+
+         void setUseGPU( bool use );
+         // enables or disables GPU acceleration (if CHOLMOD was built with it)
+
+         void setVerbose( bool verbose );
+         // if true, solvers print statistics after each factorization
+
+         bool verbose( void ) const;
+         // returns true if solvers should print statistics
+
+         double flopCount( void );
+         // returns the flop count of the most recent factorization
+
+         double factorNonzeros( void );
+         // returns the number of nonzeros in the most recent factor L
+
+         double qrFactorNonzeros( void );
+         // returns the number of nonzeros in the most recent QR factor R
+
+         double peakMemory( void );
+         // returns the peak memory usage (in bytes)
+
+         void printStatistics( std::ostream& out, const char* prefix );
+         // writes the statistics above to out, one per line, each
+         // preceded by prefix (e.g., "[chol]")
+
+         void printQRStatistics( std::ostream& out, const char* prefix );
+         // same as printStatistics(), but for the most recent QR factorization
+
+         int parseOption( int i, int argc, char** argv );
+         // if argv[i] is a solver option, applies it and returns the number
+         // of arguments it used; returns zero if argv[i] is not a solver
+         // option, or -1 if its value is missing or invalid
+
+         static const char* usage( void );
+         // returns a description of the options accepted by parseOption()
+
       protected:
          cholmod_common context;
+
+         OrderingMethod orderingMethod;
+         bool verboseOutput;
+         // settings not stored in cholmod_common
    };
 }
 
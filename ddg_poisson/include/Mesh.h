@@ -38,6 +38,13 @@
 // in any edge or face) reference a dummy halfedge and can be checked via
 // the method Vertex::isIsolated().
 //
+// Cotangents, face areas and normals, and dual vertex areas are computed for
+// the whole mesh in a single pass and stored in flat arrays, since building
+// the Laplacian and the flow operator needs each of them several times per
+// element.  Code that moves vertices must call invalidateGeometry(), which
+// increments geometryVersion(); the cache is rebuilt the next time any of
+// these quantities is requested.
+//
 
 #ifndef DDG_MESH_H
 #define DDG_MESH_H
@@ -96,6 +103,28 @@ namespace DDG
          void computeImplicitMeanCurvatureFlow( double h );
          // integrate mean curvature flow for time t using a single implicit step
 
+         void invalidateGeometry( void );
+         // must be called whenever vertex positions change; marks all cached
+         // geometric quantities as out of date
+
+         unsigned long geometryVersion( void ) const;
+         // returns a counter that is incremented by every call to
+         // invalidateGeometry()
+
+         void updateGeometry( void ) const;
+         // recomputes the cached quantities if they are out of date (the
+         // accessors below call this automatically)
+
+         double cotan( HalfEdgeCIter h ) const;
+         // returns the cached value of h->cotan()
+
+         double area( FaceCIter f ) const;
+         Vector normal( FaceCIter f ) const;
+         // return the cached values of f->area() and f->normal()
+
+         double dualArea( VertexCIter v ) const;
+         // returns the cached value of v->dualArea()
+
          std::vector<HalfEdge> halfedges;
          std::vector<Vertex>   vertices;
          std::vector<Edge>     edges;
@@ -110,6 +139,37 @@ namespace DDG
 
       protected:
          std::string inputFilename;
+
+         void updateCorners( void ) const;
+         // records which vertices each cached quantity depends on
+
+         unsigned long version;
+         mutable unsigned long cacheVersion;
+         // current geometry version and version of the cached quantities
+
+         mutable bool cornersValid;
+         // false if the connectivity arrays below must be rebuilt
+
+         mutable std::vector<int> halfedgeCorners;
+         // for each halfedge, the vertex opposite to it followed by the two
+         // vertices used to measure the opposite angle
+
+         mutable std::vector<int> faceStart;
+         mutable std::vector<int> faceCorners;
+         // vertices of each face, in compressed-row format
+
+         mutable std::vector<int> vertexFaceStart;
+         mutable std::vector<int> vertexFaces;
+         // faces containing each vertex, in compressed-row format
+
+         mutable std::vector<double> px, py, pz;
+         // vertex coordinates
+
+         mutable std::vector<double> cotans;
+         mutable std::vector<double> faceAreas;
+         mutable std::vector<Vector> faceNormals;
+         mutable std::vector<double> dualAreas;
+         // cached quantities, indexed by position in the element vectors
    };
 }
 
@@ -0,0 +1,113 @@
+// -----------------------------------------------------------------------------
+// libDDG -- MeshBuffer.h
+// -----------------------------------------------------------------------------
+//
+// MeshBuffer keeps a copy of a mesh in OpenGL vertex buffer objects, so that
+// the mesh can be redrawn every frame without resending any data to the GPU.
+// Each vertex attribute is stored in its own buffer (a "stream") holding one
+// value per mesh vertex, in the same order as Mesh::vertices, and every type
+// of primitive has its own index buffer into these shared streams.  Typical
+// usage is
+//
+//    MeshBuffer buffer;
+//    buffer.setStream( MeshBuffer::positionStream, positions, 3 );
+//    buffer.setStream( MeshBuffer::normalStream, normals, 3 );
+//    buffer.setIndices( MeshBuffer::triangles, triangleIndices );
+//
+// when the mesh is loaded, and
+//
+//    buffer.draw( MeshBuffer::triangles );
+//
+// in the display callback.  Since streams are independent, a change in (say)
+// vertex colors only requires the color stream to be uploaded again, and a
+// change to a few vertices can be uploaded via updateStream().
+//
+// Buffer objects are only released by clear(), which (like every other
+// method) must be called while the OpenGL context is current; buffers still
+// allocated at exit are freed along with the context.
+//
+
+#ifndef DDG_MESHBUFFER_H
+#define DDG_MESHBUFFER_H
+
+#ifdef __CYGWIN__
+#define GLUT_DISABLE_ATEXIT_HACK
+#define GL_GLEXT_PROTOTYPES
+#include <windows.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glut.h>
+#else
+#include <GLUT/glut.h>
+#endif
+#include <vector>
+
+namespace DDG
+{
+   class MeshBuffer
+   {
+      public:
+         enum Stream
+         {
+            positionStream, // vertex positions
+            normalStream,   // vertex normals
+            colorStream,    // vertex colors
+            textureStream,  // vertex positions in texture space
+            nStreams
+         };
+
+         enum Primitive
+         {
+            triangles,      // faces (polygons are split into triangle fans)
+            lines,          // edges
+            points,         // individual vertices
+            nPrimitives
+         };
+
+         MeshBuffer( void );
+         // constructs an empty buffer (no OpenGL objects are created until
+         // data is first uploaded)
+
+         void clear( void );
+         // releases all buffer objects
+
+         void setStream( Stream s, const std::vector<GLfloat>& data, int nComponents );
+         // replaces the contents of a stream, where data holds nComponents
+         // values for each vertex
+
+         void updateStream( Stream s, int first, int count, const GLfloat* data );
+         // overwrites the values of vertices first, ..., first+count-1 in an
+         // existing stream, leaving all other vertices untouched
+
+         bool hasStream( Stream s ) const;
+         // returns true if data has been uploaded to the given stream
+
+         int size( Stream s ) const;
+         // returns the number of vertices in the given stream
+
+         void setIndices( Primitive p, const std::vector<GLuint>& indices );
+         // replaces the vertex indices used to draw the given primitive type
+
+         int size( Primitive p ) const;
+         // returns the number of indices for the given primitive type
+
+         void draw( Primitive p, Stream positions = positionStream,
+                    bool useNormals = true, bool useColors = true ) const;
+         // draws all primitives of the given type, taking vertex coordinates
+         // from the specified stream; normals and colors are taken from the
+         // corresponding streams if requested and available (otherwise the
+         // current normal and color are used)
+
+      protected:
+         GLuint streamBuffer[ nStreams ];
+         int streamSize[ nStreams ];
+         int streamComponents[ nStreams ];
+         // buffer object, number of vertices, and values per vertex for each stream
+
+         GLuint indexBuffer[ nPrimitives ];
+         int indexCount[ nPrimitives ];
+         // buffer object and number of indices for each primitive type
+   };
+}
+
+#endif
@@ -0,0 +1,134 @@
+// -----------------------------------------------------------------------------
+// libDDG -- SolverQueue.h
+// -----------------------------------------------------------------------------
+//
+// SolverQueue runs long computations (typically sparse factorizations and
+// solves) on a small pool of worker threads, so that the GLUT event loop --
+// and hence the camera, menus, and redraws -- stays responsive while a solve
+// is in progress.  Work is described by subclassing SolverTask:
+//
+//    class MyTask : public SolverTask
+//    {
+//       public:
+//          virtual void run( void );    // executed on a worker thread
+//          virtual void finish( void ); // executed on the main thread
+//    };
+//
+// run() should only touch data owned by the task (e.g., a private copy of
+// the mesh), which acts as a back buffer for the results.  Once run() has
+// returned, the next call to SolverQueue::poll() (normally made from the
+// GLUT idle callback) calls finish(), which is the place to copy the
+// results into the mesh being displayed.  A task can report its progress
+// via setProgress(), and should check cancelled() between stages and
+// return early if it is true; cancelled tasks are deleted without calling
+// finish().  Note that cancellation is cooperative: a factorization that
+// is already running inside SuiteSparse cannot be interrupted, so a task
+// stops at the end of its current stage.
+//
+
+#ifndef DDG_SOLVERQUEUE_H
+#define DDG_SOLVERQUEUE_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <list>
+
+namespace DDG
+{
+   class SolverTask
+   {
+      public:
+         SolverTask( void );
+         virtual ~SolverTask( void );
+
+         virtual void run( void ) = 0;
+         // performs the computation (called on a worker thread)
+
+         virtual void finish( void ) = 0;
+         // publishes the results (called on the thread that polls the queue)
+
+         void cancel( void );
+         // requests that the task stop as soon as possible
+
+         bool cancelled( void ) const;
+         // returns true if cancel() has been called
+
+         void setProgress( double fraction, const std::string& stage );
+         // reports the fraction of work done (between 0 and 1) and a short
+         // description of the current stage
+
+         double progress( void ) const;
+         std::string stage( void ) const;
+         // return the most recently reported progress
+
+      protected:
+         SolverTask( const SolverTask& task );
+         const SolverTask& operator=( const SolverTask& task );
+         // tasks cannot be copied
+
+         mutable pthread_mutex_t mutex;
+         // guards the members below
+
+         bool cancelFlag;
+         double fraction;
+         std::string stageName;
+   };
+
+   class SolverQueue
+   {
+      public:
+         SolverQueue( int nThreads = 1 );
+         // constructs a queue served by the given number of worker threads
+         // (threads are not started until the first task is submitted)
+
+         ~SolverQueue( void );
+         // cancels all outstanding tasks and waits for the workers to exit
+
+         void submit( SolverTask* task );
+         // appends a task to the queue; the queue takes ownership of the task
+
+         int poll( void );
+         // calls finish() on (and deletes) every task that has completed
+         // since the last call; returns the number of tasks finished
+
+         bool busy( void ) const;
+         // returns true if any task is waiting, running, or not yet finished
+
+         bool status( double& fraction, std::string& stage ) const;
+         // gets the progress of the oldest running (or waiting) task;
+         // returns false if the queue is idle
+
+         void cancelAll( void );
+         // cancels every task that has not yet been finished
+
+         void shutdown( void );
+         // cancels all tasks and joins the worker threads (should be called
+         // before exit() so that workers do not outlive other static data)
+
+      protected:
+         SolverQueue( const SolverQueue& queue );
+         const SolverQueue& operator=( const SolverQueue& queue );
+         // queues cannot be copied
+
+         void start( void );
+         // launches the worker threads
+
+         static void* work( void* queue );
+         void workLoop( void );
+         // worker thread entry point and main loop
+
+         int nThreads;
+         std::vector<pthread_t> threads;
+
+         std::list<SolverTask*> pending;   // tasks waiting for a worker
+         std::list<SolverTask*> running;   // tasks currently being run
+         std::list<SolverTask*> completed; // tasks waiting for finish()
+
+         mutable pthread_mutex_t mutex;
+         pthread_cond_t available;
+         bool stopping;
+   };
+}
+
+#endif
@@ -6,6 +6,17 @@
 // interacting with a Mesh object.  Viewer methods are static in order
 // to make them compatible with GLUT callbacks.
 //
+// Computing the potential or the flow does not block the GUI: the solve
+// runs on a worker thread (see SolverQueue.h) using a private copy of the
+// mesh, and its results are copied into Viewer::mesh -- and the display list
+// rebuilt -- only once the solve has completed.  Progress is shown in the
+// window title, and a running solve can be cancelled from the menu.
+//
+// The mesh is drawn from vertex buffer objects (see MeshBuffer.h) that are
+// only updated when the data they hold changes: geometry when the mesh is
+// loaded or flowed, and colors when the density or potential is displayed.
+// Switching between render modes otherwise does not upload any data.
+//
 
 #ifndef DDG_VIEWER_H
 #define DDG_VIEWER_H
@@ -13,6 +24,8 @@
 #include <GLUT/glut.h>
 #include "Mesh.h"
 #include "Camera.h"
+#include "SolverQueue.h"
+#include "MeshBuffer.h"
 
 namespace DDG
 {
@@ -30,7 +43,10 @@ namespace DDG
          static void drawSurface( void );
          static void drawMesh( void );
          static void setMeshMaterial( void );
-         static void updateDisplayList( void );
+         static void updateBuffers( void );
+         static void updateGeometry( void );
+         static void updateNormals( void );
+         static void updateColors( void );
          static void drawPolygons( void );
          static void drawWireframe( void );
          static void drawIsolatedVertices( void );
@@ -48,6 +64,7 @@ namespace DDG
          // menu functions
          static void mComputePotential( void );
          static void mComputeFlow( void );
+         static void mCancel( void );
          static void mResetMesh( void );
          static void mWriteMesh( void );
          static void mExit( void );
@@ -65,6 +82,7 @@ namespace DDG
          {
             menuComputePotential,
             menuComputeFlow,
+            menuCancel,
             menuResetMesh,
             menuWriteMesh,
             menuExit,
@@ -88,6 +106,9 @@ namespace DDG
 
          static RenderMode mode;  // current render mode
 
+         static void updateWindowTitle( void );
+         // shows the progress of the current solve (if any) in the title bar
+
          static void storeViewerState( void );
          static void restoreViewerState( void );
          static int windowSize[2];
@@ -96,7 +117,21 @@ namespace DDG
          // keeps track of view state
 
          // viewer data
-         static GLuint surfaceDL; // display list for mesh
+         static MeshBuffer surface; // vertex buffers for mesh
+
+         static SolverQueue solver;
+         // runs solves in the background (a single worker, since the
+         // LinearContext shared by all solves is not thread safe)
+
+         static int meshRevision;
+         // incremented whenever the mesh is reset, so that results computed
+         // from an outdated copy of the mesh can be detected
+
+         static std::string windowTitle;
+         // current contents of the title bar
+
+         friend class PotentialTask;
+         friend class FlowTask;
 
          void updatePotential( void );
          // update the scalar potential determined by the density on vertices
@@ -1,5 +1,6 @@
 #include <map>
 #include <fstream>
+#include <cmath>
 #include "Mesh.h"
 #include "MeshIO.h"
 #include "DenseMatrix.h"
@@ -30,7 +31,7 @@ namespace DDG
       // loop through all half-edges
       for ( std::vector<HalfEdge>::const_iterator it = halfedges.begin(); \
          it != halfedges.end(); it++ ) {
-         double half_cot = it->cotan() / 2.;
+         double half_cot = cotan( it ) / 2.;
          int i = it->vertex->index;
          int j = it->next->vertex->index;
          L(i,i) -= half_cot;
@@ -88,14 +89,16 @@ namespace DDG
       // loop through all half-edges to add (-h)L
       for ( std::vector<HalfEdge>::const_iterator it = halfedges.begin(); \
          it != halfedges.end(); it++ ) {
-         double half_cot = it->cotan() / 2.;
+         double half_cot = cotan( it ) / 2.;
          int i = it->vertex->index;
          int j = it->next->vertex->index;
          // 1 / dualArea() converts 2-forms to 0-forms
-         A(i,i) -= (-h) * half_cot / vertices[i].dualArea();
-         A(j,j) -= (-h) * half_cot / vertices[j].dualArea();
-         A(i,j) += (-h) * half_cot / vertices[i].dualArea();
-         A(j,i) += (-h) * half_cot / vertices[j].dualArea();
+         double Ai = dualArea( it->vertex );
+         double Aj = dualArea( it->next->vertex );
+         A(i,i) -= (-h) * half_cot / Ai;
+         A(j,j) -= (-h) * half_cot / Aj;
+         A(i,j) += (-h) * half_cot / Ai;
+         A(j,i) += (-h) * half_cot / Aj;
       }
    }
 
@@ -124,12 +127,20 @@ namespace DDG
          it->position[1] = f_h(it->index,1);
          it->position[2] = f_h(it->index,2);
       }
+
+      invalidateGeometry();
    }
 
    Mesh :: Mesh( void )
+   : version( 1 ),
+     cacheVersion( 0 ),
+     cornersValid( false )
    {}
    
    Mesh :: Mesh( const Mesh& mesh )
+   : version( 1 ),
+     cacheVersion( 0 ),
+     cornersValid( false )
    {
       *this = mesh;
    }
@@ -150,6 +161,13 @@ namespace DDG
       map<     EdgeCIter,     EdgeIter,     EdgeCIterCompare >     edgeOldToNew;
       map<     FaceCIter,     FaceIter,     FaceCIterCompare >     faceOldToNew;
    
+      // reserve storage up front, since the iterators stored in the maps
+      // below would be invalidated if a vector were reallocated
+      halfedges.reserve( mesh.halfedges.size() );
+       vertices.reserve(  mesh.vertices.size() );
+          edges.reserve(     mesh.edges.size() );
+          faces.reserve(     mesh.faces.size() );
+
       // copy geometry from the original mesh and create a
       // map from pointers in the original mesh to
       // those in the new mesh
@@ -168,9 +186,16 @@ namespace DDG
          he->face   =     faceOldToNew[ he->face   ];
       }
    
-      for( VertexIter v = vertices.begin(); v != vertices.end(); v++ ) v->he = halfedgeOldToNew[ v->he ];
+      // (isolated vertices keep pointing to the shared dummy halfedge)
+      for( VertexIter v = vertices.begin(); v != vertices.end(); v++ ) if( !v->isIsolated() ) v->he = halfedgeOldToNew[ v->he ];
       for(   EdgeIter e =    edges.begin(); e !=    edges.end(); e++ ) e->he = halfedgeOldToNew[ e->he ];
       for(   FaceIter f =    faces.begin(); f !=    faces.end(); f++ ) f->he = halfedgeOldToNew[ f->he ];
+
+      inputFilename = mesh.inputFilename;
+
+      // cached geometry is recomputed on demand
+      cornersValid = false;
+      invalidateGeometry();
    
       return *this;
    }
@@ -178,6 +203,8 @@ namespace DDG
    int Mesh::read( const string& filename )
    {
       inputFilename = filename;
+      cornersValid = false;
+      invalidateGeometry();
       ifstream in( filename.c_str() );
 
       if( !in.is_open() )
@@ -242,6 +269,208 @@ namespace DDG
       {
          v->position /= rMax;
       }
+
+      invalidateGeometry();
+   }
+
+   void Mesh::invalidateGeometry( void )
+   // marks all cached geometric quantities as out of date
+   {
+      version++;
+   }
+
+   unsigned long Mesh::geometryVersion( void ) const
+   {
+      return version;
+   }
+
+   double Mesh::cotan( HalfEdgeCIter h ) const
+   {
+      updateGeometry();
+      return cotans[ h - halfedges.begin() ];
+   }
+
+   double Mesh::area( FaceCIter f ) const
+   {
+      updateGeometry();
+      return faceAreas[ f - faces.begin() ];
+   }
+
+   Vector Mesh::normal( FaceCIter f ) const
+   {
+      updateGeometry();
+      return faceNormals[ f - faces.begin() ];
+   }
+
+   double Mesh::dualArea( VertexCIter v ) const
+   {
+      updateGeometry();
+      return dualAreas[ v - vertices.begin() ];
+   }
+
+   void Mesh::updateCorners( void ) const
+   // records which vertices each cached quantity depends on
+   {
+      const int V = vertices.size();
+      const int F = faces.size();
+      const int H = halfedges.size();
+      VertexCIter v0 = vertices.begin();
+
+      // same vertices as in HalfEdge::cotan()
+      halfedgeCorners.resize( 3*H );
+      for( int i = 0; i < H; i++ )
+      {
+         HalfEdgeCIter h = halfedges[i].next->next;
+         halfedgeCorners[3*i+0] = h->vertex - v0; h = h->next;
+         halfedgeCorners[3*i+1] = h->vertex - v0; h = h->next;
+         halfedgeCorners[3*i+2] = h->vertex - v0;
+      }
+
+      // (boundary loops may have any number of vertices)
+      faceStart.resize( F+1 );
+      faceCorners.clear();
+      faceCorners.reserve( H );
+      for( int i = 0; i < F; i++ )
+      {
+         faceStart[i] = faceCorners.size();
+
+         HalfEdgeCIter h = faces[i].he;
+         do
+         {
+            faceCorners.push_back( h->vertex - v0 );
+            h = h->next;
+         }
+         while( h != faces[i].he );
+      }
+      faceStart[F] = faceCorners.size();
+
+      // faces are visited in the same order as in Vertex::dualArea()
+      vertexFaceStart.resize( V+1 );
+      vertexFaces.clear();
+      vertexFaces.reserve( H );
+      for( int i = 0; i < V; i++ )
+      {
+         vertexFaceStart[i] = vertexFaces.size();
+
+         const Vertex& v( vertices[i] );
+         if( v.isIsolated() ) continue;
+
+         HalfEdgeCIter h = v.he;
+         do
+         {
+            vertexFaces.push_back( h->face - faces.begin() );
+            h = h->flip->next;
+         }
+         while( h != v.he );
+      }
+      vertexFaceStart[V] = vertexFaces.size();
+
+      cornersValid = true;
+   }
+
+   void Mesh::updateGeometry( void ) const
+   // recomputes the cached quantities if they are out of date
+   {
+      const int V = vertices.size();
+      const int F = faces.size();
+      const int H = halfedges.size();
+
+      if( cacheVersion == version &&
+          (int) px.size() == V &&
+          (int) faceAreas.size() == F &&
+          (int) cotans.size() == H )
+      {
+         return;
+      }
+
+      if( !cornersValid ||
+          (int) halfedgeCorners.size() != 3*H ||
+          (int) faceStart.size() != F+1 ||
+          (int) vertexFaceStart.size() != V+1 )
+      {
+         updateCorners();
+      }
+
+      // copy positions into separate coordinate arrays, so that the loops
+      // below are straight-line arithmetic on flat arrays that the compiler
+      // can vectorize; each loop is also parallel over elements
+      px.resize( V ); py.resize( V ); pz.resize( V );
+      for( int i = 0; i < V; i++ )
+      {
+         const Vector& p( vertices[i].position );
+         px[i] = p.x; py[i] = p.y; pz[i] = p.z;
+      }
+
+      const double* x = V ? &px[0] : NULL;
+      const double* y = V ? &py[0] : NULL;
+      const double* z = V ? &pz[0] : NULL;
+
+      // cotangent of the angle opposite each halfedge
+      cotans.resize( H );
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < H; i++ )
+      {
+         const int* c = &halfedgeCorners[3*i];
+
+         double vx = x[c[1]]-x[c[0]], vy = y[c[1]]-y[c[0]], vz = z[c[1]]-z[c[0]];
+         double ux = x[c[2]]-x[c[0]], uy = y[c[2]]-y[c[0]], uz = z[c[2]]-z[c[0]];
+
+         double nx = uy*vz - uz*vy;
+         double ny = uz*vx - ux*vz;
+         double nz = ux*vy - uy*vx;
+
+         cotans[i] = ( ux*vx + uy*vy + uz*vz ) / sqrt( nx*nx + ny*ny + nz*nz );
+      }
+
+      // face areas (via the same sum as Face::area(), which also handles
+      // nonplanar boundary loops) and normals
+      faceAreas.resize( F );
+      faceNormals.resize( F );
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < F; i++ )
+      {
+         const int* c = &faceCorners[ faceStart[i] ];
+         const int n = faceStart[i+1] - faceStart[i];
+
+         double ax = 0., ay = 0., az = 0.;
+         for( int k = 0; k < n; k++ )
+         {
+            int a = c[k], b = c[(k+1)%n];
+            double sx = x[b]+x[a], sy = y[b]+y[a], sz = z[b]+z[a];
+            double dx = x[b]-x[a], dy = y[b]-y[a], dz = z[b]-z[a];
+            ax += sy*dz - sz*dy;
+            ay += sz*dx - sx*dz;
+            az += sx*dy - sy*dx;
+         }
+         faceAreas[i] = sqrt( ax*ax + ay*ay + az*az ) / 4.;
+
+         double ux = x[c[1]]-x[c[0]], uy = y[c[1]]-y[c[0]], uz = z[c[1]]-z[c[0]];
+         double vx = x[c[2]]-x[c[0]], vy = y[c[2]]-y[c[0]], vz = z[c[2]]-z[c[0]];
+         faceNormals[i] = Vector( uy*vz - uz*vy,
+                                  uz*vx - ux*vz,
+                                  ux*vy - uy*vx ).unit();
+      }
+
+      // barycentric dual areas (one third of the incident face areas)
+      dualAreas.resize( V );
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < V; i++ )
+      {
+         double A = 0.;
+         for( int k = vertexFaceStart[i]; k < vertexFaceStart[i+1]; k++ )
+         {
+            A += faceAreas[ vertexFaces[k] ];
+         }
+         dualAreas[i] = A / 3.;
+      }
+
+      cacheVersion = version;
    }
 }
 
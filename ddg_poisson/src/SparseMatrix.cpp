@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <iostream>
 
 #include <SuiteSparseQR.hpp>
 
@@ -236,7 +237,9 @@ namespace DDG
                 DenseMatrix& x,
                 DenseMatrix& b )
    {
-      x = SuiteSparseQR<double>( *A, *b, context );
+      x = SuiteSparseQR<double>( context.qrOrdering(), SPQR_DEFAULT_TOL, *A, *b, context );
+
+      if( context.verbose() ) context.printQRStatistics( cout, "[qr]" );
    }
 }
 
@@ -15,11 +15,98 @@ namespace DDG
    // declare static member variables
    Mesh Viewer::mesh;
    Viewer::RenderMode Viewer::mode = renderShaded;
-   GLuint Viewer::surfaceDL = 0;
+   MeshBuffer Viewer::surface;
    int Viewer::windowSize[2] = { 512, 512 };
    Camera Viewer::camera;
    double Viewer::maxDensity;
    double Viewer::maxPotential;
+   SolverQueue Viewer::solver( 1 );
+   int Viewer::meshRevision = 0;
+   string Viewer::windowTitle( "DDG" );
+
+   class PotentialTask : public SolverTask
+   // solves the Poisson problem on a copy of the mesh, then copies the
+   // potential back into Viewer::mesh
+   {
+      public:
+         PotentialTask( void )
+         : mesh( Viewer::mesh ),
+           revision( Viewer::meshRevision )
+         {}
+
+         virtual void run( void )
+         {
+            setProgress( 0., "solving Poisson problem" );
+            mesh.solveScalarPoissonProblem();
+         }
+
+         virtual void finish( void )
+         {
+            if( revision != Viewer::meshRevision ||
+                mesh.vertices.size() != Viewer::mesh.vertices.size() )
+            {
+               cerr << "Mesh was reset while solving; discarding result." << endl;
+               return;
+            }
+
+            for( size_t i = 0; i < mesh.vertices.size(); i++ )
+            {
+               Viewer::mesh.vertices[i].phi = mesh.vertices[i].phi;
+            }
+
+            Viewer::mPotential();
+         }
+
+      protected:
+         Mesh mesh;
+         int revision;
+   };
+
+   class FlowTask : public SolverTask
+   // takes a single implicit mean curvature flow step from the original
+   // mesh, then copies the new vertex positions back into Viewer::mesh
+   {
+      public:
+         FlowTask( double t_ )
+         : mesh( Viewer::mesh ),
+           revision( Viewer::meshRevision ),
+           t( t_ )
+         {}
+
+         virtual void run( void )
+         {
+            setProgress( 0., "reloading mesh" );
+            mesh.reload();
+            if( cancelled() ) return;
+
+            setProgress( .1, "integrating mean curvature flow" );
+            mesh.computeImplicitMeanCurvatureFlow( t );
+            mesh.normalize();
+         }
+
+         virtual void finish( void )
+         {
+            if( revision != Viewer::meshRevision ||
+                mesh.vertices.size() != Viewer::mesh.vertices.size() )
+            {
+               cerr << "Mesh was reset while solving; discarding result." << endl;
+               return;
+            }
+
+            for( size_t i = 0; i < mesh.vertices.size(); i++ )
+            {
+               Viewer::mesh.vertices[i].position = mesh.vertices[i].position;
+            }
+            Viewer::mesh.invalidateGeometry();
+
+            Viewer::updateGeometry();
+         }
+
+      protected:
+         Mesh mesh;
+         int revision;
+         double t;
+   };
    
    void Viewer :: init( void )
    {
@@ -37,7 +124,7 @@ namespace DDG
          v->rho = 0.;
       }
    
-      updateDisplayList();
+      updateBuffers();
    
       glutMainLoop();
    }
@@ -74,6 +161,7 @@ namespace DDG
       glutSetMenu( mainMenu );
       glutAddMenuEntry( "[space] Compute Potential", menuComputePotential  );
       glutAddMenuEntry( "[c] Compute Flow",          menuComputeFlow       );
+      glutAddMenuEntry( "[x] Cancel Computation",    menuCancel            );
       glutAddMenuEntry( "[r] Reset Mesh",            menuResetMesh         );
       glutAddMenuEntry( "[w] Write Mesh",            menuWriteMesh         );
       glutAddMenuEntry( "[\\] Screenshot",           menuScreenshot        );
@@ -106,6 +194,9 @@ namespace DDG
          case( menuComputeFlow ):
             mComputeFlow();
             break;
+         case( menuCancel ):
+            mCancel();
+            break;
          case( menuResetMesh ):
             mResetMesh();
             break;
@@ -152,6 +243,12 @@ namespace DDG
    
    void Viewer :: mComputePotential( void )
    {
+      if( solver.busy() )
+      {
+         cerr << "Solver is busy (press 'x' to cancel)." << endl;
+         return;
+      }
+
       // pick a random pair of vertices and set the density
       // to +1 on one of them and -1 on the other
       int i = rand() % mesh.vertices.size();
@@ -164,26 +261,34 @@ namespace DDG
          if( v->index == j ) v->rho = -1.;
       }
       
-      mesh.solveScalarPoissonProblem();
-      mPotential();
+      solver.submit( new PotentialTask() );
    }
 
    void Viewer :: mComputeFlow( void )
    {
       static double t = 0.0001;
 
-      mesh.reload();
-      mesh.computeImplicitMeanCurvatureFlow( t );
-      mesh.normalize();
-      updateDisplayList();
+      if( solver.busy() )
+      {
+         cerr << "Solver is busy (press 'x' to cancel)." << endl;
+         return;
+      }
+
+      solver.submit( new FlowTask( t ));
 
       t *= 2.;
    }
+
+   void Viewer :: mCancel( void )
+   {
+      solver.cancelAll();
+   }
    
    void Viewer :: mResetMesh( void )
    {
+      meshRevision++;
       mesh.reload();
-      updateDisplayList();
+      updateBuffers();
    }
    
    void Viewer :: mWriteMesh( void )
@@ -194,13 +299,13 @@ namespace DDG
    void Viewer :: mExit( void )
    {
       storeViewerState();
+      solver.shutdown();
       exit( 0 );
    }
    
    void Viewer :: mSmoothShaded( void )
    {
       mode = renderShaded;
-      updateDisplayList();
    }
 
    void Viewer :: mDensity( void )
@@ -214,7 +319,7 @@ namespace DDG
       }
 
       mode = renderDensity;
-      updateDisplayList();
+      updateColors();
    }
 
    void Viewer :: mPotential( void )
@@ -228,13 +333,12 @@ namespace DDG
       }
 
       mode = renderPotential;
-      updateDisplayList();
+      updateColors();
    }
    
    void Viewer :: mWireframe( void )
    {
       mode = renderWireframe;
-      updateDisplayList();
    }
 
    void Viewer :: mZoomIn( void )
@@ -299,6 +403,9 @@ namespace DDG
          case 'c':
             mComputeFlow();
             break;
+         case 'x':
+            mCancel();
+            break;
          case GLUT_KEY_UP:
             camera.zoomIn();
             break;
@@ -378,7 +485,8 @@ namespace DDG
       glEnable( GL_DEPTH_TEST );
       glEnable( GL_LIGHTING );
    
-      glCallList( surfaceDL );
+      setMeshMaterial();
+      drawMesh();
    
       glPopAttrib();
    }
@@ -411,46 +519,8 @@ namespace DDG
 
    void Viewer :: drawPolygons( void )
    {
-      for( FaceCIter f  = mesh.faces.begin();
-                     f != mesh.faces.end();
-                     f ++ )
-      {
-         if( f->isBoundary() ) continue;
-
-         glBegin( GL_POLYGON );
-         if( mode == renderWireframe )
-         {
-            Vector N = f->normal();
-            glNormal3dv( &N[0] );
-         }
-
-         HalfEdgeCIter he = f->he;
-         do
-         {
-            if( mode != renderWireframe )
-            {
-               Vector N = he->vertex->normal();
-               glNormal3dv( &N[0] );
-            }
-
-            double c = 0.;
-            if( mode == renderDensity )
-            {
-               c = he->vertex->rho / maxDensity;
-            }
-            if( mode == renderPotential )
-            {
-               c = he->vertex->phi / maxPotential;
-            }
-            glColor3f( c, 0., -c );
-
-            glVertex3dv( &he->vertex->position[0] );
-
-            he = he->next;
-         }
-         while( he != f->he );
-         glEnd();
-      }
+      bool useColors = ( mode == renderDensity || mode == renderPotential );
+      surface.draw( MeshBuffer::triangles, MeshBuffer::positionStream, true, useColors );
    }
 
    void Viewer :: drawWireframe( void )
@@ -462,15 +532,7 @@ namespace DDG
       glEnable( GL_BLEND );
       glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 
-      glBegin( GL_LINES );
-      for( EdgeCIter e  = mesh.edges.begin();
-            e != mesh.edges.end();
-            e ++ )
-      {
-         glVertex3dv( &e->he->vertex->position[0] );
-         glVertex3dv( &e->he->flip->vertex->position[0] );
-      }
-      glEnd();
+      surface.draw( MeshBuffer::lines, MeshBuffer::positionStream, false, false );
 
       glPopAttrib();
    }
@@ -487,36 +549,127 @@ namespace DDG
       glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
       glColor4f( 1., 0., 0., 1. ); // red
 
-      glBegin( GL_POINTS );
-      for( VertexCIter v  = mesh.vertices.begin();
-                       v != mesh.vertices.end();
-                       v ++ )
+      surface.draw( MeshBuffer::points, MeshBuffer::positionStream, false, false );
+
+      glPopAttrib();
+   }
+   
+   void Viewer :: updateBuffers( void )
+   {
+      updateGeometry();
+      updateColors();
+   }
+
+   void Viewer :: updateGeometry( void )
+   {
+      const int V = mesh.vertices.size();
+      VertexCIter v0 = mesh.vertices.begin();
+
+      vector<GLfloat> positions( 3*V );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
       {
-         if( v->isIsolated() )
+         for( int k = 0; k < 3; k++ )
          {
-            glVertex3dv( &v->position[0] );
+            positions[ 3*(v-v0)+k ] = v->position[k];
          }
       }
-      glEnd();
 
-      glPopAttrib();
+      vector<GLuint> triangles;
+      triangles.reserve( 3*mesh.faces.size() );
+      for( FaceCIter f = mesh.faces.begin(); f != mesh.faces.end(); f++ )
+      {
+         if( f->isBoundary() ) continue;
+
+         // split polygons into triangle fans around the first vertex
+         HalfEdgeCIter he = f->he->next;
+         while( he->next != f->he )
+         {
+            triangles.push_back( f->he->vertex - v0 );
+            triangles.push_back( he->vertex - v0 );
+            triangles.push_back( he->next->vertex - v0 );
+            he = he->next;
+         }
+      }
+
+      vector<GLuint> lines;
+      lines.reserve( 2*mesh.edges.size() );
+      for( EdgeCIter e = mesh.edges.begin(); e != mesh.edges.end(); e++ )
+      {
+         lines.push_back( e->he->vertex - v0 );
+         lines.push_back( e->he->flip->vertex - v0 );
+      }
+
+      vector<GLuint> points;
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
+      {
+         if( v->isIsolated() ) points.push_back( v - v0 );
+      }
+
+      surface.setStream( MeshBuffer::positionStream, positions, 3 );
+      surface.setIndices( MeshBuffer::triangles, triangles );
+      surface.setIndices( MeshBuffer::lines, lines );
+      surface.setIndices( MeshBuffer::points, points );
+
+      updateNormals();
    }
-   
-   void Viewer :: updateDisplayList( void )
+
+   void Viewer :: updateNormals( void )
+   {
+      const int V = mesh.vertices.size();
+      VertexCIter v0 = mesh.vertices.begin();
+
+      vector<GLfloat> normals( 3*V, 0. );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
+      {
+         if( v->isIsolated() ) continue;
+
+         // same as v->normal(), but using the cached face normals
+         Vector N;
+         HalfEdgeCIter h = v->he;
+         do
+         {
+            N += mesh.normal( h->face );
+            h = h->flip->next;
+         }
+         while( h != v->he );
+         N.normalize();
+
+         for( int k = 0; k < 3; k++ )
+         {
+            normals[ 3*(v-v0)+k ] = N[k];
+         }
+      }
+
+      surface.setStream( MeshBuffer::normalStream, normals, 3 );
+   }
+
+   void Viewer :: updateColors( void )
    {
-      if( surfaceDL )
+      // colors are only used to visualize the density and the potential
+      if( mode != renderDensity && mode != renderPotential ) return;
+
+      const int V = mesh.vertices.size();
+      VertexCIter v0 = mesh.vertices.begin();
+
+      vector<GLfloat> colors( 3*V );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
       {
-         glDeleteLists( surfaceDL, 1 );
-         surfaceDL = 0;
+         double c = 0.;
+         if( mode == renderDensity )
+         {
+            c = v->rho / maxDensity;
+         }
+         if( mode == renderPotential )
+         {
+            c = v->phi / maxPotential;
+         }
+
+         colors[ 3*(v-v0)+0 ] =  c;
+         colors[ 3*(v-v0)+1 ] =  0.;
+         colors[ 3*(v-v0)+2 ] = -c;
       }
-   
-      surfaceDL = glGenLists( 1 );
-   
-      setMeshMaterial();
-   
-      glNewList( surfaceDL, GL_COMPILE );
-      drawMesh();
-      glEndList();
+
+      surface.setStream( MeshBuffer::colorStream, colors, 3 );
    }
    
    void Viewer :: mouse( int button, int state, int x, int y )
@@ -531,10 +684,31 @@ namespace DDG
    
    void Viewer :: idle( void )
    {
+      solver.poll();
+      updateWindowTitle();
       camera.idle();
       glutPostRedisplay();
    }
 
+   void Viewer :: updateWindowTitle( void )
+   {
+      stringstream title;
+      title << "DDG";
+
+      double fraction;
+      string stage;
+      if( solver.status( fraction, stage ))
+      {
+         title << " -- " << stage << " (" << (int)( 100.*fraction ) << "%)";
+      }
+
+      if( title.str() != windowTitle )
+      {
+         windowTitle = title.str();
+         glutSetWindowTitle( windowTitle.c_str() );
+      }
+   }
+
    void Viewer :: storeViewerState( void )
    {
       ofstream out( ".viewer_state.txt" );
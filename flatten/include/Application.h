@@ -15,10 +15,18 @@
 
 namespace DDG
 {
+   class SolverTask;
+
    class Application
    {
    public:
-      void run(Mesh& mesh);
+      Application();
+
+      void run(Mesh& mesh, SolverTask* task = NULL);
+      // flattens a mesh with boundary; otherwise designs a vector field with
+      // singularities at the tagged vertices.  If a task is given, progress
+      // is reported to it and the computation stops early (leaving the mesh
+      // partially updated) once it is cancelled
       void flatten(Mesh& mesh);
       void designVectorField(Mesh& mesh);
       
@@ -30,6 +38,16 @@ namespace DDG
       void balanceWinding(Mesh& mesh);
       void solveForConnection(Mesh& mesh);
       void transportVectorField(Mesh& mesh);
+
+      bool sameTopology(const Mesh& mesh) const;
+      void storeTopology(const Mesh& mesh);
+
+      // solver state kept between calls to flatten(); it is reused
+      // as long as the mesh has the same connectivity
+      std::vector<int> flattenTopology;
+      int flattenVertexCount, flattenFaceCount;
+      SparseFactor<Complex> flattenFactor;
+      DenseMatrix<Complex> flattenSolution;
    };
 }
 
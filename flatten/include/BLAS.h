@@ -0,0 +1,64 @@
+// -----------------------------------------------------------------------------
+// libDDG -- BLAS.h
+// -----------------------------------------------------------------------------
+//
+// Prototypes for the subset of the Fortran BLAS interface used by DenseMatrix.
+// These symbols are provided by whichever BLAS is linked in DDG_BLAS_LIBS
+// (reference BLAS, OpenBLAS, Accelerate, MKL, ...), so blocking and threading
+// are inherited from that library.  All arguments are passed by pointer and
+// matrices are stored in column-major order, matching DenseMatrix.  Complex
+// arrays are interleaved (re,im) pairs, matching the layout of DDG::Complex.
+//
+// Note that only routines returning void or double are declared here: the
+// calling convention for Fortran functions returning a complex value (e.g.,
+// zdotc) differs between BLAS implementations.
+//
+
+#ifndef DDG_BLAS_H
+#define DDG_BLAS_H
+
+extern "C"
+{
+   void dgemm_( const char* transa, const char* transb,
+                const int* m, const int* n, const int* k,
+                const double* alpha, const double* A, const int* lda,
+                                     const double* B, const int* ldb,
+                const double* beta,        double* C, const int* ldc );
+   // C = alpha*op(A)*op(B) + beta*C (real)
+
+   void zgemm_( const char* transa, const char* transb,
+                const int* m, const int* n, const int* k,
+                const double* alpha, const double* A, const int* lda,
+                                     const double* B, const int* ldb,
+                const double* beta,        double* C, const int* ldc );
+   // C = alpha*op(A)*op(B) + beta*C (complex)
+
+   void dgemv_( const char* trans, const int* m, const int* n,
+                const double* alpha, const double* A, const int* lda,
+                                     const double* x, const int* incx,
+                const double* beta,        double* y, const int* incy );
+   // y = alpha*op(A)*x + beta*y (real)
+
+   void zgemv_( const char* trans, const int* m, const int* n,
+                const double* alpha, const double* A, const int* lda,
+                                     const double* x, const int* incx,
+                const double* beta,        double* y, const int* incy );
+   // y = alpha*op(A)*x + beta*y (complex)
+
+   double ddot_( const int* n, const double* x, const int* incx,
+                               const double* y, const int* incy );
+   // returns x'y (real)
+
+   double dnrm2_( const int* n, const double* x, const int* incx );
+   // returns the Euclidean norm of x (real)
+
+   void daxpy_( const int* n, const double* alpha, const double* x, const int* incx,
+                                                         double* y, const int* incy );
+   // y += alpha*x (real)
+
+   void dscal_( const int* n, const double* alpha, double* x, const int* incx );
+   // x *= alpha (real)
+}
+
+#endif
+
@@ -34,6 +34,9 @@ namespace DDG
          
          void setView( void ) const;
          // applies the camera transformation to the OpenGL modelview stack
+
+         void viewMatrix( double M[16] ) const;
+         // gets the matrix applied by setView() (in column-major order)
          
          void mouse( int button, int state, int x, int y );
          // handles mouse clicks
@@ -53,6 +56,9 @@ namespace DDG
          Quaternion currentRotation( void ) const;
          // returns the rotation corresponding to the current mouse state
 
+         bool moving( void ) const;
+         // returns true while the view is being dragged, spinning, or zooming
+
          Quaternion pClick;
          // mouse coordinates of current click
          
@@ -0,0 +1,54 @@
+// -----------------------------------------------------------------------------
+// libDDG -- DenseKernels.h
+// -----------------------------------------------------------------------------
+//
+// DenseKernels provides the low-level vector loops used by DenseMatrix for
+// complex and quaternionic entries.  Since Complex and Quaternion store their
+// components contiguously (re,im and r,i,j,k respectively), an array of n
+// complex numbers can be viewed as 2n interleaved doubles and an array of n
+// quaternions as 4n interleaved doubles:
+//
+//    DenseMatrix<Complex> x( n ), y( n );
+//    double a[2] = { 1., 2. };
+//    complexAxpy( n, a, (const double*) &x(0), (double*) &y(0) ); // y += a*x
+//
+// Each kernel is vectorized using AVX-512, AVX (with FMA when available) or
+// SSE3, depending on the instruction set the library is compiled for (see
+// DDG_SIMD_FLAGS in the Makefile); a portable scalar loop is used otherwise.
+// You should not normally call these routines directly -- the corresponding
+// DenseMatrix operations (+=, *=, norm(), inner(), axpy(), etc.) use them
+// automatically.
+//
+
+#ifndef DDG_DENSEKERNELS_H
+#define DDG_DENSEKERNELS_H
+
+namespace DDG
+{
+   double realSumSquares( int n, const double* x );
+   // returns the sum of squares of the n entries of x
+
+   void realAxpy( int n, double a, const double* x, double* y );
+   // y += a*x for real arrays of length n
+
+   void complexAxpy( int n, const double a[2], const double* x, double* y );
+   // y += a*x for complex arrays of length n
+
+   void complexScale( int n, const double a[2], double* x );
+   // x *= a for a complex array of length n
+
+   void complexInner( int n, const double* x, const double* y, double r[2] );
+   // r = sum_i conj(x_i) y_i (Hermitian inner product)
+
+   void quaternionAxpy( int n, const double a[4], const double* x, double* y );
+   // y += a*x for quaternion arrays of length n (a multiplies from the left)
+
+   void quaternionScale( int n, const double a[4], double* x );
+   // x *= a for a quaternion array of length n (a multiplies from the right)
+
+   void quaternionInner( int n, const double* x, const double* y, double r[4] );
+   // r = sum_i conj(x_i) y_i (quaternionic Hermitian inner product)
+}
+
+#endif
+
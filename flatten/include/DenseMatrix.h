@@ -85,6 +85,11 @@ namespace DDG
          T& operator()( int index );
          T  operator()( int index ) const;
          // access the specified element of a vector (uses 0-based indexing)
+
+               T* entries( void );
+         const T* entries( void ) const;
+         // returns a pointer to the entries, stored contiguously in
+         // column-major order (NULL for an empty matrix)
          
          DenseMatrix<T> transpose( void ) const;
          // returns the transpose of this matrix
@@ -154,6 +159,10 @@ namespace DDG
    T dot( const DenseMatrix<T>& x, const DenseMatrix<T>& y );
    // returns Euclidean inner product of x and y
 
+   template <class T>
+   void axpy( const T& a, const DenseMatrix<T>& x, DenseMatrix<T>& y );
+   // computes y += a*x (for quaternions, a multiplies from the left)
+
    template <class T>
    std::ostream& operator << (std::ostream& os, const DenseMatrix<T>& o);
    // prints entries
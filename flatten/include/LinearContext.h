@@ -8,15 +8,62 @@
 // is shared by all instances of DenseMatrix, SparseMatrix, and LinearSystem.
 // In other words, you shouldn't have to instantiate LinearContext yourself
 // unless you're doing something really fancy!
+//
+// Since a cholmod_common holds workspace as well as settings, it must not be
+// used by two threads at once.  LinearContext therefore keeps a pool of
+// cholmod_common instances, one per thread: converting a LinearContext to a
+// cholmod_common* returns the instance belonging to the calling thread,
+// creating it on first use with the same settings as the context itself.
+// Independent solves can hence run in separate threads (e.g., one mesh per
+// thread) without any locking on the solve path.  Instances are released
+// when their thread exits or when the context is destroyed.
+//
+// Solver settings (fill-reducing ordering, supernodal vs. simplicial
+// factorization, etc.) can be changed through the typed interface below;
+// changes are applied to the shared settings, and each existing per-thread
+// instance picks them up the next time its thread requests it (never in the
+// middle of a call into the library).  Statistics (flop count, nnz(L) or nnz(R), peak memory)
+// always refer to the most recent factorization performed by the calling
+// thread.
+// The same settings can be given on the command line, e.g.,
+//
+//    flatten -ordering metis -factor supernodal -memory 4096 -stats in.obj
+//
+// (see LinearContext::parseOption() and LinearContext::usage()).
 // 
 
 #ifndef DDG_LINEARSOLVERCONTEXT
 #define DDG_LINEARSOLVERCONTEXT
 
 #include <cholmod.h>
+#include <pthread.h>
+#include <vector>
+#include <iostream>
+#include <string>
 
 namespace DDG
 {
+   enum OrderingMethod
+   // fill-reducing orderings
+   {
+      orderingDefault,         // let the library choose (AMD, then METIS if fill is high)
+      orderingNatural,         // no reordering
+      orderingAMD,             // approximate minimum degree
+      orderingMETIS,           // METIS nested dissection
+      orderingNestedDissection // CHOLMOD nested dissection (METIS + constrained minimum degree)
+   };
+
+   enum FactorizationType
+   // storage for Cholesky factors
+   {
+      factorAutomatic,  // choose based on the flop count per nonzero
+      factorSimplicial, // column-by-column (good for very sparse factors)
+      factorSupernodal  // dense supernodal blocks (BLAS-3)
+   };
+
+   struct ThreadCommon;
+   // per-thread instance (see LinearContext.cpp)
+
    class LinearContext
    {
       public:
@@ -28,9 +75,116 @@ namespace DDG
 
          operator cholmod_common*( void );
          // allows LinearContext to be treated as a cholmod_common*
+         // (returns the instance for the calling thread)
+
+         void setOrdering( OrderingMethod ordering );
+         // sets the fill-reducing ordering used by subsequent factorizations
+
+         OrderingMethod ordering( void ) const;
+         // returns the current fill-reducing ordering
+
+         int qrOrdering( void ) const;
+         // returns the current ordering as an SPQR_ORDERING_* constant
+         // (SPQR has no nested dissection of its own; METIS is used instead)
+
+         void setFactorization( FactorizationType type );
+         // selects supernodal, simplicial, or automatic factorization
+
+         void setFinalLL( bool ll );
+         // if true, factors are returned in LL' form; otherwise simplicial
+         // factors are returned in LDL' form
+
+         void setThreads( int n );
+         // sets the number of threads used by BLAS/LAPACK and SPQR (zero
+         // means one per processor); OpenBLAS, MKL, and OpenMP are updated
+         // immediately (OpenMP only for the calling thread), while other BLAS
+         // implementations may read their thread count only once, so this
+         // should be called before the first solve
+
+         void setMixedPrecision( bool mixed );
+         // if true, Cholesky factors are computed in single precision (half
+         // the memory and roughly twice the BLAS throughput) and solutions
+         // are refined in double precision; factors fall back to double
+         // precision automatically if refinement stalls (requires CHOLMOD 5)
+
+         bool mixedPrecision( void ) const;
+         // returns true if Cholesky factors are computed in single precision
+
+         void setUseGPU( bool use );
+         // enables or disables GPU acceleration (if CHOLMOD was built with it)
+
+         void setMemoryBudget( double megabytes );
+         // limits the memory the solvers allocate from the heap; beyond this
+         // limit, large blocks (such as the values of a supernodal factor)
+         // are kept in memory-mapped scratch files (zero means no limit --
+         // see ScratchAllocator.h)
+
+         void setScratchDirectory( const std::string& path );
+         // sets the directory used for scratch files (default: $TMPDIR or /tmp)
+
+         void setVerbose( bool verbose );
+         // if true, solvers print statistics after each factorization
+
+         bool verbose( void ) const;
+         // returns true if solvers should print statistics
+
+         double flopCount( void );
+         // returns the flop count of the most recent factorization
+
+         double factorNonzeros( void );
+         // returns the number of nonzeros in the most recent factor L
+
+         double qrFactorNonzeros( void );
+         // returns the number of nonzeros in the most recent QR factor R
+
+         double peakMemory( void );
+         // returns the peak memory usage (in bytes) of the calling thread's instance
+
+         void printStatistics( std::ostream& out, const char* prefix );
+         // writes the statistics above to out, one per line, each
+         // preceded by prefix (e.g., "[chol]")
+
+         void printQRStatistics( std::ostream& out, const char* prefix );
+         // same as printStatistics(), but for the most recent QR factorization
+
+         int parseOption( int i, int argc, char** argv );
+         // if argv[i] is a solver option, applies it and returns the number
+         // of arguments it used; returns zero if argv[i] is not a solver
+         // option, or -1 if its value is missing or invalid
+
+         static const char* usage( void );
+         // returns a description of the options accepted by parseOption()
 
       protected:
+         ThreadCommon* createThreadCommon( void );
+         static void releaseThreadCommon( void* common );
+
+         void printScratchStatistics( std::ostream& out, const char* prefix );
+         // writes scratch file usage to out (if a memory budget is set)
+
+         void updateSettings( void );
+         // marks the shared settings as changed (call with settingsMutex held)
+
          cholmod_common context;
+         // settings shared by all threads
+
+         OrderingMethod orderingMethod;
+         bool mixedPrecisionFactor;
+         bool verboseOutput;
+         // settings not stored in cholmod_common
+
+         int settingsVersion;
+         pthread_mutex_t settingsMutex;
+         // number of changes made to the shared settings, which (along with
+         // the settings themselves) are guarded by settingsMutex
+
+         pthread_key_t threadCommon;
+         // per-thread cholmod_common instance
+
+         std::vector<cholmod_common*> pool;
+         pthread_mutex_t poolMutex;
+         // all instances created so far (guarded by poolMutex, which is
+         // only locked when a thread creates or releases its instance)
    };
 }
 
@@ -16,17 +16,72 @@
 // while the polynomial is still in use -- LinearPolynomial stores only a
 // reference to these variables so that the solution to a linear system can be
 // automatically copied back into the variables.
+//
+// Linear terms are kept in a LinearTermList, i.e., a flat array of
+// (variable,coefficient) pairs sorted by variable.  Up to eight terms are
+// stored inline, which covers typical stencils without any heap allocation,
+// and polynomials are added by merging their sorted term lists.
 // 
 
 #ifndef DDG_LINEARPOLYNOMIAL_H
 #define DDG_LINEARPOLYNOMIAL_H
 
-#include <map>
 #include <iosfwd>
 #include "Variable.h"
+#include "Types.h"
 
 namespace DDG
 {
+   class LinearTermList
+   {
+      public:
+         LinearTermList( void );
+         // constructs an empty list
+
+         LinearTermList( const LinearTermList& l );
+         // copy constructor
+
+         ~LinearTermList( void );
+         // destructor
+
+         const LinearTermList& operator=( const LinearTermList& l );
+         // copies l
+
+         double& operator[]( Variable* v );
+         // returns the coefficient of v, inserting a zero term if v is not yet present
+
+         TermIter find( Variable* v );
+         TermCIter find( Variable* v ) const;
+         // returns the term for v, or end() if v is not present
+
+         void merge( const LinearTermList& l, double c );
+         // adds c times the terms of l to this list
+
+         void reserve( int capacity );
+         // makes room for at least the specified number of terms
+
+         void clear( void );
+         // removes all terms
+
+         int size( void ) const;
+         // returns the number of terms
+
+          TermIter begin( void );
+         TermCIter begin( void ) const;
+          TermIter   end( void );
+         TermCIter   end( void ) const;
+         // return iterators to the first and one past the last term
+
+      protected:
+         static const int inlineCapacity = 8;
+         // number of terms stored without allocating memory
+
+         LinearTerm* terms;
+         int nTerms;
+         int capacity;
+         LinearTerm inlineTerms[ inlineCapacity ];
+   };
+
    class LinearPolynomial
    {
       public:
@@ -65,8 +120,8 @@ namespace DDG
          double evaluate( void ) const;
          // evaluates the function using the current values of its variables
 
-         std::map<Variable*,double> linearTerms;
-         // list of linear terms
+         LinearTermList linearTerms;
+         // list of linear terms, sorted by variable
 
          double constantTerm;
          // constant term
@@ -15,18 +15,40 @@
 // equations.  (In the future variables may become reference-counted in order
 // to avoid this issue.)
 //
-// Note that LinearSystem::solve() uses a general-purpose linear solver (namely
-// the sparse QR factorization found in SuiteSparse) that is quite fast but may
-// not always be your best option.  To improve performance you may want to
-// build the system explicitly using an instance of SparseMatrix and call a
-// more specialized solver.  (In the future there may be options for specifying
-// that a LinearSystem is, e.g., symmetric and positive-definite.)
+// LinearSystem::solve() computes a (least-squares) solution using one of
+// several strategies, selected via LinearSystem::method:
+//
+//    lsCholesky -- sparse Cholesky factorization of the normal equations A'A x = A'b
+//    lsLSQR     -- the iterative LSQR method, which never forms A'A or a factor
+//    lsQR       -- sparse QR factorization of A (SuiteSparseQR)
+//
+// The default, lsAutomatic, tries Cholesky first.  It falls back to LSQR when
+// the predicted size of the factor is too large, and to QR when A'A is not
+// numerically positive-definite or its estimated condition number is too
+// large for the normal equations to be accurate.  The time spent in each
+// phase is printed by solve().
+//
+// Repeated calls to solve() do only as much work as needed.  If only the
+// constant terms or the values of fixed variables changed, the existing
+// factorization is reused and only a backsolve is performed.  If coefficients
+// changed but the nonzero pattern did not, the matrix is refactored reusing
+// the previous ordering and symbolic analysis.  Only a change in structure
+// (equations or free variables added or removed) starts over from scratch.
+// LSQR instead starts from the previous solution whenever the structure is
+// unchanged.
+//
+// Internally, solve() makes a single pass over the equations.  Each remaining
+// (non-fixed) term is written directly into a compressed-row buffer, using the
+// variable's id (see Variable.h) to look up its column in a table that covers
+// only the ids occurring in this system.  The buffer is then transposed into
+// CHOLMOD's compressed-column format in one linear pass.
 //
 
 #ifndef DDG_LINEARSYSTEM_H
 #define DDG_LINEARSYSTEM_H
 
 #include <vector>
+#include <SuiteSparseQR.hpp>
 #include "LinearEquation.h"
 #include "SparseMatrix.h"
 #include "DenseMatrix.h"
@@ -34,9 +56,37 @@
 
 namespace DDG
 {
+   enum LeastSquaresMethod
+   {
+      lsAutomatic,
+      lsCholesky,
+      lsLSQR,
+      lsQR
+   };
+
+   enum SystemChange
+   {
+      noChange,
+      rhsChanged,
+      valuesChanged,
+      structureChanged
+   };
+
    class LinearSystem
    {
       public:
+         LinearSystem( void );
+         // constructs an empty system
+
+         LinearSystem( const LinearSystem& s );
+         // copies the equations of s
+
+         ~LinearSystem( void );
+         // destructor
+
+         const LinearSystem& operator=( const LinearSystem& s );
+         // copies the equations of s
+
          void clear( void );
          // removes all equations from the system
 
@@ -50,20 +100,60 @@ namespace DDG
          std::vector<LinearEquation> equations;
          // the collection of equations defining the system
 
+         LeastSquaresMethod method;
+         // strategy used by solve() (lsAutomatic by default)
+
       protected:
-         void convertEquations( void );
-         void indexVariables( void );
+         SystemChange assembleEquations( void );
          void buildSparseMatrix( void );
          void buildRightHandSide( void );
-         void computeSolution( void );
+         void computeSolution( SystemChange change );
+         LeastSquaresMethod chooseMethod( void );
+         void formNormalEquations( void );
+         void factorNormalEquations( void );
+         void backsolveNormalEquations( void );
+         void factorQR( void );
+         void backsolveQR( void );
+         void clearFactors( void );
+         void solveLSQR( bool warmStart );
+         void multiply( const DenseMatrix<Real>& v, DenseMatrix<Real>& Av ) const;
+         void multiplyTranspose( const DenseMatrix<Real>& u, DenseMatrix<Real>& Atu ) const;
+         void buildIndex( void );
+         int& columnOf( const Variable* variable );
 
          int nEquations;
          int nVariables;
-         std::vector<LinearPolynomial> currentEquations;
-         std::map<Variable*,int> index;
-         SparseMatrix<Real> A;
-          DenseMatrix<Real> x;
-          DenseMatrix<Real> b;
+
+         std::vector<int> column;
+         unsigned int idBase;
+         std::vector<unsigned int> sortedIDs;
+         // column assigned to each variable in the system, or -1 if not yet
+         // seen; indexed by id - idBase, or by rank in sortedIDs if nonempty
+
+         std::vector<Variable*> variables;
+         std::vector<unsigned int> variableIDs;
+         // variable (and its id) associated with each column
+
+         std::vector<int> rowStart;
+         std::vector<int> columnIndex;
+         std::vector<double> values;
+         std::vector<double> constants;
+         // equations in compressed-row form: row i has coefficients
+         // values[rowStart[i]..rowStart[i+1]-1] in columns columnIndex[...]
+         // and right-hand side constants[i]
+
+         cholmod_sparse* A;
+         DenseMatrix<Real> x;
+         DenseMatrix<Real> b;
+
+         cholmod_sparse* AtA;
+         cholmod_factor* L;
+         SuiteSparseQR_factorization<double>* QR;
+         LeastSquaresMethod factorMethod;
+         bool factorCurrent;
+         // factorization kept between calls to solve(): factorMethod is the
+         // method in use (lsAutomatic if none has been chosen yet), and
+         // factorCurrent is false if the matrix values changed since then
    };
 }
 
@@ -0,0 +1,138 @@
+// -----------------------------------------------------------------------------
+// libDDG -- MarkerBuffer.h
+// -----------------------------------------------------------------------------
+//
+// MarkerBuffer draws a collection of small spheres ("markers"), e.g., to show
+// which vertices of a mesh have been tagged.  The sphere is tessellated only
+// once, and all markers are drawn with a single instanced draw call, where
+// the center, radius, and color of each marker are per-instance vertex
+// attributes.  Typical usage is
+//
+//    MarkerBuffer buffer;
+//    Shader shader;
+//    shader.loadVertex( "shaders/marker_vertex.glsl" );
+//    shader.loadFragment( "shaders/marker_fragment.glsl" );
+//
+//    vector<MarkerBuffer::Marker> markers( 1 );
+//    markers[0].center = Vector( 1., 2., 3. );
+//    markers[0].radius = .1;
+//    buffer.setMarkers( markers );
+//
+// when the markers change, and
+//
+//    buffer.draw( shader );
+//
+// in the display callback.  Markers can also be added, changed, or removed
+// one at a time under an integer key (e.g., the index of the vertex they
+// mark) via setMarker() and removeMarker(); only the markers that actually
+// changed are uploaded by the next call to draw(), so editing a single
+// marker takes constant time no matter how many markers there are.
+// Removing a marker moves the last marker into its place, so markers added
+// one at a time are not necessarily drawn in the order they were added.
+//
+// Markers are lit by OpenGL light 0 in the same way as the fixed-function
+// pipeline would light a sphere with the given diffuse color and a white
+// specular highlight.  If the OpenGL implementation does not support
+// instancing (GL_ARB_draw_instanced and GL_ARB_instanced_arrays), each
+// marker is drawn with a separate call from the same buffers.
+//
+// As with MeshBuffer, all methods must be called while the OpenGL context is
+// current.
+//
+
+#ifndef DDG_MARKERBUFFER_H
+#define DDG_MARKERBUFFER_H
+
+#include <vector>
+#include "Vector.h"
+#include "Shader.h"
+#include "MeshBuffer.h"
+
+namespace DDG
+{
+   class MarkerBuffer
+   {
+      public:
+         class Marker
+         {
+            public:
+               Marker( void );
+               // constructs a white marker of radius 1 at the origin
+
+               Vector center;   // position of the center
+               double radius;   // radius of the sphere
+               GLfloat color[4]; // diffuse color and opacity
+               GLfloat specular; // intensity of the specular highlight
+         };
+
+         MarkerBuffer( void );
+         // constructs an empty buffer (no OpenGL objects are created until
+         // markers are first drawn)
+
+         void clear( void );
+         // releases all buffer objects
+
+         void setMarkers( const std::vector<Marker>& markers );
+         // replaces the list of markers, which are drawn in the given order
+         // (and whose keys are their positions in the list)
+
+         void setMarker( int key, const Marker& marker );
+         // adds a marker with the given (nonnegative) key, or replaces the
+         // marker that already has this key
+
+         void removeMarker( int key );
+         // removes the marker with the given key, if there is one
+
+         void removeMarkers( void );
+         // removes all markers
+
+         int size( void ) const;
+         // returns the number of markers
+
+         void draw( Shader& shader );
+         // draws all markers using a shader that reads the per-instance
+         // attributes "center" (center and radius), "color", and "specular"
+
+      protected:
+         enum
+         {
+            slices = 16, // subdivisions around the axis of the sphere
+            stacks = 16, // subdivisions along the axis of the sphere
+            instanceComponents = 9 // floats per marker in instanceData
+         };
+
+         void init( void );
+         // tessellates the sphere and checks for instancing support
+
+         void storeMarker( int slot, const Marker& marker );
+         // writes a marker into instanceData
+
+         void markDirty( int slot );
+         // records that a slot of instanceData must be uploaded
+
+         MeshBuffer sphere;
+         // unit sphere shared by all markers
+
+         std::vector<GLfloat> instanceData;
+         // center, radius, color, and specular intensity of each marker
+
+         std::vector<int> slotOfKey;
+         std::vector<int> keyOfSlot;
+         // position of each marker in instanceData (-1 if a key is unused),
+         // and the key of each marker in instanceData
+
+         GLuint instanceBuffer;
+         int instanceBufferSize;
+         // buffer object holding instanceData, and its capacity (in markers)
+
+         int dirtyBegin, dirtyEnd;
+         // range of markers that changed since the last upload
+
+         bool initialized;
+         bool instancing;
+         // whether the sphere has been built, and whether instanced drawing
+         // is supported
+   };
+}
+
+#endif
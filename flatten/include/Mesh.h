@@ -38,6 +38,35 @@
 // in any edge or face) reference a dummy halfedge and can be checked via
 // the method Vertex::isIsolated().
 //
+// By default, elements are stored (and indexed) in the order they appear in
+// the input file.  Since this order is often essentially random, read() can
+// optionally renumber the mesh for locality via Mesh::reorder() -- e.g., a
+// reverse Cuthill-McKee ordering of the vertices reduces the bandwidth of
+// any matrix indexed by Vertex::index.  Faces, edges, and halfedges follow
+// the vertex order.  The original index of each vertex and face is kept so
+// that write() still produces elements in file order.
+//
+// Face and vertex normals are cached: updateNormals() computes all face
+// normals in one pass and then all vertex normals from the cached face
+// normals in a second pass.  The cached normals are only recomputed after
+// a call to invalidateNormals() (or invalidateGeometry()).
+//
+// Likewise, cotangents, face areas, and dual vertex areas -- the quantities
+// needed to build the cotan-Laplacian and the Hodge stars -- are computed
+// for the whole mesh in a single pass and stored in flat arrays.  Code that
+// moves vertices must call invalidateGeometry(), which increments
+// geometryVersion(); the cache is rebuilt the next time any of these
+// quantities is requested.  Since the rebuild happens inside const methods,
+// a mesh that is shared between threads should call updateGeometry() before
+// the threads start.
+//
+// Edits to per-vertex state that is shown on screen -- tags, highlights, and
+// winding numbers -- are recorded in a list of changed vertices for each
+// attribute (toggleVertexTag() and toggleVertexHL() do so automatically;
+// code that sets Vertex::winding must call markVertexChanged()).  A viewer
+// can then collect the changes via takeVertexChanges() and update only the
+// affected vertices, rather than redrawing everything after every click.
+//
 
 #ifndef DDG_MESH_H
 #define DDG_MESH_H
@@ -57,6 +86,14 @@ namespace DDG
    class Mesh
    {
    public:
+      enum ElementOrdering
+      {
+         fileOrder,             // order of appearance in the input file
+         cuthillMcKeeOrder,     // reverse Cuthill-McKee (small bandwidth)
+         mortonOrder,           // Morton (Z-order) curve through vertex positions
+         nestedDissectionOrder  // METIS nested dissection (via CHOLMOD)
+      };
+
       Mesh( void );
       // constructs an empty mesh
       
@@ -88,6 +125,40 @@ namespace DDG
       double meanEdgeLength( void  ) const;
       // returns mean edge lenght
 
+      void updateNormals( void );
+      // brings the cached face and vertex normals up to date; does nothing
+      // unless they have been invalidated since the last update
+
+      void invalidateNormals( void );
+      // marks all cached normals as out of date
+
+      const Vector& normal( VertexCIter v ) const;
+      const Vector& normal( FaceCIter f ) const;
+      // return the cached unit normal of a vertex or (non-boundary) face,
+      // which agrees with Vertex::normal() or Face::normal(); only valid
+      // after a call to updateNormals()
+
+      void invalidateGeometry( void );
+      // must be called whenever vertex positions change; marks all cached
+      // geometric quantities (including normals) as out of date
+
+      unsigned long geometryVersion( void ) const;
+      // returns a counter that is incremented by every call to
+      // invalidateGeometry()
+
+      void updateGeometry( void ) const;
+      // recomputes the cached cotangents and areas if they are out of date
+      // (the accessors below call this automatically)
+
+      double cotan( HalfEdgeCIter h ) const;
+      // returns the cached value of h->cotan()
+
+      double area( FaceCIter f ) const;
+      // returns the cached value of f->area()
+
+      double dualArea( VertexCIter v ) const;
+      // returns the cached value of v->area()
+
       std::vector<HalfEdge> halfedges;
       std::vector<Vertex>   vertices;
       std::vector<Edge>     edges;
@@ -95,9 +166,39 @@ namespace DDG
       std::vector<Face>     boundaries;
       // storage for mesh elements
 
+      void reorder( ElementOrdering ordering );
+      // physically permutes all mesh elements according to the given vertex
+      // ordering, remaps connectivity, and reassigns indices
+
+      ElementOrdering elementOrdering;
+      // ordering applied by read() (fileOrder by default)
+
+      std::vector<int> originalVertexIndex;
+      std::vector<int> originalFaceIndex;
+      // index of each vertex/face in the input file (empty if the
+      // elements have never been reordered)
+
       void toggleVertexTag( int );
       void toggleVertexHL( int );
 
+      enum VertexAttribute
+      {
+         vertexTag,       // Vertex::tag (and membership in taggedVertices)
+         vertexHighlight, // membership in hledVertices
+         vertexWinding,   // Vertex::winding
+         nVertexAttributes
+      };
+
+      void markVertexChanged( int index, VertexAttribute attribute );
+      // records that an attribute of the vertex with the given index changed
+
+      void takeVertexChanges( VertexAttribute attribute, std::vector<int>& changed );
+      // moves the indices of all vertices whose attribute changed since the
+      // previous call into changed (each index appears at most once)
+
+      void clearVertexChanges( void );
+      // forgets all recorded changes, e.g., after everything was redrawn
+
       std::list<int> taggedVertices;
       std::list<int> hledVertices;
       
@@ -106,6 +207,66 @@ namespace DDG
       
       void indexElements( void );
       // assigns a unique, 0-based index to each mesh element
+
+      void updateFaceNormal( int i );
+      void updateVertexNormal( int i );
+      // recompute the cached normal of the ith face or vertex
+
+      std::vector<Vector> faceNormals;
+      std::vector<Vector> vertexNormals;
+      // unit normal of each face and vertex (indexed by Face::index
+      // and Vertex::index)
+
+      bool normalsValid;
+      // false if all normals must be recomputed
+
+      std::vector<int> changedVertices[ nVertexAttributes ];
+      std::vector<bool> vertexChangeFlags[ nVertexAttributes ];
+      // vertices whose attributes changed since the changes were last taken
+
+      void updateCorners( void ) const;
+      // records which vertices each cached quantity depends on
+
+      unsigned long version;
+      mutable unsigned long cacheVersion;
+      // current geometry version and version of the cached quantities
+
+      mutable bool cornersValid;
+      // false if the connectivity arrays below must be rebuilt
+
+      mutable std::vector<int> halfedgeCorners;
+      // for each halfedge, the opposite vertex followed by the two endpoints
+      // (-1 for boundary halfedges)
+
+      mutable std::vector<int> faceCorners;
+      // the three vertices of each face
+
+      mutable std::vector<int> vertexFaceStart;
+      mutable std::vector<int> vertexFaces;
+      // (non-boundary) faces containing each vertex, in compressed-row format
+
+      mutable std::vector<double> px, py, pz;
+      // vertex coordinates
+
+      mutable std::vector<double> cotans;
+      mutable std::vector<double> faceAreas;
+      mutable std::vector<double> dualAreas;
+      // cached quantities, indexed by position in the element vectors
+
+      void orderCuthillMcKee( std::vector<int>& order ) const;
+      void orderMorton( std::vector<int>& order ) const;
+      bool orderNestedDissection( std::vector<int>& order ) const;
+      // compute a vertex ordering, where order[k] is the current
+      // index of the vertex that should become the kth vertex
+
+      void vertexAdjacency( std::vector<int>& start, std::vector<int>& neighbors ) const;
+      // builds the vertex adjacency graph in compressed-row format
+
+      void permuteElements( const std::vector<int>& vertexOrder,
+                            const std::vector<int>& edgeOrder,
+                            const std::vector<int>& faceOrder,
+                            const std::vector<int>& halfedgeOrder );
+      // rearranges element storage and remaps all references between elements
    };
 }
 
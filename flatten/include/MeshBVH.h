@@ -0,0 +1,132 @@
+// -----------------------------------------------------------------------------
+// libDDG -- MeshBVH.h
+// -----------------------------------------------------------------------------
+//
+// MeshBVH answers ray queries against a mesh -- e.g., "which vertex did the
+// user click on?" -- without any help from OpenGL.  It keeps two bounding
+// volume hierarchies, one over faces and one over vertices, so that a query
+// only visits the handful of elements near the ray rather than the whole
+// mesh.  Typical usage is
+//
+//    MeshBVH bvh;
+//    Vector origin, direction;
+//
+//    bvh.update( mesh );
+//    MeshBVH::pixelRay( x, y, modelview, projection, viewport, origin, direction );
+//    int i = bvh.pickVertex( origin, direction, .01 );
+//
+// where the matrices and viewport are those used to draw the mesh (as
+// returned by glGetDoublev() and glGetIntegerv(), though any other source
+// will do).  Since no OpenGL calls are made, the same queries can be used
+// without a window, e.g., to select vertices from a script.
+//
+// The hierarchies are built from a copy of the vertex coordinates and are
+// only rebuilt by update() if the mesh has changed since the last build:
+// a different mesh, a different number of elements, or a new value of
+// Mesh::geometryVersion().  Texture coordinates are not versioned, so code
+// that changes them while picking in texture space must call invalidate().
+//
+
+#ifndef DDG_MESHBVH_H
+#define DDG_MESHBVH_H
+
+#include <vector>
+#include "Mesh.h"
+
+namespace DDG
+{
+   class MeshBVH
+   {
+      public:
+         enum Coordinates
+         {
+            positionCoordinates, // Vertex::position
+            textureCoordinates   // Vertex::texture (e.g., a flattened mesh)
+         };
+
+         class Hit
+         {
+            public:
+               Hit( void );
+
+               int face;   // index of the face hit by the ray
+               int edge;   // index of the edge of this face closest to the hit point
+               int vertex; // index of the vertex of this face closest to the hit point
+               double t;   // distance from the ray origin to the hit point
+               Vector point; // location of the hit point
+         };
+
+         MeshBVH( void );
+         // constructs an empty hierarchy
+
+         void build( const Mesh& mesh, Coordinates coordinates = positionCoordinates );
+         // builds the hierarchies over the faces and vertices of mesh
+
+         void update( const Mesh& mesh, Coordinates coordinates = positionCoordinates );
+         // rebuilds the hierarchies only if they are out of date
+
+         void invalidate( void );
+         // forces the next call to update() to rebuild the hierarchies
+
+         bool intersect( const Vector& origin, const Vector& direction, Hit& hit ) const;
+         // finds the first face hit by the given ray; returns false if the
+         // ray misses the mesh
+
+         int pickVertex( const Vector& origin, const Vector& direction, double tolerance ) const;
+         // returns the index of the vertex closest to the ray origin among all
+         // vertices within an angle atan(tolerance) of the ray, or -1 if there
+         // is no such vertex
+
+         static void pixelRay( double x, double y,
+                               const double modelview[16],
+                               const double projection[16],
+                               const int viewport[4],
+                               Vector& origin, Vector& direction );
+         // computes the ray through window coordinates (x,y) (with y pointing
+         // up, as in OpenGL) for the given view; direction has unit length
+
+      protected:
+         class Node
+         {
+            public:
+               Vector lower, upper; // bounding box
+               int first, count;    // range of primitives (leaves only)
+               int right;           // index of the second child (the first
+                                    // child immediately follows its parent)
+         };
+
+         static int buildNodes( std::vector<Node>& nodes,
+                                std::vector<int>& order,
+                                const std::vector<Vector>& lower,
+                                const std::vector<Vector>& upper,
+                                const std::vector<Vector>& center,
+                                int first, int count );
+         // recursively builds a subtree over primitives order[first], ...,
+         // order[first+count-1]; returns the index of its root
+
+         std::vector<Node> faceNodes;
+         std::vector<Node> vertexNodes;
+         // hierarchies over faces and vertices
+
+         std::vector<Vector> corners;
+         // three corners of each face, in hierarchy order
+
+         std::vector<int> faceIndex;
+         std::vector<int> faceVertices;
+         std::vector<int> faceEdges;
+         // index of each face, of its three vertices, and of the edges
+         // opposite these vertices, in hierarchy order
+
+         std::vector<Vector> points;
+         std::vector<int> vertexIndex;
+         // location and index of each vertex, in hierarchy order
+
+         const Mesh* source;
+         Coordinates sourceCoordinates;
+         unsigned long sourceVersion;
+         bool valid;
+         // mesh and state the hierarchies were built from
+   };
+}
+
+#endif
@@ -0,0 +1,109 @@
+// -----------------------------------------------------------------------------
+// libDDG -- MeshChunks.h
+// -----------------------------------------------------------------------------
+//
+// MeshChunks splits the primitives of an index buffer (triangles or lines)
+// into small spatially coherent groups ("chunks") of a few hundred
+// primitives each, so that a viewer can skip groups that cannot be seen.
+// Every chunk stores a bounding sphere and, for triangles, a cone containing
+// the normals of all its triangles.  A chunk is invisible if its sphere lies
+// outside the view frustum, or if the cone shows that every triangle faces
+// away from the eye.  Typical usage is
+//
+//    MeshChunks chunks;
+//    chunks.build( positions, triangles, 3 );
+//    buffer.setIndices( MeshBuffer::triangles, triangles );
+//
+// when the mesh is loaded (build() reorders the primitives so that each
+// chunk occupies a contiguous range of the index buffer), and
+//
+//    vector<int> first, count;
+//    chunks.visible( transform, eye, true, first, count );
+//    buffer.draw( MeshBuffer::triangles, first, count );
+//
+// in the display callback, where transform is the product of the projection
+// and modelview matrices, and eye is the position of the eye in the same
+// coordinates as the mesh.  Ranges of adjacent visible chunks are merged
+// into a single range.
+//
+// Backface culling is only correct if the back side of the surface cannot
+// be seen, i.e., if the surface is closed; it is up to the caller to turn
+// it off otherwise.
+//
+
+#ifndef DDG_MESHCHUNKS_H
+#define DDG_MESHCHUNKS_H
+
+#include <vector>
+#include "Vector.h"
+
+namespace DDG
+{
+   class MeshChunks
+   {
+      public:
+         MeshChunks( void );
+         // constructs an empty set of chunks
+
+         void clear( void );
+         // removes all chunks
+
+         void build( const std::vector<float>& positions,
+                     std::vector<unsigned int>& indices,
+                     int verticesPerPrimitive,
+                     int primitivesPerChunk = 256 );
+         // splits the primitives into chunks, where positions holds three
+         // coordinates per vertex and each consecutive group of
+         // verticesPerPrimitive indices (3 for triangles, 2 for lines) is a
+         // primitive; the primitives in indices are reordered by chunk
+
+         int size( void ) const;
+         // returns the number of chunks
+
+         void visible( const double transform[16], const Vector& eye, bool cullBackfaces,
+                       std::vector<int>& first, std::vector<int>& count ) const;
+         // lists the ranges of the index buffer (as offsets and numbers of
+         // indices) covered by chunks that may be visible under the given
+         // column-major transformation to clip coordinates
+
+      protected:
+         class Chunk
+         {
+            public:
+               Vector center;
+               double radius;
+               // bounding sphere
+
+               Vector axis;
+               double cosAngle, sinAngle;
+               // all normals are within a given angle of the axis (cosAngle
+               // is -1 if no such cone exists or for lines)
+
+               int first, count;
+               // range of the index buffer
+         };
+
+         void split( int begin, int end );
+         // sorts primitives begin, ..., end-1 into chunks
+
+         void addChunk( int begin, int end );
+         // computes the bounds of primitives begin, ..., end-1
+
+         bool isVisible( const Chunk& c, const double planes[6][4],
+                         const Vector& eye, bool cullBackfaces ) const;
+         // checks whether a chunk might be visible
+
+         std::vector<Chunk> chunks;
+         // chunks, in the same order as the reordered index buffer
+
+         const std::vector<float>* positions;
+         const std::vector<unsigned int>* indices;
+         int nVertices;
+         int maxPrimitives;
+         std::vector<int> order;
+         std::vector<Vector> centroids;
+         // primitives and their centroids while building
+   };
+}
+
+#endif
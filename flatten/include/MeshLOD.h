@@ -0,0 +1,153 @@
+// -----------------------------------------------------------------------------
+// libDDG -- MeshLOD.h
+// -----------------------------------------------------------------------------
+//
+// MeshLOD precomputes a sequence of coarser versions ("levels of detail") of
+// a triangle mesh, so that a viewer can draw a cheap approximation while the
+// camera is moving and the full mesh once it comes to rest.  Levels are
+// built by repeatedly collapsing the edge of least quadric error (Garland
+// and Heckbert, "Surface Simplification Using Quadric Error Metrics," 1997),
+// where each collapse merges one vertex into a neighbor.  Since no new
+// vertices are ever created, every level is just a list of triangles (and
+// edges) whose corners are vertices of the original mesh: all per-vertex
+// data -- positions, normals, texture coordinates, colors -- carries over to
+// the coarse levels unchanged, and a level can be drawn from the same vertex
+// buffers as the full mesh.  Typical usage is
+//
+//    MeshLOD lod;
+//    lod.build( positions, triangles );
+//
+// after loading a mesh (where positions and triangles are laid out as in
+// MeshBuffer), and then
+//
+//    int level = lod.select( tolerance );
+//    draw( level == 0 ? triangles : lod.triangles( level ));
+//
+// to draw the coarsest level whose geometric error is at most tolerance.
+// Each level has roughly a quarter as many triangles as the previous one,
+// and level 0 always refers to the original mesh (which is not copied).
+//
+// Collapses that would flip a triangle, make the surface non-manifold, or
+// pull a boundary vertex away from the boundary are never performed, so
+// the coarsest level may have more triangles than requested.
+//
+
+#ifndef DDG_MESHLOD_H
+#define DDG_MESHLOD_H
+
+#include <vector>
+#include "Vector.h"
+
+namespace DDG
+{
+   class MeshLOD
+   {
+      public:
+         MeshLOD( void );
+         // constructs an empty hierarchy
+
+         void clear( void );
+         // removes all levels
+
+         void build( const std::vector<float>& positions,
+                     const std::vector<unsigned int>& triangles,
+                     int minTriangles = 1000 );
+         // builds coarser levels of the mesh with the given vertex positions
+         // (three coordinates per vertex) and triangles (three vertex indices
+         // per triangle), stopping once a level has at most minTriangles
+         // triangles
+
+         int levels( void ) const;
+         // returns the number of levels, including the original mesh
+
+         const std::vector<unsigned int>& triangles( int level ) const;
+         // returns the triangles of a coarse level (level > 0)
+
+         const std::vector<unsigned int>& lines( int level ) const;
+         // returns the edges of a coarse level (level > 0), as pairs of
+         // vertex indices
+
+         double error( int level ) const;
+         // returns the largest quadric error (an estimate of the distance to
+         // the original surface) of any collapse made up to this level
+
+         int select( double tolerance ) const;
+         // returns the coarsest level whose error is at most tolerance
+
+      protected:
+         class Quadric
+         // sum of squared distances to a collection of planes
+         {
+            public:
+               Quadric( void );
+               // constructs the zero quadric
+
+               void addPlane( const Vector& normal, double offset );
+               // adds the squared distance to the plane dot(normal,x) + offset = 0
+
+               void operator+=( const Quadric& q );
+               // adds another quadric
+
+               double operator()( const Vector& x ) const;
+               // evaluates the quadric at x
+
+            protected:
+               double q[10];
+               // upper triangle of the symmetric 4x4 matrix
+         };
+
+         class Collapse
+         // candidate collapse of vertex u into vertex v
+         {
+            public:
+               bool operator<( const Collapse& c ) const;
+               // orders collapses by decreasing cost (for std::priority_queue)
+
+               double cost;
+               int u, v;
+               int stampU, stampV; // stamps of u and v when the cost was computed
+         };
+
+         void neighbors( int i, std::vector<int>& n ) const;
+         // lists the vertices that share a triangle with vertex i (in
+         // increasing order)
+
+         bool bestCollapse( int a, int b, Collapse& c ) const;
+         // finds the cheaper direction in which edge ab can be collapsed;
+         // returns false if neither direction is allowed
+
+         bool canCollapse( int u, int v ) const;
+         // checks whether u can be merged into v without changing the
+         // topology of the surface or flipping any triangle
+
+         void collapse( int u, int v );
+         // merges u into v
+
+         void addLevel( double error );
+         // stores the current triangles as a new level
+
+         std::vector<Vector> position;
+         std::vector<Quadric> quadric;
+         std::vector<bool> boundary;
+         std::vector<bool> locked;
+         std::vector<bool> removed;
+         std::vector<int> stamps;
+         // per-vertex data used while building (positions, error quadrics,
+         // whether the vertex is on the boundary, whether it may not be
+         // removed, whether it has been removed, and how often its quadric
+         // has changed)
+
+         std::vector<int> corners;
+         std::vector<bool> alive;
+         std::vector< std::vector<int> > vertexTriangles;
+         int nAlive;
+         // current triangles, and the triangles around each vertex
+
+         std::vector< std::vector<unsigned int> > levelTriangles;
+         std::vector< std::vector<unsigned int> > levelLines;
+         std::vector<double> levelErrors;
+         // triangles, edges, and error of each coarse level
+   };
+}
+
+#endif
@@ -0,0 +1,77 @@
+// -----------------------------------------------------------------------------
+// libDDG -- OffscreenContext.h
+// -----------------------------------------------------------------------------
+//
+// OffscreenContext provides an OpenGL context that renders into an offscreen
+// buffer rather than a window, so that images can be produced on machines
+// without a display (e.g., batch jobs on a server).  It is implemented via
+// EGL, using Mesa's "surfaceless" platform when available so that neither X
+// nor a GPU is required.  Typical usage is
+//
+//    OffscreenContext context;
+//    if( context.create( 640, 480 ))
+//    {
+//       // draw some stuff
+//       Image image;
+//       context.read( image );
+//    }
+//
+// Offscreen rendering is only compiled in if DDG_EGL is defined (see the
+// Makefile); otherwise create() always fails.  Contexts are bound to the
+// thread that created them.
+//
+
+#ifndef DDG_OFFSCREENCONTEXT_H
+#define DDG_OFFSCREENCONTEXT_H
+
+#include "Image.h"
+
+namespace DDG
+{
+   class OffscreenContext
+   {
+      public:
+         OffscreenContext( void );
+         // constructs an empty context (no OpenGL resources are allocated)
+
+         ~OffscreenContext( void );
+         // releases the context
+
+         static bool available( void );
+         // returns true if offscreen rendering was compiled in
+
+         bool create( int width, int height );
+         // creates a context with a framebuffer of the given size and makes
+         // it current; returns false if no context could be created
+
+         void destroy( void );
+         // releases the context
+
+         void read( Image& image ) const;
+         // copies the contents of the current viewport into an image (after
+         // waiting for all drawing commands to finish); a context can hence
+         // be created once at the largest size needed and then reused for
+         // smaller images by calling glViewport()
+
+         int  width( void ) const;
+         int height( void ) const;
+         // return the framebuffer size
+
+      protected:
+         OffscreenContext( const OffscreenContext& context );
+         const OffscreenContext& operator=( const OffscreenContext& context );
+         // contexts cannot be copied
+
+         int w, h;
+         // framebuffer size
+
+         void* display;
+         void* config;
+         void* surface;
+         void* context;
+         // EGL handles (stored as void* so that this header does not
+         // depend on EGL)
+   };
+}
+
+#endif
@@ -0,0 +1,73 @@
+// -----------------------------------------------------------------------------
+// libDDG -- QuaternionBlockMatrix.h
+// -----------------------------------------------------------------------------
+//
+// QuaternionBlockMatrix is a compressed, read-only copy of a quaternionic
+// SparseMatrix used by the quaternionic linear solvers.  Each nonzero
+// quaternion stands for a 4x4 real block (see Quaternion::toMatrix()), but
+// rather than expanding it into 16 real entries with 16 row indices (as
+// SparseMatrix<Quaternion>::to_cholmod() does) the matrix is stored in block
+// compressed-row format: one column index and four doubles per block.  Block
+// products are evaluated directly via quaternion multiplication, e.g.,
+//
+//    QuaternionBlockMatrix B( A );
+//    B.multiply( x, y ); // y = A*x
+//
+// You should not normally need to build a QuaternionBlockMatrix yourself --
+// solve() and solvePositiveDefinite() do so automatically for quaternionic
+// matrices (see SparseMatrix.h).
+//
+
+#ifndef DDG_QUATERNIONBLOCKMATRIX_H
+#define DDG_QUATERNIONBLOCKMATRIX_H
+
+#include <vector>
+#include "Quaternion.h"
+#include "SparseMatrix.h"
+#include "DenseMatrix.h"
+
+namespace DDG
+{
+   class QuaternionBlockMatrix
+   {
+      public:
+         QuaternionBlockMatrix( void );
+         // constructs an empty matrix
+
+         QuaternionBlockMatrix( const SparseMatrix<Quaternion>& A );
+         // constructs a compressed copy of A
+
+         void build( const SparseMatrix<Quaternion>& A );
+         // replaces the contents with a compressed copy of A
+
+         int nRows( void ) const;
+         // returns the number of (quaternionic) rows
+
+         int nColumns( void ) const;
+         // returns the number of (quaternionic) columns
+
+         int nBlocks( void ) const;
+         // returns the number of nonzero blocks
+
+         void multiply( const DenseMatrix<Quaternion>& x, DenseMatrix<Quaternion>& y ) const;
+         // computes y = A*x
+
+         void multiplyAdjoint( const DenseMatrix<Quaternion>& x, DenseMatrix<Quaternion>& y ) const;
+         // computes y = A^* x, where A^* is the conjugate transpose of A
+
+         void diagonalInverse( DenseMatrix<Quaternion>& d ) const;
+         // sets d(i) to the inverse of the diagonal block A(i,i), or to
+         // one if that block is zero (used as a Jacobi preconditioner)
+
+      protected:
+         int m, n;
+         std::vector<int> rowStart;
+         std::vector<int> columnIndex;
+         std::vector<Quaternion> blocks;
+         // nonzero blocks of row i are blocks[rowStart[i]..rowStart[i+1]-1],
+         // located in columns columnIndex[rowStart[i]..rowStart[i+1]-1]
+   };
+}
+
+#endif
+
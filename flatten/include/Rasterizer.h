@@ -0,0 +1,210 @@
+// -----------------------------------------------------------------------------
+// libDDG -- Rasterizer.h
+// -----------------------------------------------------------------------------
+//
+// Rasterizer draws triangles and lines into an image entirely on the CPU, so
+// that pictures of a mesh can be made on machines without any OpenGL driver
+// (e.g., batch jobs on a render farm).  It mimics the small part of OpenGL
+// used by Viewer: vertex arrays with an index list, a modelview and
+// projection matrix, a depth buffer, polygon offset, alpha blending, and the
+// shading model of shaders/fragment.glsl.  Typical usage is
+//
+//    Rasterizer r;
+//    r.resize( 640, 480 );
+//    r.setView( modelview, projection );
+//    r.setLighting( eye, light );
+//    r.clear( Vector( .5, .5, .5 ));
+//    r.drawTriangles( positions, normals, colors, 3, triangles );
+//    r.drawLines( positions, colors, 4, lines, 1. );
+//
+//    Image image;
+//    r.read( image );
+//
+// where the arrays hold one position, normal, and color per vertex as in
+// MeshBuffer::setStream(), and matrices are column-major as returned by
+// glGetDoublev().
+//
+// Each draw call transforms and clips its primitives, sorts them into
+// square tiles of the image ("binning"), and then rasterizes the tiles
+// independently, one tile per thread at a time.  Within a tile primitives
+// are drawn in the order they were given, so images do not depend on the
+// number of threads.  Coverage is determined by exact edge functions on a
+// subpixel grid (evaluated several pixels at a time with SSE2/AVX when
+// available), which guarantees that triangles sharing an edge neither
+// overlap nor leave gaps.
+//
+
+#ifndef DDG_RASTERIZER_H
+#define DDG_RASTERIZER_H
+
+#include <vector>
+#include "Vector.h"
+#include "Image.h"
+
+namespace DDG
+{
+   class Rasterizer
+   {
+      public:
+         Rasterizer( void );
+         // constructs an empty (0x0) framebuffer
+
+         void resize( int width, int height );
+         // sets the framebuffer size (the contents are undefined until the
+         // next call to clear())
+
+         int  width( void ) const;
+         int height( void ) const;
+         // return the framebuffer size
+
+         void setThreads( int n );
+         // sets the number of threads used per draw call; zero (the default)
+         // uses one thread per processor
+
+         void setView( const double modelview[16], const double projection[16] );
+         // sets the transformation from object coordinates to clip coordinates
+
+         void setLighting( const Vector& eye, const Vector& light );
+         // sets the eye and light positions (in object coordinates) used to
+         // shade triangles
+
+         void setDepthOffset( double factor, double units );
+         // offsets the depth of triangles as in glPolygonOffset()
+
+         void clear( const Vector& color );
+         // fills the framebuffer with the given color and the maximum depth
+
+         void drawTriangles( const std::vector<float>& positions,
+                             const std::vector<float>& normals,
+                             const std::vector<float>& colors, int colorComponents,
+                             const std::vector<unsigned int>& indices );
+         // draws shaded triangles, where each consecutive triple of indices
+         // refers to the three corners of a triangle
+
+         void drawLines( const std::vector<float>& positions,
+                         const std::vector<float>& colors, int colorComponents,
+                         const std::vector<unsigned int>& indices,
+                         double lineWidth );
+         // draws unshaded lines of the given width (in pixels), where each
+         // pair of indices refers to the endpoints of a line; colors with four
+         // components are alpha-blended with the framebuffer
+
+         void read( Image& image ) const;
+         // copies the framebuffer into an image (in the same layout as
+         // glReadPixels() with GL_BGR)
+
+      protected:
+         enum
+         {
+            tileSize = 64,   // width and height of a tile, in pixels
+            nAttributes = 10 // color (4), normal (3), and position (3)
+         };
+
+         class ClipVertex
+         // vertex in homogeneous clip coordinates
+         {
+            public:
+               double x, y, z, w;
+               float attributes[ nAttributes ];
+         };
+
+         class Primitive
+         // triangle in window coordinates, ready to be rasterized
+         {
+            public:
+               double x[3], y[3];  // position (snapped to the subpixel grid)
+               float z[3];         // depth in [0,1]
+               float invW[3];      // reciprocal of clip w
+               float attributes[3][ nAttributes ]; // attributes divided by clip w
+         };
+
+         class DrawCall
+         // state shared by all primitives of a single draw call
+         {
+            public:
+               const std::vector<float>* positions;
+               const std::vector<float>* normals;
+               const std::vector<float>* colors;
+               int colorComponents;
+               const std::vector<unsigned int>* indices;
+               int verticesPerPrimitive; // 3 (triangles) or 2 (lines)
+               double lineWidth;
+               bool shaded;
+               bool blended;
+               double offsetFactor, offsetUnits;
+         };
+
+         void draw( const DrawCall& call );
+         // transforms, bins, and rasterizes all primitives of a draw call
+
+         static void transformVertices( void* rasterizer, int task );
+         static void setupPrimitives( void* rasterizer, int task );
+         static void rasterizeTile( void* rasterizer, int tile );
+         // the three stages of draw(), each of which runs as parallel tasks
+
+         int clip( ClipVertex* polygon, int n ) const;
+         // clips a polygon against the near plane and a guard band around
+         // the viewport; returns the number of vertices left
+
+         bool clipLine( ClipVertex& a, ClipVertex& b ) const;
+         // clips a line segment in the same way; returns false if nothing
+         // is left
+
+         void project( const ClipVertex& c, Primitive& p, int corner,
+                       double dx = 0., double dy = 0. ) const;
+         // converts a clip-space vertex into a corner of a primitive, moved
+         // by (dx,dy) pixels
+
+         void addPrimitive( const Primitive& p, int task );
+         // stores a primitive and adds it to the bins of all tiles it overlaps
+
+         void rasterize( const Primitive& p, int x0, int y0, int x1, int y1 );
+         // draws the pixels of p inside [x0,x1) x [y0,y1)
+
+         void shade( const DrawCall& call, const float* attributes, float* color ) const;
+         // computes the color of a fragment from its interpolated attributes
+
+         int nThreads( void ) const;
+         // returns the number of threads to use
+
+         int w, h;
+         // framebuffer size
+
+         int tilesX, tilesY;
+         // number of tiles along each axis
+
+         std::vector<float> colorBuffer;
+         std::vector<float> depthBuffer;
+         // color (three components per pixel) and depth of each pixel
+
+         int threads;
+         // requested number of threads (zero for one per processor)
+
+         double transform[16];
+         // projection times modelview
+
+         Vector eye, light;
+         // eye and light positions in object coordinates
+
+         double offsetFactor, offsetUnits;
+         // polygon offset
+
+         const DrawCall* current;
+         // draw call being processed
+
+         int nTasks;
+         // number of setup tasks in the current draw call
+
+         std::vector<ClipVertex> clipVertices;
+         // transformed vertices of the current draw call
+
+         std::vector< std::vector<Primitive> > primitives;
+         // primitives produced by each setup task
+
+         std::vector< std::vector< std::vector<int> > > bins;
+         // bins[task][tile] lists the primitives produced by a setup task
+         // that overlap a tile, in order
+   };
+}
+
+#endif
@@ -0,0 +1,69 @@
+// -----------------------------------------------------------------------------
+// libDDG -- ScratchAllocator.h
+// -----------------------------------------------------------------------------
+//
+// ScratchAllocator supplies the memory allocation routines used by SuiteSparse
+// (and hence by every cholmod_sparse, cholmod_dense, and cholmod_factor).  By
+// default each request is simply passed on to malloc().  Once a memory budget
+// has been set, however, any large block that would push the total amount of
+// memory allocated from the heap past the budget is instead backed by a
+// memory-mapped scratch file.  In particular, the numerical values of a large
+// supernodal factor (which CHOLMOD stores as one contiguous array of dense
+// panels) end up on disk, and the operating system pages panels in and out as
+// the factorization and the forward/back solves sweep through them.  Problems
+// whose factor exceeds physical memory can therefore still be solved (albeit
+// at the speed of the scratch disk) rather than failing.
+//
+// The allocator is installed automatically by LinearContext; the budget and
+// scratch directory are normally set via LinearContext::setMemoryBudget()
+// and LinearContext::setScratchDirectory().
+//
+
+#ifndef DDG_SCRATCHALLOCATOR_H
+#define DDG_SCRATCHALLOCATOR_H
+
+#include <cstddef>
+#include <string>
+#include <cholmod.h>
+
+namespace DDG
+{
+   class ScratchAllocator
+   {
+      public:
+         static void install( cholmod_common* common );
+         // makes SuiteSparse allocate memory through ScratchAllocator (must
+         // be called right after cholmod_l_start(), before any allocation)
+
+         static void setBudget( size_t bytes );
+         // sets the maximum number of bytes allocated from the heap before
+         // large blocks are placed in scratch files (zero means no limit)
+
+         static size_t budget( void );
+         // returns the current budget
+
+         static void setDirectory( const std::string& path );
+         // sets the directory where scratch files are created
+
+         static size_t heapBytes( void );
+         // returns the number of bytes currently allocated from the heap
+
+         static size_t scratchBytes( void );
+         // returns the number of bytes currently stored in scratch files
+
+         static size_t peakScratchBytes( void );
+         // returns the largest number of bytes ever stored in scratch files
+
+         static void* allocate( size_t size );
+         static void* allocateZero( size_t count, size_t size );
+         static void* reallocate( void* p, size_t size );
+         static void release( void* p );
+         // replacements for malloc, calloc, realloc, and free
+
+      protected:
+         static void* allocateBlock( size_t size, bool zero );
+         static void* mapBlock( size_t length );
+   };
+}
+
+#endif
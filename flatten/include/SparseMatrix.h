@@ -70,6 +70,11 @@ namespace DDG
          cholmod_sparse* to_cholmod( void );
          // returns pointer to copy of matrix in compressed-column CHOLMOD format
 
+         cholmod_sparse* to_cholmod_upper( void );
+         // returns pointer to copy of the upper triangle in compressed-column
+         // CHOLMOD format, flagged as symmetric (stype=1); the lower triangle
+         // is implied by (conjugate) symmetry, so only half the entries are stored
+
          SparseMatrix<T> operator*( const SparseMatrix<T>& B ) const;
          // returns product of this matrix with sparse B
 
@@ -146,6 +151,7 @@ namespace DDG
          EntryMap data;
          cholmod_sparse* cData;
 
+         cholmod_sparse* compress( bool upperOnly );
          void allocateSparse( void );
          void setEntry( const_iterator e, int i, double* pr );
    };
@@ -174,23 +180,56 @@ namespace DDG
          ~SparseFactor( void );
 
          void build( SparseMatrix<T>& A );
-         // factorizes positive-definite matrix A using CHOLMOD
+         // factorizes positive-definite matrix A using CHOLMOD (factors larger
+         // than the memory budget are kept in scratch files -- see
+         // LinearContext::setMemoryBudget())
+
+         void refactor( SparseMatrix<T>& A );
+         // factorizes A reusing the fill-reducing ordering and symbolic analysis
+         // of the previous build(); A must have the same nonzero pattern as before
 
          bool valid( void ) const;
          // returns true if the factor has been built; false otherwise
 
+         bool mixedPrecision( void ) const;
+         // returns true if the factor is stored in single precision, in which
+         // case solves use double-precision iterative refinement (see
+         // LinearContext::setMixedPrecision())
+
+         void promote( void );
+         // refactors in double precision (used when refinement stalls)
+
+         cholmod_sparse* matrix( void );
+         // returns the double-precision matrix that was factored (upper
+         // triangle only; available for mixed-precision factors only)
+
          cholmod_factor* to_cholmod( void );
          // returns pointer to underlying cholmod_factor data structure
 
       protected:
+         void clear( void );
+         // frees the factor and matrix
+
          cholmod_factor *L;
+         cholmod_sparse *A;
    };
 
+   cholmod_factor* factorSinglePrecision( cholmod_sparse* A, cholmod_factor* L );
+   // factors the (double-precision, symmetric) matrix A in single precision,
+   // reusing the symbolic analysis in L if L is non-NULL; returns NULL if
+   // the linked CHOLMOD cannot factor in single precision
+
+   cholmod_dense* refineSolution( cholmod_sparse* A, cholmod_factor* L, cholmod_dense* b, bool& converged );
+   // solves Ax = b in double precision using the single-precision factor L of A
+   // and iterative refinement; converged is false if refinement stalls
+
    template <class T>
    void solve( SparseMatrix<T>& A,
                 DenseMatrix<T>& x,
                 DenseMatrix<T>& b );
    // solves the sparse linear system Ax = b using sparse QR factorization
+   // (quaternionic systems are solved in the least-squares sense via CGLS,
+   // falling back to QR of the real expansion if CGLS does not converge)
 
    template <class T>
    void solveSymmetric( SparseMatrix<T>& A,
@@ -203,6 +242,9 @@ namespace DDG
                                 DenseMatrix<T>& x,
                                 DenseMatrix<T>& b );
    // solves the positive definite sparse linear system Ax = b using sparse Cholesky factorization
+   // (in single precision plus iterative refinement if LinearContext::setMixedPrecision() is on;
+   // quaternionic systems use block conjugate gradients -- see QuaternionBlockMatrix.h --
+   // falling back to Cholesky on the real expansion if they do not converge)
 
    template <class T>
    void backsolvePositiveDefinite( SparseFactor<T>& L,
@@ -238,6 +280,14 @@ namespace DDG
    // solves A x = lambda B x for the smallest nonzero eigenvalue lambda
    // A must be positive (semi-)definite, B must be symmetric; x is used as an initial guess
 
+   template <class T>
+   void smallestEigPositiveDefinite( SparseFactor<T>& L,
+                                     SparseMatrix<T>& A,
+                                     SparseMatrix<T>& B,
+                                      DenseMatrix<T>& x );
+   // same as above, but uses a prefactored L (see SparseFactor::build()); iterations
+   // stop early once x converges, so a good initial guess needs only one or two
+
    template <class T>
    void smallestEigPositiveDefinite( SparseMatrix<T>& A,
                                      SparseMatrix<T>& B,
@@ -11,6 +11,7 @@
 
 #include <cholmod.h>
 #include <map>
+#include <utility>
 #include <vector>
 
 namespace DDG
@@ -43,8 +44,9 @@ namespace DDG
    class SparseMatrix;
    
    // convenience types for iterators
-   typedef std::map<Variable*,double>::iterator            TermIter;
-   typedef std::map<Variable*,double>::const_iterator     TermCIter;
+   typedef std::pair<Variable*,double>                    LinearTerm;
+   typedef LinearTerm*                                      TermIter;
+   typedef const LinearTerm*                               TermCIter;
    typedef std::vector<LinearPolynomial>::iterator         PolyIter;
    typedef std::vector<LinearPolynomial>::const_iterator  PolyCIter;
    typedef std::vector<LinearEquation>::iterator            EqnIter;
@@ -2,6 +2,8 @@
 #define DDG_UTILITY_H
 
 #include <cstdlib>
+#include <ctime>
+#include <sys/time.h>
 #include "Utility.h"
 #include "Complex.h"
 
@@ -23,6 +25,21 @@ namespace DDG
    {
       return (double)(t1-t0) / (double) CLOCKS_PER_SEC;
    }
+
+   inline double wallClock( void )
+   // returns the current wall-clock time in seconds; unlike clock(), the
+   // difference between two calls includes time spent in every thread
+   {
+      timeval t;
+      gettimeofday( &t, NULL );
+      return (double) t.tv_sec + 1e-6 * (double) t.tv_usec;
+   }
+
+   inline double seconds( double t0, double t1 )
+   // returns the elapsed time between two calls to wallClock()
+   {
+      return t1-t0;
+   }
 }
 
 namespace DDGConstants
@@ -34,6 +34,11 @@
 //
 // The "fixed" flag in a variable refers to whether it is held constant while
 // solving a system of equations -- see the documentation for further discussion.
+//
+// Every variable also receives a unique integer id when it is constructed
+// (copies get a new id).  Ids are handed out consecutively, which lets
+// LinearSystem look up the variables of a system in a flat table covering
+// just the range of ids it uses.
 // 
 
 #ifndef DDG_VARIABLE_H
@@ -52,6 +57,12 @@ namespace DDG
          Variable( std::string name, double value = 0., bool fixed = false );
          // initialize a named variable which has value zero and is not fixed by default
 
+         Variable( const Variable& v );
+         // copies the name, value, and fixed flag of v; the copy gets a new id
+
+         const Variable& operator=( const Variable& v );
+         // copies the name, value, and fixed flag of v; the id is unchanged
+
          double& operator*( void );
          // returns a reference to the numerical value
 
@@ -66,6 +77,9 @@ namespace DDG
 
          bool fixed;
          // true if a variable is held constant while solving a system of equations
+
+         unsigned int id;
+         // unique id, assigned at construction (wraps around after 2^32 variables)
    };
 }
 
@@ -6,6 +6,49 @@
 // interacting with a Mesh object.  Viewer methods are static in order
 // to make them compatible with GLUT callbacks.
 //
+// Processing the mesh does not block the GUI: the solve runs on a worker
+// thread (see SolverQueue.h) using a private copy of the mesh, and its
+// results are copied into Viewer::mesh -- and the display list rebuilt --
+// only once the solve has completed.  Progress is shown in the window title,
+// and a running solve can be cancelled from the menu.  Results are discarded
+// if the mesh was edited or reset while the solve was running.
+//
+// The mesh is drawn from vertex buffer objects (see MeshBuffer.h) that are
+// only updated when the data they hold changes: geometry when the mesh is
+// loaded, colors when the color scheme changes, and the vector field when
+// it is recomputed.  Toggling display options does not upload any data at
+// all.  Markers on tagged and highlighted vertices are drawn from a single
+// sphere in one instanced call (see MarkerBuffer.h); when a vertex is
+// tagged, highlighted, or has its winding number changed, the mesh records
+// the change (see Mesh::markVertexChanged()) and the next frame updates
+// only the markers of the vertices involved, so editing takes the same time
+// on any size of mesh.
+//
+// Large meshes are also simplified into a few coarser levels of detail when
+// they are loaded (see MeshLOD.h).  While the camera is moving, the surface
+// and wireframe are drawn from the coarsest level whose error is below
+// about a pixel on screen; once the camera comes to rest, the full mesh is
+// drawn again.  Coarse levels reuse the vertex buffers of the full mesh, so
+// colors and other per-vertex data need no extra work.
+//
+// To avoid drawing parts of the mesh that are off screen (e.g., when
+// zoomed in on a large scan), the surface, wireframe, and vector field are
+// split into chunks of a few hundred primitives (see MeshChunks.h).  Every
+// frame, only chunks that intersect the view frustum are drawn; chunks of a
+// closed surface that face away from the eye are skipped as well.
+//
+// Vertices are picked by casting a ray from the camera through the cursor
+// into a bounding volume hierarchy over the mesh (see MeshBVH.h), which is
+// only rebuilt when the mesh changes.
+//
+// Viewer can also render without a window: renderOffscreen() draws each of
+// a list of RenderJobs (mesh, view options, camera, and image size) into an
+// offscreen context (see OffscreenContext.h) and writes the result to a TGA
+// file.  Since Viewer state is static and an OpenGL context belongs to a
+// single thread, jobs are rendered in parallel by forked worker processes.
+// Where OpenGL is not available, the same pictures are drawn by a software
+// rasterizer (see Rasterizer.h).
+//
 
 #ifndef DDG_VIEWER_H
 #define DDG_VIEWER_H
@@ -14,14 +57,66 @@
 #include "Mesh.h"
 #include "Camera.h"
 #include "Shader.h"
+#include "SolverQueue.h"
+#include "MeshBuffer.h"
+#include "MarkerBuffer.h"
+#include "MeshBVH.h"
+#include "MeshLOD.h"
+#include "MeshChunks.h"
+#include "OffscreenContext.h"
+#include "Rasterizer.h"
 
 namespace DDG
 {
+   class RenderJob
+   // describes a single image rendered by Viewer::renderOffscreen()
+   {
+   public:
+      enum ColorMode
+      {
+         plainColors,          // uniform surface color
+         quasiConformalColors, // quasi-conformal distortion
+         potentialColors       // Vertex::potential
+      };
+
+      RenderJob( void );
+      // constructs a job with the default view (3D, plain colors, initial
+      // camera, 512x512 pixels)
+
+      std::string input;
+      std::string output;
+      // mesh file to render and image file to write
+
+      bool process;
+      std::vector<int> tags;
+      // run Application::run() on the mesh before rendering, with the given
+      // vertices (numbered as in the input file) tagged; meshes with boundary
+      // are flattened, closed meshes need tags
+
+      bool render3D;
+      bool wireframe;
+      bool vectorField;
+      ColorMode colors;
+      // view options (same as in the interactive viewer)
+
+      Quaternion rotation;
+      double zoom;
+      // camera state (see Camera::rLast and Camera::zoom)
+
+      int width, height;
+      // image size
+   };
+
    class Viewer
    {
    public:
       static void init( void );
       // displays the viewer until the program ends
+
+      static bool renderOffscreen( const std::vector<RenderJob>& jobs, int nWorkers = 1, bool software = false );
+      // renders each job without a window, using the given number of
+      // worker processes; returns false if any job failed.  Jobs are drawn
+      // in software if requested or if OpenGL is not available
       
       static Mesh mesh;
       // surface mesh visualized by Viewer
@@ -43,6 +138,7 @@ namespace DDG
       
       // menu functions
       static void mProcess( void );
+      static void mCancel( void );
       static void mResetMesh( void );
       static void mWriteMesh( void );
       static void mExit( void );
@@ -50,6 +146,7 @@ namespace DDG
       static void mRender3D( void );
       static void mTaggedVertices( void );
       static void mQuasiConformal( void );
+      static void mPotential( void );
       static void mVectorField( void );
       static void mZoomIn( void );
       static void mZoomOut( void );
@@ -62,6 +159,7 @@ namespace DDG
       enum
       {
          menuProcess,
+         menuCancel,
          menuResetMesh,
          menuWriteMesh,
          menuExit,
@@ -69,6 +167,7 @@ namespace DDG
          menuRender3D,
          menuTaggedVertices,
          menuQuasiConformal,
+         menuPotential,
          menuVectorField,
          menuZoomIn,
          menuZoomOut,
@@ -82,21 +181,64 @@ namespace DDG
       static void setGL( void );
       static void setLighting( void );
       static void setMeshMaterial( void );
-      static void callDisplayList( void );
-      static void updateDisplayList( void );
+      static void drawSurface( void );
       static void drawScene( void );
-      static void drawPolygons( void );
+      static void drawFrame( void );
+      static void drawFrame( Rasterizer& rasterizer );
       static void drawTriangles( void );
       static void drawVectorField( void );
       static void drawWireframe( void );
-      static void drawVertices( void );
       static void drawSelectedVertices( void );
       static void drawIsolatedVertices( void );
 
+      // buffer updates
+      static void updateBuffers( void );
+      static void updateGeometry( bool buildLevels );
+      // (simplified levels are only built if buildLevels is true)
+      static void updateColors( void );
+      static void updateTexture( void );
+      static void updateFaceSurface( void );
+      static void updateVectorField( void );
+      static void updateMarkers( void );
+      static void updateChangedMarkers( void );
+      static void updateVertexMarkers( int index );
+
+      // buffer contents
+      static void buildGeometry( std::vector<GLfloat>& positions,
+                                 std::vector<GLfloat>& normals,
+                                 std::vector<GLfloat>& texture,
+                                 std::vector<GLuint>& triangles,
+                                 std::vector<GLuint>& lines,
+                                 std::vector<GLuint>& points );
+      static void buildColors( std::vector<GLfloat>& colors );
+      static void buildFaceGeometry( std::vector<GLfloat>& positions,
+                                     std::vector<GLfloat>& normals,
+                                     std::vector<GLfloat>& texture,
+                                     std::vector<GLfloat>& colors,
+                                     std::vector<GLuint>& triangles );
+      static void buildVectorField( std::vector<GLfloat>& positions,
+                                    std::vector<GLfloat>& colors,
+                                    std::vector<GLuint>& lines );
+
+      static int lodLevel( void );
+      // returns the level of detail at which to draw the surface
+
+      static void visibleChunks( const MeshChunks& chunks, bool cullBackfaces,
+                                 std::vector<int>& first, std::vector<int>& count );
+      // lists the index ranges of chunks visible from the current camera
+
       static int getMouseVertexID(int x, int y);
       static void pickVertex(int x, int y);
       static void hlVertex(int x, int y);
+
+      // offscreen rendering
+      static bool renderJobs( const std::vector<RenderJob>& jobs, int first, int stride,
+                              bool software, int nThreads );
+      static bool renderJob( const RenderJob& job, OffscreenContext* context, Rasterizer& rasterizer );
       
+      static void updateWindowTitle( void );
+      // shows the progress of the current solve (if any) in the title bar
+
       static void storeViewerState( void );
       static void restoreViewerState( void );
       static int windowSize[2];
@@ -104,6 +246,9 @@ namespace DDG
       static bool renderQuasiConformal;
       // draw quasi conformal error
 
+      static bool renderPotential;
+      // color vertices by potential
+
       static bool render3D;
       // draw 3D or 2D
 
@@ -119,17 +264,69 @@ namespace DDG
       static Camera camera;
       // keeps track of view state
       
-      static GLuint surfaceDL;
-      // display list for mesh
+      static MeshBuffer surface;
+      // vertex buffers for mesh
+
+      static MeshBuffer faceSurface;
+      // vertex buffers for mesh with separate vertices for each triangle,
+      // so that faces can be colored by quasi conformal distortion
+
+      static MeshBuffer field;
+      // vertex buffers for vector field
+
+      static MarkerBuffer markers;
+      static MarkerBuffer highlights;
+      // spheres drawn at tagged and highlighted vertices (keyed by vertex index)
+
+      static MeshBVH picker;
+      // used to find the vertex under the cursor
+
+      static MeshLOD lod;
+      // coarse versions of the surface, drawn while the camera moves
+
+      static MeshChunks surfaceChunks;
+      static MeshChunks wireframeChunks;
+      static MeshChunks fieldChunks;
+      static MeshChunks faceChunks;
+      // spatial chunks of the triangles, edges, vector field, and separate
+      // triangles, used to skip parts of the mesh that cannot be seen
+
+      static bool faceSurfaceCurrent;
+      // whether faceSurface holds the current geometry (it is only built
+      // once quasi conformal distortion is shown)
+
+      static bool jobGeometryCurrent;
+      // whether the offscreen buffers already hold the geometry (and vector
+      // field) of the mesh loaded for the current render job
+
+      static bool closedSurface;
+      // whether the mesh is closed and oriented outward, so that triangles
+      // facing away from the eye are always hidden
       
       static Shader shader;
       // shader used to determine appearance of surface
 
+      static Shader markerShader;
+      // shader used to draw markers
+
+      static SolverQueue solver;
+      // runs mesh processing in the background
+
+      static int meshRevision;
+      // incremented whenever the mesh is edited or reset, so that results
+      // computed from an outdated copy of the mesh can be detected
+
+      static std::string windowTitle;
+      // current contents of the title bar
+
+      friend class ProcessTask;
+
    };
 
    // methods to viz quasi conformal error
    double faceQCDistortion( FaceCIter f );
    Vector qcColor( double qc );
+   Vector potentialColor( double s );
    Vector HSV(double h, double s, double v);
    double quasiConformalDistortion( Vector p1, Vector p2, Vector p3,
                                     Vector q1, Vector q2, Vector q3 );
@@ -0,0 +1,6 @@
+varying vec4 markerColor;
+
+void main()
+{
+   gl_FragColor = markerColor;
+}
@@ -0,0 +1,19 @@
+attribute vec4 center;
+attribute vec4 color;
+attribute float specular;
+varying vec4 markerColor;
+
+void main()
+{
+   vec4 position = vec4( center.xyz + center.w * gl_Vertex.xyz, 1. );
+   gl_Position = gl_ModelViewProjectionMatrix * position;
+
+   vec3 N = normalize( gl_NormalMatrix * gl_Normal );
+   vec3 L = normalize( gl_LightSource[0].position.xyz );
+   vec3 H = normalize( L + vec3( 0., 0., 1. ));
+   float NL = max( 0., dot( N, L ));
+   float NH = NL > 0. ? pow( max( 0., dot( N, H )), 16. ) : 0.;
+
+   markerColor.rgb = NL * color.rgb + specular * NH * vec3( 1., 1., 1. );
+   markerColor.a = color.a;
+}
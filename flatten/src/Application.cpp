@@ -3,15 +3,22 @@ using namespace std;
 
 #include "Application.h"
 #include "Quaternion.h"
+#include "SolverQueue.h"
 
 namespace DDG
 {
    // public
-   void Application::run(Mesh& mesh)
+   Application::Application()
+   : flattenVertexCount(0),
+     flattenFaceCount(0)
+   {}
+
+   void Application::run(Mesh& mesh, SolverTask* task)
    {
       if (not mesh.boundaries.empty())
       {
-         std::cout << "Mesh has boundary" << std::endl;
+         if (task) task->setProgress(0.0, "flattening");
+         flatten(mesh);
          return;
       }
 
@@ -21,8 +28,15 @@ namespace DDG
          return;
       }
 
+      if (task) task->setProgress(0.0, "balancing winding numbers");
       balanceWinding(mesh);
+      if (task and task->cancelled()) return;
+
+      if (task) task->setProgress(0.1, "solving for connection");
       solveForConnection(mesh);
+      if (task and task->cancelled()) return;
+
+      if (task) task->setProgress(0.9, "transporting vector field");
       transportVectorField(mesh);
    }
 
@@ -195,16 +209,28 @@ namespace DDG
       // build energy
       buildEnergy(mesh, Lc);
 
-      // compute the solution;
-      DenseMatrix<Complex> x(V,1);
-      x.randomize();
-
       SparseMatrix<Complex> star0;
       HodgeStar0Form<Complex>::build(mesh, star0);
 
       Lc += Complex(1E-8) * star0;
 
-      smallestEigPositiveDefinite<Complex>(Lc, star0, x);
+      // compute the solution, starting from the previous one (and reusing
+      // the previous ordering) if the connectivity has not changed
+      DenseMatrix<Complex> x(V,1);
+      if ( sameTopology(mesh) && flattenFactor.valid() )
+      {
+         x = flattenSolution;
+         flattenFactor.refactor(Lc);
+      }
+      else
+      {
+         x.randomize();
+         flattenFactor.build(Lc);
+         storeTopology(mesh);
+      }
+
+      smallestEigPositiveDefinite<Complex>(flattenFactor, Lc, star0, x);
+      flattenSolution = x;
 
       // then assign the solution
       assignSolution(x, mesh);
@@ -227,7 +253,7 @@ namespace DDG
       {
          if ( it->onBoundary ) continue;
 
-         Complex half_half_cot = Complex(it->cotan() / 4.);
+         Complex half_half_cot = Complex(mesh.cotan(it) / 4.);
          int i = it->vertex->index;
          int j = it->next->vertex->index;
          A(i,i) += half_half_cot;
@@ -258,6 +284,32 @@ namespace DDG
       }
    }
 
+   bool Application::sameTopology(const Mesh& mesh) const
+   {
+      if ( flattenVertexCount != (int) mesh.vertices.size() ) return false;
+      if ( flattenFaceCount != (int) mesh.faces.size() ) return false;
+      if ( flattenTopology.size() != mesh.halfedges.size() ) return false;
+
+      for ( size_t i = 0; i < mesh.halfedges.size(); i++ )
+      {
+         if ( flattenTopology[i] != mesh.halfedges[i].vertex->index ) return false;
+      }
+
+      return true;
+   }
+
+   void Application::storeTopology(const Mesh& mesh)
+   {
+      flattenVertexCount = mesh.vertices.size();
+      flattenFaceCount = mesh.faces.size();
+      flattenTopology.resize( mesh.halfedges.size() );
+
+      for ( size_t i = 0; i < mesh.halfedges.size(); i++ )
+      {
+         flattenTopology[i] = mesh.halfedges[i].vertex->index;
+      }
+   }
+
    void Application::assignSolution(const DenseMatrix<Complex>& x, Mesh& mesh)
    {
       for( VertexIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v ++ )
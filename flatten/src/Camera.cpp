@@ -13,7 +13,8 @@ namespace DDG
         pLast( 1. ),
         rLast( 1. ),
      momentum( 1. ),
-         zoom( 1. )
+         zoom( 1. ),
+        vZoom( 0. )
    {}
    
    Quaternion Camera :: clickToSphere( int x, int y )
@@ -47,6 +48,15 @@ namespace DDG
    }
 
    void Camera :: setView( void ) const
+   {
+      GLdouble M[16];
+      viewMatrix( M );
+
+      glMatrixMode( GL_MODELVIEW );
+      glMultMatrixd( M );
+   }
+
+   void Camera :: viewMatrix( double M[16] ) const
    {
       Quaternion r = ( pDrag * pClick.conj() ) * rLast;
 
@@ -55,15 +65,14 @@ namespace DDG
       double y = r[2];
       double z = r[3];
 
-      GLdouble M[16] = {
+      const double R[16] = {
          1.-2.*y*y-2.*z*z, 2.*x*y+2.*w*z, 2.*x*z-2.*w*y, 0.,
          2.*x*y-2.*w*z, 1.-2.*x*x-2.*z*z, 2.*y*z+2.*w*x, 0.,
          2.*x*z+2.*w*y, 2.*y*z-2.*w*x, 1.-2.*x*x-2.*y*y, 0.,
          0., 0., 0., 1.
       };
 
-      glMatrixMode( GL_MODELVIEW );
-      glMultMatrixd( M );
+      for( int i = 0; i < 16; i++ ) M[i] = R[i];
    }
 
    void Camera :: mouse( int button, int state, int x, int y )
@@ -115,6 +124,15 @@ namespace DDG
       t0 = t1;
    }
 
+   bool Camera :: moving( void ) const
+   {
+      // momentum and zoom velocity decay exponentially, so they are
+      // considered zero once the motion per frame is imperceptible
+      return ( pDrag - pClick ).norm() > 0. ||
+             momentum.im().norm() > 1e-4 ||
+             fabs( vZoom ) > 1e-3;
+   }
+
    void Camera :: zoomIn( void )
    {
       vZoom -= 0.5;
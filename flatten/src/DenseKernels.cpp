@@ -0,0 +1,416 @@
+#include "DenseKernels.h"
+
+#if defined( __AVX512F__ ) || defined( __AVX__ ) || defined( __SSE3__ )
+#include <immintrin.h>
+#endif
+
+namespace DDG
+{
+   static inline void hamilton( const double* p, const double* q, double* r )
+   // r = p*q (Hamilton product of quaternions stored as r,i,j,k)
+   {
+      r[0] = p[0]*q[0] - p[1]*q[1] - p[2]*q[2] - p[3]*q[3];
+      r[1] = p[0]*q[1] + p[1]*q[0] + p[2]*q[3] - p[3]*q[2];
+      r[2] = p[0]*q[2] - p[1]*q[3] + p[2]*q[0] + p[3]*q[1];
+      r[3] = p[0]*q[3] + p[1]*q[2] - p[2]*q[1] + p[3]*q[0];
+   }
+
+#if defined( __AVX__ )
+   static inline __m256d fmadd256( __m256d a, __m256d b, __m256d c )
+   // returns a*b+c
+   {
+#if defined( __FMA__ )
+      return _mm256_fmadd_pd( a, b, c );
+#else
+      return _mm256_add_pd( _mm256_mul_pd( a, b ), c );
+#endif
+   }
+
+   static inline __m256d complexMul256( __m256d ar, __m256d ai, __m256d x )
+   // multiplies two interleaved complex numbers x by the scalar ar+ai*i
+   {
+      __m256d t = _mm256_mul_pd( ai, _mm256_permute_pd( x, 0x5 ));
+#if defined( __FMA__ )
+      return _mm256_fmaddsub_pd( ar, x, t );
+#else
+      return _mm256_addsub_pd( _mm256_mul_pd( ar, x ), t );
+#endif
+   }
+#endif
+
+#if defined( __SSE3__ )
+   static inline __m128d complexMul128( __m128d ar, __m128d ai, __m128d x )
+   // multiplies a complex number x by the scalar ar+ai*i
+   {
+      __m128d t = _mm_mul_pd( ai, _mm_shuffle_pd( x, x, 1 ));
+      return _mm_addsub_pd( _mm_mul_pd( ar, x ), t );
+   }
+#endif
+
+   double realSumSquares( int n, const double* x )
+   // returns the sum of squares of the n entries of x
+   {
+      int i = 0;
+      double sum = 0.;
+
+#if defined( __AVX512F__ )
+      __m512d acc0 = _mm512_setzero_pd();
+      __m512d acc1 = _mm512_setzero_pd();
+      for( ; i+16 <= n; i += 16 )
+      {
+         __m512d u = _mm512_loadu_pd( x+i   );
+         __m512d v = _mm512_loadu_pd( x+i+8 );
+         acc0 = _mm512_fmadd_pd( u, u, acc0 );
+         acc1 = _mm512_fmadd_pd( v, v, acc1 );
+      }
+      double s[8];
+      _mm512_storeu_pd( s, _mm512_add_pd( acc0, acc1 ));
+      sum += (( s[0] + s[1] ) + ( s[2] + s[3] )) + (( s[4] + s[5] ) + ( s[6] + s[7] ));
+#elif defined( __AVX__ )
+      __m256d acc0 = _mm256_setzero_pd();
+      __m256d acc1 = _mm256_setzero_pd();
+      for( ; i+8 <= n; i += 8 )
+      {
+         __m256d u = _mm256_loadu_pd( x+i   );
+         __m256d v = _mm256_loadu_pd( x+i+4 );
+         acc0 = fmadd256( u, u, acc0 );
+         acc1 = fmadd256( v, v, acc1 );
+      }
+      double s[4];
+      _mm256_storeu_pd( s, _mm256_add_pd( acc0, acc1 ));
+      sum += ( s[0] + s[1] ) + ( s[2] + s[3] );
+#elif defined( __SSE3__ )
+      __m128d acc = _mm_setzero_pd();
+      for( ; i+2 <= n; i += 2 )
+      {
+         __m128d u = _mm_loadu_pd( x+i );
+         acc = _mm_add_pd( acc, _mm_mul_pd( u, u ));
+      }
+      double s[2];
+      _mm_storeu_pd( s, acc );
+      sum += s[0] + s[1];
+#endif
+
+      for( ; i < n; i++ )
+      {
+         sum += x[i]*x[i];
+      }
+
+      return sum;
+   }
+
+   void realAxpy( int n, double a, const double* x, double* y )
+   // y += a*x for real arrays of length n
+   {
+      int i = 0;
+
+#if defined( __AVX512F__ )
+      __m512d va = _mm512_set1_pd( a );
+      for( ; i+8 <= n; i += 8 )
+      {
+         _mm512_storeu_pd( y+i, _mm512_fmadd_pd( va, _mm512_loadu_pd( x+i ), _mm512_loadu_pd( y+i )));
+      }
+#elif defined( __AVX__ )
+      __m256d va = _mm256_set1_pd( a );
+      for( ; i+4 <= n; i += 4 )
+      {
+         _mm256_storeu_pd( y+i, fmadd256( va, _mm256_loadu_pd( x+i ), _mm256_loadu_pd( y+i )));
+      }
+#elif defined( __SSE3__ )
+      __m128d va = _mm_set1_pd( a );
+      for( ; i+2 <= n; i += 2 )
+      {
+         _mm_storeu_pd( y+i, _mm_add_pd( _mm_loadu_pd( y+i ), _mm_mul_pd( va, _mm_loadu_pd( x+i ))));
+      }
+#endif
+
+      for( ; i < n; i++ )
+      {
+         y[i] += a*x[i];
+      }
+   }
+
+   void complexAxpy( int n, const double a[2], const double* x, double* y )
+   // y += a*x for complex arrays of length n
+   {
+      int i = 0;
+
+#if defined( __AVX512F__ )
+      __m512d ar = _mm512_set1_pd( a[0] );
+      __m512d ai = _mm512_set1_pd( a[1] );
+      for( ; i+4 <= n; i += 4 )
+      {
+         __m512d u = _mm512_loadu_pd( x+2*i );
+         __m512d t = _mm512_mul_pd( ai, _mm512_shuffle_pd( u, u, 0x55 ));
+         __m512d p = _mm512_fmaddsub_pd( ar, u, t );
+         _mm512_storeu_pd( y+2*i, _mm512_add_pd( _mm512_loadu_pd( y+2*i ), p ));
+      }
+#elif defined( __AVX__ )
+      __m256d ar = _mm256_set1_pd( a[0] );
+      __m256d ai = _mm256_set1_pd( a[1] );
+      for( ; i+2 <= n; i += 2 )
+      {
+         __m256d p = complexMul256( ar, ai, _mm256_loadu_pd( x+2*i ));
+         _mm256_storeu_pd( y+2*i, _mm256_add_pd( _mm256_loadu_pd( y+2*i ), p ));
+      }
+#elif defined( __SSE3__ )
+      __m128d ar = _mm_set1_pd( a[0] );
+      __m128d ai = _mm_set1_pd( a[1] );
+      for( ; i < n; i++ )
+      {
+         __m128d p = complexMul128( ar, ai, _mm_loadu_pd( x+2*i ));
+         _mm_storeu_pd( y+2*i, _mm_add_pd( _mm_loadu_pd( y+2*i ), p ));
+      }
+#endif
+
+      for( ; i < n; i++ )
+      {
+         const double* u = x+2*i;
+               double* v = y+2*i;
+         v[0] += a[0]*u[0] - a[1]*u[1];
+         v[1] += a[0]*u[1] + a[1]*u[0];
+      }
+   }
+
+   void complexScale( int n, const double a[2], double* x )
+   // x *= a for a complex array of length n
+   {
+      int i = 0;
+
+#if defined( __AVX512F__ )
+      __m512d ar = _mm512_set1_pd( a[0] );
+      __m512d ai = _mm512_set1_pd( a[1] );
+      for( ; i+4 <= n; i += 4 )
+      {
+         __m512d u = _mm512_loadu_pd( x+2*i );
+         __m512d t = _mm512_mul_pd( ai, _mm512_shuffle_pd( u, u, 0x55 ));
+         _mm512_storeu_pd( x+2*i, _mm512_fmaddsub_pd( ar, u, t ));
+      }
+#elif defined( __AVX__ )
+      __m256d ar = _mm256_set1_pd( a[0] );
+      __m256d ai = _mm256_set1_pd( a[1] );
+      for( ; i+2 <= n; i += 2 )
+      {
+         _mm256_storeu_pd( x+2*i, complexMul256( ar, ai, _mm256_loadu_pd( x+2*i )));
+      }
+#elif defined( __SSE3__ )
+      __m128d ar = _mm_set1_pd( a[0] );
+      __m128d ai = _mm_set1_pd( a[1] );
+      for( ; i < n; i++ )
+      {
+         _mm_storeu_pd( x+2*i, complexMul128( ar, ai, _mm_loadu_pd( x+2*i )));
+      }
+#endif
+
+      for( ; i < n; i++ )
+      {
+         double* u = x+2*i;
+         double re = a[0]*u[0] - a[1]*u[1];
+         double im = a[0]*u[1] + a[1]*u[0];
+         u[0] = re;
+         u[1] = im;
+      }
+   }
+
+   static void complexProducts( int n, const double* x, const double* y, double s[4] )
+   // accumulates the four real sums from which the Hermitian product is
+   // assembled:
+   //    s[0] = sum xr*yr,  s[1] = sum xi*yi,
+   //    s[2] = sum xr*yi,  s[3] = sum xi*yr
+   {
+      int i = 0;
+      s[0] = s[1] = s[2] = s[3] = 0.;
+
+#if defined( __AVX512F__ )
+      __m512d acc0 = _mm512_setzero_pd();
+      __m512d acc1 = _mm512_setzero_pd();
+      for( ; i+4 <= n; i += 4 )
+      {
+         __m512d u = _mm512_loadu_pd( x+2*i );
+         __m512d v = _mm512_loadu_pd( y+2*i );
+         acc0 = _mm512_fmadd_pd( u, v, acc0 );
+         acc1 = _mm512_fmadd_pd( u, _mm512_shuffle_pd( v, v, 0x55 ), acc1 );
+      }
+      double t0[8], t1[8];
+      _mm512_storeu_pd( t0, acc0 );
+      _mm512_storeu_pd( t1, acc1 );
+      for( int k = 0; k < 8; k += 2 )
+      {
+         s[0] += t0[k]; s[1] += t0[k+1];
+         s[2] += t1[k]; s[3] += t1[k+1];
+      }
+#elif defined( __AVX__ )
+      __m256d acc0 = _mm256_setzero_pd();
+      __m256d acc1 = _mm256_setzero_pd();
+      for( ; i+2 <= n; i += 2 )
+      {
+         __m256d u = _mm256_loadu_pd( x+2*i );
+         __m256d v = _mm256_loadu_pd( y+2*i );
+         acc0 = fmadd256( u, v, acc0 );
+         acc1 = fmadd256( u, _mm256_permute_pd( v, 0x5 ), acc1 );
+      }
+      double t0[4], t1[4];
+      _mm256_storeu_pd( t0, acc0 );
+      _mm256_storeu_pd( t1, acc1 );
+      s[0] = t0[0] + t0[2]; s[1] = t0[1] + t0[3];
+      s[2] = t1[0] + t1[2]; s[3] = t1[1] + t1[3];
+#elif defined( __SSE3__ )
+      __m128d acc0 = _mm_setzero_pd();
+      __m128d acc1 = _mm_setzero_pd();
+      for( ; i < n; i++ )
+      {
+         __m128d u = _mm_loadu_pd( x+2*i );
+         __m128d v = _mm_loadu_pd( y+2*i );
+         acc0 = _mm_add_pd( acc0, _mm_mul_pd( u, v ));
+         acc1 = _mm_add_pd( acc1, _mm_mul_pd( u, _mm_shuffle_pd( v, v, 1 )));
+      }
+      double t0[2], t1[2];
+      _mm_storeu_pd( t0, acc0 );
+      _mm_storeu_pd( t1, acc1 );
+      s[0] = t0[0]; s[1] = t0[1];
+      s[2] = t1[0]; s[3] = t1[1];
+#endif
+
+      for( ; i < n; i++ )
+      {
+         const double* u = x+2*i;
+         const double* v = y+2*i;
+         s[0] += u[0]*v[0];
+         s[1] += u[1]*v[1];
+         s[2] += u[0]*v[1];
+         s[3] += u[1]*v[0];
+      }
+   }
+
+   void complexInner( int n, const double* x, const double* y, double r[2] )
+   // r = sum_i conj(x_i) y_i (Hermitian inner product)
+   {
+      double s[4];
+      complexProducts( n, x, y, s );
+      r[0] = s[0] + s[1];
+      r[1] = s[2] - s[3];
+   }
+
+   void quaternionAxpy( int n, const double a[4], const double* x, double* y )
+   // y += a*x for quaternion arrays of length n (a multiplies from the left)
+   {
+      int i = 0;
+
+#if defined( __AVX__ )
+      // columns of the 4x4 matrix representing left multiplication by a
+      __m256d c[4];
+      for( int k = 0; k < 4; k++ )
+      {
+         double e[4] = { 0., 0., 0., 0. }, q[4];
+         e[k] = 1.;
+         hamilton( a, e, q );
+         c[k] = _mm256_loadu_pd( q );
+      }
+      for( ; i < n; i++ )
+      {
+         const double* u = x+4*i;
+         __m256d v = _mm256_loadu_pd( y+4*i );
+         v = fmadd256( c[0], _mm256_broadcast_sd( u+0 ), v );
+         v = fmadd256( c[1], _mm256_broadcast_sd( u+1 ), v );
+         v = fmadd256( c[2], _mm256_broadcast_sd( u+2 ), v );
+         v = fmadd256( c[3], _mm256_broadcast_sd( u+3 ), v );
+         _mm256_storeu_pd( y+4*i, v );
+      }
+#endif
+
+      for( ; i < n; i++ )
+      {
+         double q[4];
+         hamilton( a, x+4*i, q );
+         for( int k = 0; k < 4; k++ )
+         {
+            y[4*i+k] += q[k];
+         }
+      }
+   }
+
+   void quaternionScale( int n, const double a[4], double* x )
+   // x *= a for a quaternion array of length n (a multiplies from the right)
+   {
+      int i = 0;
+
+#if defined( __AVX__ )
+      // columns of the 4x4 matrix representing right multiplication by a
+      __m256d c[4];
+      for( int k = 0; k < 4; k++ )
+      {
+         double e[4] = { 0., 0., 0., 0. }, q[4];
+         e[k] = 1.;
+         hamilton( e, a, q );
+         c[k] = _mm256_loadu_pd( q );
+      }
+      for( ; i < n; i++ )
+      {
+         const double* u = x+4*i;
+         __m256d v = _mm256_mul_pd( c[0], _mm256_broadcast_sd( u+0 ));
+         v = fmadd256( c[1], _mm256_broadcast_sd( u+1 ), v );
+         v = fmadd256( c[2], _mm256_broadcast_sd( u+2 ), v );
+         v = fmadd256( c[3], _mm256_broadcast_sd( u+3 ), v );
+         _mm256_storeu_pd( x+4*i, v );
+      }
+#endif
+
+      for( ; i < n; i++ )
+      {
+         double q[4];
+         hamilton( x+4*i, a, q );
+         for( int k = 0; k < 4; k++ )
+         {
+            x[4*i+k] = q[k];
+         }
+      }
+   }
+
+   void quaternionInner( int n, const double* x, const double* y, double r[4] )
+   // r = sum_i conj(x_i) y_i (quaternionic Hermitian inner product)
+   {
+      // accumulate the 4x4 matrix of component products M(j,k) = sum_i x_ij y_ik,
+      // from which the (bilinear) product conj(x)*y is assembled at the end
+      double M[4][4] = { { 0., 0., 0., 0. },
+                         { 0., 0., 0., 0. },
+                         { 0., 0., 0., 0. },
+                         { 0., 0., 0., 0. } };
+      int i = 0;
+
+#if defined( __AVX__ )
+      __m256d acc[4];
+      for( int j = 0; j < 4; j++ )
+      {
+         acc[j] = _mm256_setzero_pd();
+      }
+      for( ; i < n; i++ )
+      {
+         const double* u = x+4*i;
+         __m256d v = _mm256_loadu_pd( y+4*i );
+         acc[0] = fmadd256( _mm256_broadcast_sd( u+0 ), v, acc[0] );
+         acc[1] = fmadd256( _mm256_broadcast_sd( u+1 ), v, acc[1] );
+         acc[2] = fmadd256( _mm256_broadcast_sd( u+2 ), v, acc[2] );
+         acc[3] = fmadd256( _mm256_broadcast_sd( u+3 ), v, acc[3] );
+      }
+      for( int j = 0; j < 4; j++ )
+      {
+         _mm256_storeu_pd( M[j], acc[j] );
+      }
+#endif
+
+      for( ; i < n; i++ )
+      {
+         for( int j = 0; j < 4; j++ )
+         for( int k = 0; k < 4; k++ )
+         {
+            M[j][k] += x[4*i+j] * y[4*i+k];
+         }
+      }
+
+      r[0] = M[0][0] + M[1][1] + M[2][2] + M[3][3];
+      r[1] = M[0][1] - M[1][0] - M[2][3] + M[3][2];
+      r[2] = M[0][2] - M[2][0] - M[3][1] + M[1][3];
+      r[3] = M[0][3] - M[3][0] - M[1][2] + M[2][1];
+   }
+}
+
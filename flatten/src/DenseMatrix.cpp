@@ -1,7 +1,35 @@
 #include "DenseMatrix.h"
+#include "DenseKernels.h"
+#include "BLAS.h"
 
 namespace DDG
 {
+   const int minBLASProductSize = 4096;
+   // products with fewer than this many multiply-adds are computed
+   // inline, since the BLAS call overhead would dominate
+
+   template <class T>
+   static bool isSmallProduct( const DenseMatrix<T>& A, const DenseMatrix<T>& B )
+   {
+      return (double) A.nRows() * (double) A.nColumns() * (double) B.nColumns() < minBLASProductSize;
+   }
+
+   template <class T>
+   static void multiplyInline( const DenseMatrix<T>& A, const DenseMatrix<T>& B, DenseMatrix<T>& AB )
+   // AB += A*B using a plain triple loop
+   {
+      for( int j = 0; j < B.nColumns(); j++ )
+      for( int k = 0; k < A.nColumns(); k++ )
+      {
+         T Bkj = B( k, j );
+
+         for( int i = 0; i < A.nRows(); i++ )
+         {
+            AB( i, j ) += A( i, k ) * Bkj;
+         }
+      }
+   }
+
    template <>
    cholmod_dense* DenseMatrix<Real> :: to_cholmod( void )
    // returns pointer to underlying cholmod_dense data structure
@@ -314,5 +342,342 @@ namespace DDG
          }
       }
    }
-}
 
+   template <>
+   DenseMatrix<Real> DenseMatrix<Real> :: operator*( const DenseMatrix<Real>& B ) const
+   // returns product of this matrix with B
+   {
+      const DenseMatrix<Real>& A( *this );
+
+      // make sure matrix dimensions agree
+      assert( A.nColumns() == B.nRows() );
+
+      DenseMatrix<Real> AB( A.nRows(), B.nColumns() );
+
+      if( isSmallProduct( A, B ))
+      {
+         multiplyInline( A, B, AB );
+         return AB;
+      }
+
+      int M = A.nRows();
+      int N = B.nColumns();
+      int K = A.nColumns();
+      int inc = 1;
+      double alpha = 1.;
+      double beta = 0.;
+      const double* a = (const double*) A.entries();
+      const double* b = (const double*) B.entries();
+            double* c = (double*) AB.entries();
+
+      if( N == 1 )
+      {
+         dgemv_( "N", &M, &K, &alpha, a, &M, b, &inc, &beta, c, &inc );
+      }
+      else
+      {
+         dgemm_( "N", "N", &M, &N, &K, &alpha, a, &M, b, &K, &beta, c, &M );
+      }
+
+      return AB;
+   }
+
+   template <>
+   void DenseMatrix<Real> :: operator+=( const DenseMatrix<Real>& B )
+   {
+      // make sure matrix dimensions agree
+      assert( m == B.m );
+      assert( n == B.n );
+
+      int N = m*n;
+      int inc = 1;
+      double alpha = 1.;
+      daxpy_( &N, &alpha, (const double*) B.entries(), &inc, (double*) entries(), &inc );
+   }
+
+   template <>
+   void DenseMatrix<Real> :: operator-=( const DenseMatrix<Real>& B )
+   {
+      // make sure matrix dimensions agree
+      assert( m == B.m );
+      assert( n == B.n );
+
+      int N = m*n;
+      int inc = 1;
+      double alpha = -1.;
+      daxpy_( &N, &alpha, (const double*) B.entries(), &inc, (double*) entries(), &inc );
+   }
+
+   template <>
+   void DenseMatrix<Real> :: operator*=( const Real& c )
+   {
+      int N = m*n;
+      int inc = 1;
+      double alpha = c;
+      dscal_( &N, &alpha, (double*) entries(), &inc );
+   }
+
+   template <>
+   double DenseMatrix<Real> :: norm( NormType type ) const
+   {
+      if( type == lTwo )
+      {
+         int N = m*n;
+         int inc = 1;
+         return N > 0 ? dnrm2_( &N, (const double*) entries(), &inc ) : 0.;
+      }
+
+      double r = 0.;
+      for( int i = 0; i < m*n; i++ )
+      {
+         if( type == lInfinity ) r = max( r, data[i].norm() );
+         else                    r += data[i].norm();
+      }
+      return r;
+   }
+
+   template <>
+   Real DenseMatrix<Real> :: sum( void ) const
+   // returns the sum of all entries
+   {
+      // dot product with a constant vector of ones (stride zero)
+      int N = m*n;
+      int inc = 1;
+      int incOne = 0;
+      double one = 1.;
+      return N > 0 ? ddot_( &N, (const double*) entries(), &inc, &one, &incOne ) : 0.;
+   }
+
+   template <>
+   void DenseMatrix<Real> :: removeMean( void )
+   {
+      int N = m*n;
+      if( N == 0 ) return;
+
+      // subtract the mean times a constant vector of ones (stride zero)
+      int inc = 1;
+      int incOne = 0;
+      double one = 1.;
+      double minusMean = -sum() / (double) N;
+      daxpy_( &N, &minusMean, &one, &incOne, (double*) entries(), &inc );
+   }
+
+   template <>
+   Real dot( const DenseMatrix<Real>& x, const DenseMatrix<Real>& y )
+   // returns Euclidean inner product of x and y
+   {
+      return inner( x, y );
+   }
+
+   template <>
+   Real inner( const DenseMatrix<Real>& x, const DenseMatrix<Real>& y )
+   // standard inner product
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      int N = x.nRows()*x.nColumns();
+      int inc = 1;
+      return N > 0 ? ddot_( &N, (const double*) x.entries(), &inc, (const double*) y.entries(), &inc ) : 0.;
+   }
+
+   template <>
+   void axpy( const Real& a, const DenseMatrix<Real>& x, DenseMatrix<Real>& y )
+   // computes y += a*x
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      int N = x.nRows()*x.nColumns();
+      int inc = 1;
+      double alpha = a;
+      daxpy_( &N, &alpha, (const double*) x.entries(), &inc, (double*) y.entries(), &inc );
+   }
+
+   template <>
+   DenseMatrix<Complex> DenseMatrix<Complex> :: operator*( const DenseMatrix<Complex>& B ) const
+   // returns product of this matrix with B
+   {
+      const DenseMatrix<Complex>& A( *this );
+
+      // make sure matrix dimensions agree
+      assert( A.nColumns() == B.nRows() );
+
+      DenseMatrix<Complex> AB( A.nRows(), B.nColumns() );
+
+      if( isSmallProduct( A, B ))
+      {
+         multiplyInline( A, B, AB );
+         return AB;
+      }
+
+      int M = A.nRows();
+      int N = B.nColumns();
+      int K = A.nColumns();
+      int inc = 1;
+      double alpha[2] = { 1., 0. };
+      double beta[2] = { 0., 0. };
+      const double* a = (const double*) A.entries();
+      const double* b = (const double*) B.entries();
+            double* c = (double*) AB.entries();
+
+      if( N == 1 )
+      {
+         zgemv_( "N", &M, &K, alpha, a, &M, b, &inc, beta, c, &inc );
+      }
+      else
+      {
+         zgemm_( "N", "N", &M, &N, &K, alpha, a, &M, b, &K, beta, c, &M );
+      }
+
+      return AB;
+   }
+
+   template <>
+   void DenseMatrix<Complex> :: operator+=( const DenseMatrix<Complex>& B )
+   {
+      // make sure matrix dimensions agree
+      assert( m == B.m );
+      assert( n == B.n );
+
+      realAxpy( 2*m*n, 1., (const double*) B.entries(), (double*) entries() );
+   }
+
+   template <>
+   void DenseMatrix<Complex> :: operator-=( const DenseMatrix<Complex>& B )
+   {
+      // make sure matrix dimensions agree
+      assert( m == B.m );
+      assert( n == B.n );
+
+      realAxpy( 2*m*n, -1., (const double*) B.entries(), (double*) entries() );
+   }
+
+   template <>
+   void DenseMatrix<Complex> :: operator*=( const Complex& c )
+   {
+      complexScale( m*n, &c.re, (double*) entries() );
+   }
+
+   template <>
+   double DenseMatrix<Complex> :: norm( NormType type ) const
+   {
+      if( type == lTwo )
+      {
+         return sqrt( realSumSquares( 2*m*n, (const double*) entries() ));
+      }
+
+      double r = 0.;
+      for( int i = 0; i < m*n; i++ )
+      {
+         if( type == lInfinity ) r = max( r, data[i].norm() );
+         else                    r += data[i].norm();
+      }
+      return r;
+   }
+
+   template <>
+   Complex dot( const DenseMatrix<Complex>& x, const DenseMatrix<Complex>& y )
+   // returns Euclidean inner product of x and y
+   {
+      return inner( x, y );
+   }
+
+   template <>
+   Complex inner( const DenseMatrix<Complex>& x, const DenseMatrix<Complex>& y )
+   // standard inner product
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      Complex sum;
+      int N = x.nRows()*x.nColumns();
+      complexInner( N, (const double*) x.entries(), (const double*) y.entries(), &sum.re );
+      return sum;
+   }
+
+   template <>
+   void axpy( const Complex& a, const DenseMatrix<Complex>& x, DenseMatrix<Complex>& y )
+   // computes y += a*x
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      int N = x.nRows()*x.nColumns();
+      complexAxpy( N, &a.re, (const double*) x.entries(), (double*) y.entries() );
+   }
+
+   template <>
+   void DenseMatrix<Quaternion> :: operator+=( const DenseMatrix<Quaternion>& B )
+   {
+      // make sure matrix dimensions agree
+      assert( m == B.m );
+      assert( n == B.n );
+
+      realAxpy( 4*m*n, 1., (const double*) B.entries(), (double*) entries() );
+   }
+
+   template <>
+   void DenseMatrix<Quaternion> :: operator-=( const DenseMatrix<Quaternion>& B )
+   {
+      // make sure matrix dimensions agree
+      assert( m == B.m );
+      assert( n == B.n );
+
+      realAxpy( 4*m*n, -1., (const double*) B.entries(), (double*) entries() );
+   }
+
+   template <>
+   void DenseMatrix<Quaternion> :: operator*=( const Quaternion& c )
+   {
+      quaternionScale( m*n, &c[0], (double*) entries() );
+   }
+
+   template <>
+   double DenseMatrix<Quaternion> :: norm( NormType type ) const
+   {
+      if( type == lTwo )
+      {
+         return sqrt( realSumSquares( 4*m*n, (const double*) entries() ));
+      }
+
+      double r = 0.;
+      for( int i = 0; i < m*n; i++ )
+      {
+         if( type == lInfinity ) r = max( r, data[i].norm() );
+         else                    r += data[i].norm();
+      }
+      return r;
+   }
+
+   template <>
+   Quaternion dot( const DenseMatrix<Quaternion>& x, const DenseMatrix<Quaternion>& y )
+   // returns Euclidean inner product of x and y
+   {
+      return inner( x, y );
+   }
+
+   template <>
+   Quaternion inner( const DenseMatrix<Quaternion>& x, const DenseMatrix<Quaternion>& y )
+   // standard inner product
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      Quaternion sum;
+      int N = x.nRows()*x.nColumns();
+      quaternionInner( N, (const double*) x.entries(), (const double*) y.entries(), &sum[0] );
+      return sum;
+   }
+
+   template <>
+   void axpy( const Quaternion& a, const DenseMatrix<Quaternion>& x, DenseMatrix<Quaternion>& y )
+   // computes y += a*x
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      int N = x.nRows()*x.nColumns();
+      quaternionAxpy( N, &a[0], (const double*) x.entries(), (double*) y.entries() );
+   }
+}
@@ -6,8 +6,10 @@
 using namespace std;
 
 #include "DenseMatrix.h"
+#include "Complex.h"
 #include "LinearContext.h"
 #include "Quaternion.h"
+#include "Real.h"
 #include "SparseMatrix.h"
 #include "Utility.h"
 
@@ -106,13 +108,7 @@ namespace DDG
    template <class T>
    void DenseMatrix<T> :: operator/=( const T& c )
    {
-      DenseMatrix<T>& A( *this );
-
-      for( int i = 0; i < m; i++ )
-      for( int j = 0; j < n; j++ )
-      {
-         A(i,j) *= c.inv();
-      }
+      *this *= c.inv();
    }
 
    template <class T>
@@ -325,6 +321,18 @@ namespace DDG
       return data[index];
    }
 
+   template <class T>
+   T* DenseMatrix<T> :: entries( void )
+   {
+      return data.empty() ? NULL : &data[0];
+   }
+
+   template <class T>
+   const T* DenseMatrix<T> :: entries( void ) const
+   {
+      return data.empty() ? NULL : &data[0];
+   }
+
    template <class T>
    T DenseMatrix<T>::sum( void ) const
    // returns the sum of all entries
@@ -365,6 +373,19 @@ namespace DDG
       return ( x.transpose() * y )(0);
    }
 
+   template <class T>
+   void axpy( const T& a, const DenseMatrix<T>& x, DenseMatrix<T>& y )
+   // computes y += a*x
+   {
+      assert( x.nRows()    == y.nRows() &&
+              x.nColumns() == y.nColumns() );
+
+      for( int i = 0; i < x.nRows()*x.nColumns(); i++ )
+      {
+         y(i) += a * x(i);
+      }
+   }
+
    template <class T>
    DenseMatrix<T> DenseMatrix<T>::operator-( void ) const
    // returns additive inverse of this matrix
@@ -421,5 +442,39 @@ namespace DDG
 
       return sum;
    }
+
+   // real and complex matrices dispatch dense products and (for real
+   // entries) level-1 operations to the linked BLAS (see DenseMatrix.cpp)
+   template <> DenseMatrix<Real> DenseMatrix<Real> :: operator*( const DenseMatrix<Real>& B ) const;
+   template <> void DenseMatrix<Real> :: operator+=( const DenseMatrix<Real>& B );
+   template <> void DenseMatrix<Real> :: operator-=( const DenseMatrix<Real>& B );
+   template <> void DenseMatrix<Real> :: operator*=( const Real& c );
+   template <> double DenseMatrix<Real> :: norm( NormType type ) const;
+   template <> Real DenseMatrix<Real> :: sum( void ) const;
+   template <> void DenseMatrix<Real> :: removeMean( void );
+   template <> Real dot( const DenseMatrix<Real>& x, const DenseMatrix<Real>& y );
+   template <> Real inner( const DenseMatrix<Real>& x, const DenseMatrix<Real>& y );
+   template <> void axpy( const Real& a, const DenseMatrix<Real>& x, DenseMatrix<Real>& y );
+
+   template <> DenseMatrix<Complex> DenseMatrix<Complex> :: operator*( const DenseMatrix<Complex>& B ) const;
+
+   // complex and quaternionic entries are stored contiguously, so the
+   // following operations are implemented with the vectorized loops
+   // in DenseKernels.h (see DenseMatrix.cpp)
+   template <> void DenseMatrix<Complex> :: operator+=( const DenseMatrix<Complex>& B );
+   template <> void DenseMatrix<Complex> :: operator-=( const DenseMatrix<Complex>& B );
+   template <> void DenseMatrix<Complex> :: operator*=( const Complex& c );
+   template <> double DenseMatrix<Complex> :: norm( NormType type ) const;
+   template <> Complex dot( const DenseMatrix<Complex>& x, const DenseMatrix<Complex>& y );
+   template <> Complex inner( const DenseMatrix<Complex>& x, const DenseMatrix<Complex>& y );
+   template <> void axpy( const Complex& a, const DenseMatrix<Complex>& x, DenseMatrix<Complex>& y );
+
+   template <> void DenseMatrix<Quaternion> :: operator+=( const DenseMatrix<Quaternion>& B );
+   template <> void DenseMatrix<Quaternion> :: operator-=( const DenseMatrix<Quaternion>& B );
+   template <> void DenseMatrix<Quaternion> :: operator*=( const Quaternion& c );
+   template <> double DenseMatrix<Quaternion> :: norm( NormType type ) const;
+   template <> Quaternion dot( const DenseMatrix<Quaternion>& x, const DenseMatrix<Quaternion>& y );
+   template <> Quaternion inner( const DenseMatrix<Quaternion>& x, const DenseMatrix<Quaternion>& y );
+   template <> void axpy( const Quaternion& a, const DenseMatrix<Quaternion>& x, DenseMatrix<Quaternion>& y );
 }
 
@@ -17,7 +17,7 @@ namespace DDG
                        v ++ )
       {
          int i = v->index;
-         star0( i, i ) = v->area();
+         star0( i, i ) = mesh.dualArea( v );
       }
    }
 
@@ -36,8 +36,8 @@ namespace DDG
                      e ++ )
       {
          // get the cotangents of the two angles opposite this edge
-         double cotAlpha = e->he->cotan();
-         double cotBeta  = e->he->flip->cotan();
+         double cotAlpha = mesh.cotan( e->he );
+         double cotBeta  = mesh.cotan( e->he->flip );
 
          int i = e->index;
          star1( i, i ) = ( cotAlpha + cotBeta ) / 2.;
@@ -59,7 +59,7 @@ namespace DDG
                      f ++ )
       {
          int i = f->index;
-         star2( i, i ) = 1. / f->area();
+         star2( i, i ) = 1. / mesh.area( f );
       }
    }
 
@@ -1,25 +1,471 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+using namespace std;
+
+#include <SuiteSparseQR.hpp>
 #include "LinearContext.h"
+#include "ScratchAllocator.h"
+
+// thread-count setters of the common BLAS and OpenMP runtimes; they are
+// declared weak, so each is null unless that library is linked in
+extern "C"
+{
+   void openblas_set_num_threads( int n ) __attribute__(( weak ));
+   void MKL_Set_Num_Threads( int n ) __attribute__(( weak ));
+   void omp_set_num_threads( int n ) __attribute__(( weak ));
+}
 
 namespace DDG
 {
    // global context for linear solvers
    LinearContext context;
 
+   struct ThreadCommon
+   // per-thread instance, along with the context that owns it
+   {
+      cholmod_common common;
+      LinearContext* owner;
+      int version; // version of the shared settings last copied into common
+   };
+
+   static void copySettings( const cholmod_common& from, cholmod_common& to )
+   // copies solver settings (but no workspace or statistics)
+   {
+      to.dbound = from.dbound;
+      to.grow0 = from.grow0;
+      to.grow1 = from.grow1;
+      to.grow2 = from.grow2;
+      to.maxrank = from.maxrank;
+      to.supernodal_switch = from.supernodal_switch;
+      to.supernodal = from.supernodal;
+      to.final_asis = from.final_asis;
+      to.final_super = from.final_super;
+      to.final_ll = from.final_ll;
+      to.final_pack = from.final_pack;
+      to.final_monotonic = from.final_monotonic;
+      to.final_resymbol = from.final_resymbol;
+      to.nmethods = from.nmethods;
+      to.postorder = from.postorder;
+      to.print = from.print;
+      for( int k = 0; k <= CHOLMOD_MAXMETHODS; k++ )
+      {
+         to.method[k] = from.method[k];
+      }
+      to.SPQR_grain = from.SPQR_grain;
+      to.SPQR_small = from.SPQR_small;
+      to.SPQR_shrink = from.SPQR_shrink;
+      to.SPQR_nthreads = from.SPQR_nthreads;
+#ifdef CHOLMOD_VER_CODE
+#if CHOLMOD_VERSION >= CHOLMOD_VER_CODE(3,0)
+      to.useGPU = from.useGPU;
+#endif
+#endif
+   }
+
+   static void setThreadVariable( const char* name, int n )
+   // sets (or, if n is zero, clears) an environment variable
+   // controlling the number of threads used by a library
+   {
+      if( n > 0 )
+      {
+         stringstream value;
+         value << n;
+         setenv( name, value.str().c_str(), 1 );
+      }
+      else
+      {
+         unsetenv( name );
+      }
+   }
+
    LinearContext :: LinearContext( void )
    // constructor
    {
       cholmod_l_start( &context );
+      ScratchAllocator::install( &context );
+
+      // always use a supernodal factorization, so that most of the work in
+      // a Cholesky factorization is done by dense BLAS-3/LAPACK kernels
+      // (which run in parallel when a multithreaded BLAS is linked)
+      context.supernodal = CHOLMOD_SUPERNODAL;
+
+      orderingMethod = orderingDefault;
+      mixedPrecisionFactor = false;
+      verboseOutput = false;
+
+      settingsVersion = 0;
+
+      pthread_key_create( &threadCommon, releaseThreadCommon );
+      pthread_mutex_init( &poolMutex, NULL );
+      pthread_mutex_init( &settingsMutex, NULL );
    }
 
    LinearContext :: ~LinearContext( void )
    // destructor
    {
+      pthread_key_delete( threadCommon );
+
+      for( size_t i = 0; i < pool.size(); i++ )
+      {
+         cholmod_l_finish( pool[i] );
+         delete (ThreadCommon*) pool[i];
+      }
+      pool.clear();
+
+      pthread_mutex_destroy( &poolMutex );
+      pthread_mutex_destroy( &settingsMutex );
       cholmod_l_finish( &context );
    }
 
    LinearContext :: operator cholmod_common*( void )
    // allows LinearContext to be treated as a cholmod_common*
+   // (returns the instance for the calling thread)
+   {
+      ThreadCommon* t = (ThreadCommon*) pthread_getspecific( threadCommon );
+
+      if( t == NULL )
+      {
+         t = createThreadCommon();
+      }
+
+      // pick up any settings changed since this thread last asked for its
+      // instance; only the owning thread ever writes to an instance, so
+      // settings never change underneath a running solve
+      if( t->version != __sync_fetch_and_add( &settingsVersion, 0 ))
+      {
+         pthread_mutex_lock( &settingsMutex );
+         copySettings( context, t->common );
+         t->version = settingsVersion;
+         pthread_mutex_unlock( &settingsMutex );
+      }
+
+      return &t->common;
+   }
+
+   void LinearContext :: setOrdering( OrderingMethod ordering )
+   // sets the fill-reducing ordering used by subsequent factorizations
+   {
+      pthread_mutex_lock( &settingsMutex );
+
+      orderingMethod = ordering;
+
+      if( ordering == orderingDefault )
+      {
+         context.nmethods = 0;
+      }
+      else
+      {
+         context.nmethods = 1;
+         switch( ordering )
+         {
+            case orderingNatural:          context.method[0].ordering = CHOLMOD_NATURAL; break;
+            case orderingAMD:              context.method[0].ordering = CHOLMOD_AMD;     break;
+            case orderingMETIS:            context.method[0].ordering = CHOLMOD_METIS;   break;
+            case orderingNestedDissection: context.method[0].ordering = CHOLMOD_NESDIS;  break;
+            default: break;
+         }
+      }
+      context.postorder = true;
+
+      updateSettings();
+      pthread_mutex_unlock( &settingsMutex );
+   }
+
+   OrderingMethod LinearContext :: ordering( void ) const
+   // returns the current fill-reducing ordering
+   {
+      return orderingMethod;
+   }
+
+   int LinearContext :: qrOrdering( void ) const
+   // returns the current ordering as an SPQR_ORDERING_* constant
+   {
+      switch( orderingMethod )
+      {
+         case orderingNatural:          return SPQR_ORDERING_FIXED;
+         case orderingAMD:              return SPQR_ORDERING_AMD;
+         case orderingMETIS:            return SPQR_ORDERING_METIS;
+         case orderingNestedDissection: return SPQR_ORDERING_METIS;
+         default:                       return SPQR_ORDERING_DEFAULT;
+      }
+   }
+
+   void LinearContext :: setFactorization( FactorizationType type )
+   // selects supernodal, simplicial, or automatic factorization
+   {
+      pthread_mutex_lock( &settingsMutex );
+
+      switch( type )
+      {
+         case factorSimplicial: context.supernodal = CHOLMOD_SIMPLICIAL; break;
+         case factorSupernodal: context.supernodal = CHOLMOD_SUPERNODAL; break;
+         default:               context.supernodal = CHOLMOD_AUTO;       break;
+      }
+
+      updateSettings();
+      pthread_mutex_unlock( &settingsMutex );
+   }
+
+   void LinearContext :: setFinalLL( bool ll )
+   // if true, factors are returned in LL' form
+   {
+      pthread_mutex_lock( &settingsMutex );
+      context.final_ll = ll;
+
+      updateSettings();
+      pthread_mutex_unlock( &settingsMutex );
+   }
+
+   void LinearContext :: setThreads( int n )
+   // sets the number of threads used by BLAS/LAPACK and SPQR
+   {
+      pthread_mutex_lock( &settingsMutex );
+      context.SPQR_nthreads = n;
+
+      updateSettings();
+      pthread_mutex_unlock( &settingsMutex );
+
+      // by now the BLAS and OpenMP runtimes have usually read their
+      // environment already, so call their setters directly where we can
+      int nThreads = n > 0 ? n : (int) sysconf( _SC_NPROCESSORS_ONLN );
+      if( openblas_set_num_threads ) openblas_set_num_threads( nThreads );
+      if( MKL_Set_Num_Threads      ) MKL_Set_Num_Threads( nThreads );
+      if( omp_set_num_threads      ) omp_set_num_threads( nThreads );
+
+      // there is no standard BLAS interface for this, so also set the
+      // variables understood by the common implementations (for libraries
+      // that read them lazily, and for child processes)
+      setThreadVariable( "OMP_NUM_THREADS", n );
+      setThreadVariable( "OPENBLAS_NUM_THREADS", n );
+      setThreadVariable( "MKL_NUM_THREADS", n );
+      setThreadVariable( "VECLIB_MAXIMUM_THREADS", n );
+   }
+
+   void LinearContext :: setMixedPrecision( bool mixed )
+   // if true, Cholesky factors are computed in single precision
+   {
+      mixedPrecisionFactor = mixed;
+   }
+
+   bool LinearContext :: mixedPrecision( void ) const
+   // returns true if Cholesky factors are computed in single precision
+   {
+      return mixedPrecisionFactor;
+   }
+
+   void LinearContext :: setUseGPU( bool use )
+   // enables or disables GPU acceleration
+   {
+#ifdef CHOLMOD_VER_CODE
+#if CHOLMOD_VERSION >= CHOLMOD_VER_CODE(3,0)
+      pthread_mutex_lock( &settingsMutex );
+      context.useGPU = use;
+      updateSettings();
+      pthread_mutex_unlock( &settingsMutex );
+#endif
+#endif
+   }
+
+   void LinearContext :: setMemoryBudget( double megabytes )
+   // limits the memory the solvers allocate from the heap
+   {
+      ScratchAllocator::setBudget( (size_t)( megabytes * 1024. * 1024. ));
+   }
+
+   void LinearContext :: setScratchDirectory( const string& path )
+   // sets the directory used for scratch files
+   {
+      ScratchAllocator::setDirectory( path );
+   }
+
+   void LinearContext :: setVerbose( bool verbose )
+   // if true, solvers print statistics after each factorization
+   {
+      verboseOutput = verbose;
+   }
+
+   bool LinearContext :: verbose( void ) const
+   // returns true if solvers should print statistics
+   {
+      return verboseOutput;
+   }
+
+   double LinearContext :: flopCount( void )
+   // returns the flop count of the most recent factorization
+   {
+      cholmod_common* common = *this;
+      return common->fl;
+   }
+
+   double LinearContext :: factorNonzeros( void )
+   // returns the number of nonzeros in the most recent factor L
+   {
+      cholmod_common* common = *this;
+      return common->lnz;
+   }
+
+   double LinearContext :: qrFactorNonzeros( void )
+   // returns the number of nonzeros in the most recent QR factor R
+   {
+      cholmod_common* common = *this;
+      return common->SPQR_istat[0];
+   }
+
+   double LinearContext :: peakMemory( void )
+   // returns the peak memory usage (in bytes) of the calling thread's instance
+   {
+      cholmod_common* common = *this;
+      return (double) common->memory_usage;
+   }
+
+   void LinearContext :: printStatistics( ostream& out, const char* prefix )
+   // writes solver statistics to out
+   {
+      out << prefix << " flops: " << flopCount() << "\n";
+      out << prefix << " nnz(L): " << factorNonzeros() << "\n";
+      out << prefix << " peak memory: " << peakMemory() / (1024.*1024.) << "MB" << "\n";
+      printScratchStatistics( out, prefix );
+   }
+
+   void LinearContext :: printQRStatistics( ostream& out, const char* prefix )
+   // writes QR statistics to out
    {
-      return &context;
+      out << prefix << " nnz(R): " << qrFactorNonzeros() << "\n";
+      out << prefix << " peak memory: " << peakMemory() / (1024.*1024.) << "MB" << "\n";
+      printScratchStatistics( out, prefix );
+   }
+
+   void LinearContext :: printScratchStatistics( ostream& out, const char* prefix )
+   // writes scratch file usage to out (if a memory budget is set)
+   {
+      if( ScratchAllocator::budget() == 0 ) return;
+
+      out << prefix << " scratch: " << ScratchAllocator::scratchBytes() / (1024.*1024.) << "MB"
+          << " (peak " << ScratchAllocator::peakScratchBytes() / (1024.*1024.) << "MB)" << "\n";
+   }
+
+   int LinearContext :: parseOption( int i, int argc, char** argv )
+   // if argv[i] is a solver option, applies it and returns the
+   // number of arguments it used (zero if it is not a solver option)
+   {
+      string option( argv[i] );
+
+      // options without a value
+      if( option == "-ll"    ) { setFinalLL( true );         return 1; }
+      if( option == "-ldl"   ) { setFinalLL( false );        return 1; }
+      if( option == "-mixed" ) { setMixedPrecision( true );  return 1; }
+      if( option == "-nogpu" ) { setUseGPU( false );         return 1; }
+      if( option == "-stats" ) { setVerbose( true );         return 1; }
+
+      // options with a value
+      if( option != "-ordering" &&
+          option != "-factor"   &&
+          option != "-threads"  &&
+          option != "-memory"   &&
+          option != "-scratch" )
+      {
+         return 0;
+      }
+      if( i+1 == argc ) return -1;
+      string value( argv[i+1] );
+
+      if( option == "-ordering" )
+      {
+              if( value == "default" ) setOrdering( orderingDefault );
+         else if( value == "natural" ) setOrdering( orderingNatural );
+         else if( value == "amd"     ) setOrdering( orderingAMD );
+         else if( value == "metis"   ) setOrdering( orderingMETIS );
+         else if( value == "nesdis"  ) setOrdering( orderingNestedDissection );
+         else return -1;
+      }
+      else if( option == "-factor" )
+      {
+              if( value == "auto"       ) setFactorization( factorAutomatic );
+         else if( value == "simplicial" ) setFactorization( factorSimplicial );
+         else if( value == "supernodal" ) setFactorization( factorSupernodal );
+         else return -1;
+      }
+      else if( option == "-threads" )
+      {
+         int n = atoi( value.c_str() );
+         if( n < 0 ) return -1;
+         setThreads( n );
+      }
+      else if( option == "-memory" )
+      {
+         double megabytes = atof( value.c_str() );
+         if( megabytes < 0. ) return -1;
+         setMemoryBudget( megabytes );
+      }
+      else // -scratch
+      {
+         setScratchDirectory( value );
+      }
+
+      return 2;
+   }
+
+   const char* LinearContext :: usage( void )
+   // returns a description of the options accepted by parseOption()
+   {
+      return
+         "solver options:\n"
+         "   -ordering default|natural|amd|metis|nesdis   fill-reducing ordering\n"
+         "   -factor auto|simplicial|supernodal           Cholesky factor storage\n"
+         "   -ll, -ldl                                    LL' or LDL' factors\n"
+         "   -threads n                                   BLAS/LAPACK and SPQR threads\n"
+         "   -memory MB                                   heap budget before using scratch files\n"
+         "   -scratch dir                                 directory for scratch files\n"
+         "   -mixed                                       single-precision factors with refinement\n"
+         "   -nogpu                                       disable GPU acceleration\n"
+         "   -stats                                       print factorization statistics\n";
+   }
+
+   void LinearContext :: updateSettings( void )
+   // publishes a change to the shared settings (call with settingsMutex
+   // held); each thread copies the new settings into its own instance the
+   // next time it asks for it
+   {
+      __sync_fetch_and_add( &settingsVersion, 1 );
+   }
+
+   ThreadCommon* LinearContext :: createThreadCommon( void )
+   {
+      // since common is the first member of ThreadCommon, a pointer
+      // to one can be used as a pointer to the other
+      ThreadCommon* t = new ThreadCommon;
+      t->owner = this;
+      cholmod_l_start( &t->common );
+      ScratchAllocator::install( &t->common );
+
+      pthread_mutex_lock( &settingsMutex );
+      copySettings( context, t->common );
+      t->version = settingsVersion;
+      pthread_mutex_unlock( &settingsMutex );
+
+      pthread_setspecific( threadCommon, t );
+
+      pthread_mutex_lock( &poolMutex );
+      pool.push_back( &t->common );
+      pthread_mutex_unlock( &poolMutex );
+
+      return t;
+   }
+
+   void LinearContext :: releaseThreadCommon( void* common )
+   // called when a thread exits
+   {
+      ThreadCommon* t = (ThreadCommon*) common;
+      LinearContext* c = t->owner;
+
+      pthread_mutex_lock( &c->poolMutex );
+      c->pool.erase( remove( c->pool.begin(), c->pool.end(), &t->common ), c->pool.end() );
+      pthread_mutex_unlock( &c->poolMutex );
+
+      cholmod_l_finish( &t->common );
+      delete t;
    }
 }
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 using namespace std;
 
 #include "LinearPolynomial.h"
@@ -6,6 +7,178 @@ using namespace std;
 
 namespace DDG
 {
+   LinearTermList :: LinearTermList( void )
+   : terms( inlineTerms ),
+     nTerms( 0 ),
+     capacity( inlineCapacity )
+   {}
+
+   LinearTermList :: LinearTermList( const LinearTermList& l )
+   : terms( inlineTerms ),
+     nTerms( 0 ),
+     capacity( inlineCapacity )
+   {
+      *this = l;
+   }
+
+   LinearTermList :: ~LinearTermList( void )
+   {
+      if( terms != inlineTerms )
+      {
+         delete [] terms;
+      }
+   }
+
+   const LinearTermList& LinearTermList :: operator=( const LinearTermList& l )
+   {
+      if( this == &l ) return *this;
+
+      nTerms = 0;
+      reserve( l.nTerms );
+      copy( l.terms, l.terms + l.nTerms, terms );
+      nTerms = l.nTerms;
+
+      return *this;
+   }
+
+   static bool termPrecedes( const LinearTerm& t, Variable* v )
+   // orders terms by variable address
+   {
+      return t.first < v;
+   }
+
+   double& LinearTermList :: operator[]( Variable* v )
+   {
+      TermIter t = lower_bound( terms, terms + nTerms, v, termPrecedes );
+
+      if( t != terms + nTerms && t->first == v )
+      {
+         return t->second;
+      }
+
+      // insert a new term, shifting later terms back by one
+      int k = t - terms;
+      reserve( nTerms+1 );
+      copy_backward( terms + k, terms + nTerms, terms + nTerms + 1 );
+      terms[k] = LinearTerm( v, 0. );
+      nTerms++;
+
+      return terms[k].second;
+   }
+
+   TermIter LinearTermList :: find( Variable* v )
+   {
+      TermIter t = lower_bound( terms, terms + nTerms, v, termPrecedes );
+
+      if( t != terms + nTerms && t->first == v ) return t;
+      return end();
+   }
+
+   TermCIter LinearTermList :: find( Variable* v ) const
+   {
+      TermCIter t = lower_bound( terms, terms + nTerms, v, termPrecedes );
+
+      if( t != terms + nTerms && t->first == v ) return t;
+      return end();
+   }
+
+   void LinearTermList :: merge( const LinearTermList& l, double c )
+   // adds c times the terms of l to this list
+   {
+      // a single term (e.g., p += c*v) is simply inserted in place
+      if( l.nTerms == 1 )
+      {
+         (*this)[ l.terms[0].first ] += c * l.terms[0].second;
+         return;
+      }
+
+      // otherwise merge the two sorted lists
+      LinearTermList result;
+      result.reserve( nTerms + l.nTerms );
+
+      LinearTerm* r = result.terms;
+      int i = 0, j = 0;
+      while( i < nTerms && j < l.nTerms )
+      {
+         if( terms[i].first < l.terms[j].first )
+         {
+            *r++ = terms[i++];
+         }
+         else if( l.terms[j].first < terms[i].first )
+         {
+            *r++ = LinearTerm( l.terms[j].first, c * l.terms[j].second );
+            j++;
+         }
+         else
+         {
+            *r++ = LinearTerm( terms[i].first, terms[i].second + c * l.terms[j].second );
+            i++;
+            j++;
+         }
+      }
+      while( i < nTerms )
+      {
+         *r++ = terms[i++];
+      }
+      while( j < l.nTerms )
+      {
+         *r++ = LinearTerm( l.terms[j].first, c * l.terms[j].second );
+         j++;
+      }
+      result.nTerms = r - result.terms;
+
+      *this = result;
+   }
+
+   void LinearTermList :: reserve( int n )
+   // makes room for at least the specified number of terms
+   {
+      if( n <= capacity ) return;
+
+      int newCapacity = max( n, 2*capacity );
+      LinearTerm* newTerms = new LinearTerm[ newCapacity ];
+      copy( terms, terms + nTerms, newTerms );
+
+      if( terms != inlineTerms )
+      {
+         delete [] terms;
+      }
+      terms = newTerms;
+      capacity = newCapacity;
+   }
+
+   void LinearTermList :: clear( void )
+   // removes all terms
+   {
+      nTerms = 0;
+   }
+
+   int LinearTermList :: size( void ) const
+   // returns the number of terms
+   {
+      return nTerms;
+   }
+
+   TermIter LinearTermList :: begin( void )
+   {
+      return terms;
+   }
+
+   TermCIter LinearTermList :: begin( void ) const
+   {
+      return terms;
+   }
+
+   TermIter LinearTermList :: end( void )
+   {
+      return terms + nTerms;
+   }
+
+   TermCIter LinearTermList :: end( void ) const
+   {
+      return terms + nTerms;
+   }
+
    LinearPolynomial :: LinearPolynomial( void )
    : constantTerm( 0. )
    {}
@@ -76,56 +249,24 @@ namespace DDG
 
    void LinearPolynomial::operator+=( Variable& v )
    {
-      LinearPolynomial p( v );
-
-      *this += p;
+      linearTerms[ &v ] += 1.;
    }
 
    void LinearPolynomial::operator-=( Variable& v )
    {
-      LinearPolynomial p( v );
-
-      *this -= p;
+      linearTerms[ &v ] -= 1.;
    }
 
    void LinearPolynomial::operator+=( const LinearPolynomial& e )
    {
-      for( TermCIter i  = e.linearTerms.begin();
-                     i != e.linearTerms.end();
-                     i++ )
-      {
-         TermIter j = linearTerms.find( i->first );
-   
-         if( j != linearTerms.end() )
-         {
-            j->second += i->second;
-         }
-         else
-         {
-            linearTerms[i->first] = i->second;
-         }
-      }
+      linearTerms.merge( e.linearTerms, 1. );
    
       constantTerm += e.constantTerm;
    }
 
    void LinearPolynomial::operator-=( const LinearPolynomial& e )
    {
-      for( TermCIter i  = e.linearTerms.begin();
-                     i != e.linearTerms.end();
-                     i++ )
-      {
-         TermIter j = linearTerms.find( i->first );
-   
-         if( j != linearTerms.end() )
-         {
-            j->second -= i->second;
-         }
-         else
-         {
-            linearTerms[i->first] = -i->second;
-         }
-      }
+      linearTerms.merge( e.linearTerms, -1. );
    
       constantTerm -= e.constantTerm;
    }
@@ -1,16 +1,84 @@
 #include <map>
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <cmath>
+#include <cfloat>
 using namespace std;
 
 #include <SuiteSparseQR.hpp>
 
 #include "LinearSystem.h"
 #include "LinearContext.h"
+#include "Utility.h"
 #include "Types.h"
 
 namespace DDG
 {
    extern LinearContext context;
 
+   const double maxFactorNonzeros = 5e7;
+   // largest predicted Cholesky factor (number of nonzeros) for which
+   // lsAutomatic uses the normal equations rather than LSQR
+
+   const double minNormalRCond = sqrt( DBL_EPSILON );
+   // smallest reciprocal condition number of A'A for which lsAutomatic
+   // trusts the normal equations; their relative error is roughly
+   // DBL_EPSILON / rcond(A'A) (rcond(A'A) being about rcond(A)^2), so this
+   // keeps it below about 1e-8, where QR would do no worse than about 1e-12
+
+   const double lsqrTolerance = 1e-10;
+   // relative size of A'r at which LSQR stops
+
+   LinearSystem::LinearSystem( void )
+   // constructs an empty system
+   : method( lsAutomatic ),
+     nEquations( 0 ),
+     nVariables( 0 ),
+     idBase( 0 ),
+     A( NULL ),
+     AtA( NULL ),
+     L( NULL ),
+     QR( NULL ),
+     factorMethod( lsAutomatic ),
+     factorCurrent( false )
+   {}
+
+   LinearSystem::LinearSystem( const LinearSystem& s )
+   // copies the equations of s
+   : equations( s.equations ),
+     method( s.method ),
+     nEquations( 0 ),
+     nVariables( 0 ),
+     idBase( 0 ),
+     A( NULL ),
+     AtA( NULL ),
+     L( NULL ),
+     QR( NULL ),
+     factorMethod( lsAutomatic ),
+     factorCurrent( false )
+   {}
+
+   LinearSystem::~LinearSystem( void )
+   // destructor
+   {
+      clearFactors();
+
+      if( A )
+      {
+         cholmod_l_free_sparse( &A, context );
+      }
+   }
+
+   const LinearSystem& LinearSystem::operator=( const LinearSystem& s )
+   // copies the equations of s
+   {
+      equations = s.equations;
+      method = s.method;
+
+      return *this;
+   }
+
    void LinearSystem::clear( void )
    // removes all equations from the system
    {
@@ -27,124 +95,529 @@ namespace DDG
    // solves the system and automatically stores the result in the variables
    // for an overdetermined system, computes a least-squares solution
    {
-      convertEquations();
-      indexVariables();
-      buildSparseMatrix();
+      const char* changeName[] = { "none", "right-hand side", "values", "structure" };
+
+      double t0 = wallClock();
+      SystemChange change = assembleEquations();
+      double t1 = wallClock();
+      if( change >= valuesChanged ) buildSparseMatrix();
       buildRightHandSide();
-      computeSolution();
+      double t2 = wallClock();
+      computeSolution( change );
+      double t3 = wallClock();
+
+      cout << "[linsys] change: " << changeName[ change ] << "\n";
+      cout << "[linsys] assemble: " << seconds( t0, t1 ) << "s" << "\n";
+      cout << "[linsys] build: " << seconds( t1, t2 ) << "s" << "\n";
+      cout << "[linsys] solve: " << seconds( t2, t3 ) << "s" << "\n";
+      cout << "[linsys] size: " << nEquations << " x " << nVariables << "\n";
    }
 
-   void LinearSystem::convertEquations( void )
-   // converts each equation to its polynomial representation
+   void LinearSystem::buildIndex( void )
+   // prepares an empty column table covering the ids of all variables that
+   // appear in the equations, and forgets the columns of the previous solve
    {
-      currentEquations.clear();
+      variables.clear();
+      variableIDs.clear();
+      nVariables = 0;
+
+      // find the range of ids in use (if the id counter has wrapped around
+      // in the middle of this system, the ids merely look spread out)
+      size_t nTerms = 0;
+      unsigned int idMin = UINT_MAX, idMax = 0;
+      for( EqnCIter eqn  = equations.begin();
+                    eqn != equations.end();
+                    eqn ++ )
+      {
+         const LinearPolynomial* sides[2] = { &eqn->lhs, &eqn->rhs };
+         for( int k = 0; k < 2; k++ )
+         for( TermCIter t  = sides[k]->linearTerms.begin();
+                        t != sides[k]->linearTerms.end();
+                        t ++ )
+         {
+            unsigned int id = t->first->id;
+            idMin = min( idMin, id );
+            idMax = max( idMax, id );
+            nTerms++;
+         }
+      }
+
+      sortedIDs.clear();
+      column.clear();
+      if( nTerms == 0 ) return;
+
+      // if the ids are reasonably dense, index the table directly by the
+      // offset from the smallest id; otherwise index it by rank among the
+      // distinct ids, so that its size never exceeds the number of terms
+      idBase = idMin;
+      if( idMax - idMin < 4*nTerms + 1024 )
+      {
+         column.resize( idMax - idMin + 1, -1 );
+         return;
+      }
+
+      sortedIDs.reserve( nTerms );
+      for( EqnCIter eqn  = equations.begin();
+                    eqn != equations.end();
+                    eqn ++ )
+      {
+         const LinearPolynomial* sides[2] = { &eqn->lhs, &eqn->rhs };
+         for( int k = 0; k < 2; k++ )
+         for( TermCIter t  = sides[k]->linearTerms.begin();
+                        t != sides[k]->linearTerms.end();
+                        t ++ )
+         {
+            sortedIDs.push_back( t->first->id );
+         }
+      }
+      sort( sortedIDs.begin(), sortedIDs.end() );
+      sortedIDs.erase( unique( sortedIDs.begin(), sortedIDs.end() ), sortedIDs.end() );
+      column.resize( sortedIDs.size(), -1 );
+   }
+
+   int& LinearSystem::columnOf( const Variable* variable )
+   // returns the table entry holding the column of the given variable
+   {
+      unsigned int id = variable->id;
+      if( sortedIDs.empty() )
+      {
+         return column[ id - idBase ];
+      }
+      return column[ lower_bound( sortedIDs.begin(), sortedIDs.end(), id ) - sortedIDs.begin() ];
+   }
+
+   SystemChange LinearSystem::assembleEquations( void )
+   // converts each equation to a row of the compressed-row buffer, assigning
+   // a column to each (non-fixed) variable the first time it is encountered;
+   // returns what changed relative to the previous call
+   {
+      // keep the previous assembly around for comparison
+      vector<int> oldRowStart, oldColumnIndex;
+      vector<unsigned int> oldVariableIDs( variableIDs );
+      vector<double> oldValues, oldConstants;
+      rowStart.swap( oldRowStart );
+      columnIndex.swap( oldColumnIndex );
+      values.swap( oldValues );
+      constants.swap( oldConstants );
+
+      buildIndex();
 
-      for( EqnIter eqn  = equations.begin();
-                   eqn != equations.end();
-                   eqn ++ )
+      // preallocate using the total number of terms as an upper bound
+      size_t nTerms = 0;
+      for( EqnCIter eqn  = equations.begin();
+                    eqn != equations.end();
+                    eqn ++ )
+      {
+         nTerms += eqn->lhs.linearTerms.size() + eqn->rhs.linearTerms.size();
+      }
+      rowStart.reserve( equations.size() + 1 );
+      columnIndex.reserve( nTerms );
+      values.reserve( nTerms );
+      constants.reserve( equations.size() );
+
+      rowStart.push_back( 0 );
+
+      for( EqnCIter eqn  = equations.begin();
+                    eqn != equations.end();
+                    eqn ++ )
       {
          // move right-hand side to left-hand side
          LinearPolynomial p = eqn->lhs - eqn->rhs;
 
          // convert fixed variables to constants
-         LinearPolynomial q( p.constantTerm );
-         
-         for( TermIter t  = p.linearTerms.begin();
-                       t != p.linearTerms.end();
-                       t ++ )
+         double constant = p.constantTerm;
+
+         for( TermCIter t  = p.linearTerms.begin();
+                        t != p.linearTerms.end();
+                        t ++ )
          {
             const double& coefficient( t->second );
-            Variable& variable( *(t->first) );
+            Variable* variable( t->first );
 
             // skip zeros
             if( coefficient == 0. ) continue;
 
-            if( t->first->fixed )
+            if( variable->fixed )
             {
-               q += coefficient * variable.value;
+               constant += coefficient * variable->value;
+               continue;
             }
-            else
+
+            // if we haven't seen this variable
+            // before, assign it a unique column
+            int& j( columnOf( variable ));
+            if( j == -1 )
             {
-               q += coefficient * variable;
+               j = nVariables;
+               variables.push_back( variable );
+               variableIDs.push_back( variable->id );
+               nVariables++;
             }
+
+            columnIndex.push_back( j );
+            values.push_back( coefficient );
          }
 
-         if( q.linearTerms.size() > 0 )
+         // keep only equations that still involve a variable
+         if( (int) values.size() > rowStart.back() )
          {
-            currentEquations.push_back( q );
+            rowStart.push_back( values.size() );
+            constants.push_back( constant );
          }
       }
 
-      nEquations = currentEquations.size();
+      nEquations = constants.size();
+
+      // since columns are assigned in order of appearance, an identical
+      // nonzero pattern yields identical rows, columns, and variable ids
+      if( A == NULL ||
+          rowStart    != oldRowStart ||
+          columnIndex != oldColumnIndex ||
+          variableIDs != oldVariableIDs ) return structureChanged;
+      if( values    != oldValues    ) return valuesChanged;
+      if( constants != oldConstants ) return rhsChanged;
+      return noChange;
    }
 
-   void LinearSystem::indexVariables( void )
-   // assign a unique index to each variable remaining in one of the polynomials
+   void LinearSystem::buildSparseMatrix( void )
+   // build the compressed-column (CHOLMOD) representation of our current system
    {
-      index.clear();
-      nVariables = 0;
+      if( A )
+      {
+         cholmod_l_free_sparse( &A, context );
+      }
+
+      int nnz = values.size();
+      int sorted = true;
+      int packed = true;
+      int stype = 0;
+      A = cholmod_l_allocate_sparse( nEquations, nVariables, nnz, sorted, packed, stype, CHOLMOD_REAL, context );
+
+       double* pr =  (double*) A->x;
+      UF_long* ir = (UF_long*) A->i;
+      UF_long* jc = (UF_long*) A->p;
 
-      for( PolyCIter p  = currentEquations.begin();
-                     p != currentEquations.end();
-                     p ++ )
+      // count nonzeros in each column
+      for( int j = 0; j <= nVariables; j++ )
       {
-         for( TermCIter t  = p->linearTerms.begin();
-                        t != p->linearTerms.end();
-                        t ++ )
+         jc[j] = 0;
+      }
+      for( int k = 0; k < nnz; k++ )
+      {
+         jc[ columnIndex[k] + 1 ]++;
+      }
+      for( int j = 0; j < nVariables; j++ )
+      {
+         jc[j+1] += jc[j];
+      }
+
+      // scatter rows into columns; rows are visited in increasing
+      // order, so row indices within each column end up sorted
+      vector<UF_long> next( jc, jc + nVariables );
+      for( int i = 0; i < nEquations; i++ )
+      {
+         for( int k = rowStart[i]; k < rowStart[i+1]; k++ )
          {
-            IndexIter j = index.find( t->first );
+            UF_long p = next[ columnIndex[k] ]++;
 
-            // if we haven't seen this variable
-            // before, assign it a unique index
-            if( j == index.end() )
-            {
-               index[ t->first ] = nVariables;
-               nVariables++;
-            }
+            ir[p] = i;
+            pr[p] = values[k];
          }
       }
    }
 
-   void LinearSystem::buildSparseMatrix( void )
-   // build the sparse matrix representation of our current system
+   void LinearSystem::buildRightHandSide( void )
+   // build the data vector for our current system
    {
-      A = SparseMatrix<Real>( nEquations, nVariables );
+      b = DenseMatrix<Real>( nEquations, 1 );
 
       for( int i = 0; i < nEquations; i++ )
       {
-         for( TermCIter t  = currentEquations[i].linearTerms.begin();
-                        t != currentEquations[i].linearTerms.end();
-                        t ++ )
+         b(i) = -constants[i];
+      }
+   }
+
+   void LinearSystem::computeSolution( SystemChange change )
+   {
+      // a new nonzero pattern (or a different method) needs new factors;
+      // new values keep the ordering and symbolic analysis but must be
+      // refactored numerically; otherwise the factors are reused as-is
+      if( change == structureChanged ||
+          ( method != lsAutomatic && method != factorMethod ))
+      {
+         clearFactors();
+      }
+      else if( change == valuesChanged )
+      {
+         factorCurrent = false;
+      }
+
+      // solve linear system Ax=b, unless nothing at all has changed
+      if( change != noChange || x.nRows() != nVariables )
+      {
+         if( factorMethod == lsAutomatic )
          {
-            int j = index[ t->first ];
+            factorMethod = chooseMethod();
+         }
 
-            A(i,j) = t->second;
+         switch( factorMethod )
+         {
+            case lsCholesky:
+               if( !factorCurrent ) factorNormalEquations();
+               backsolveNormalEquations();
+               break;
+            case lsQR:
+               if( !factorCurrent ) factorQR();
+               backsolveQR();
+               break;
+            default:
+               solveLSQR( change != structureChanged );
+               break;
          }
       }
+      
+      // put solution values in variables
+      for( int j = 0; j < nVariables; j++ )
+      {
+         variables[j]->value = x( j );
+      }
    }
 
-   void LinearSystem::buildRightHandSide( void )
-   // build the data vector for our current system
+   LeastSquaresMethod LinearSystem::chooseMethod( void )
+   // returns the method requested by the user, or picks one automatically:
+   // the normal equations are tried first (leaving the Cholesky factor in
+   // place), falling back to LSQR if the factor would be too large and to
+   // QR if A'A is not numerically positive-definite or too ill-conditioned
    {
-      b = DenseMatrix<Real>( nEquations, 1 );
+      if( method != lsAutomatic ) return method;
+
+      double t0 = wallClock();
+      formNormalEquations();
+      L = cholmod_l_analyze( AtA, context );
+      double t1 = wallClock();
+
+      cout << "[linsys] analyze: " << seconds( t0, t1 ) << "s" << "\n";
+
+      if( (*context).lnz > maxFactorNonzeros )
+      {
+         cout << "[linsys] factor too large (" << (*context).lnz << " nonzeros); using LSQR" << "\n";
+         clearFactors();
+         return lsLSQR;
+      }
+
+      cholmod_l_factorize( AtA, L, context );
+      factorCurrent = true;
+      double rcond = cholmod_l_rcond( L, context );
+      double t2 = wallClock();
+
+      cout << "[linsys] factorize: " << seconds( t1, t2 ) << "s" << "\n";
+      cout << "[linsys] rcond(A'A): " << rcond << "\n";
+      if( context.verbose() ) context.printStatistics( cout, "[linsys]" );
+
+      if( (*context).status == CHOLMOD_NOT_POSDEF || rcond < minNormalRCond )
+      {
+         cout << "[linsys] normal equations ill-conditioned; using QR" << "\n";
+         clearFactors();
+         return lsQR;
+      }
+
+      return lsCholesky;
+   }
+
+   void LinearSystem::formNormalEquations( void )
+   // builds the upper triangle of A'A
+   {
+      if( AtA )
+      {
+         cholmod_l_free_sparse( &AtA, context );
+      }
+
+      cholmod_sparse* At = cholmod_l_transpose( A, 1, context );
+      cholmod_sparse* AAt = cholmod_l_aat( At, NULL, 0, 1, context );
+      AtA = cholmod_l_copy( AAt, 1, 1, context );
+      cholmod_l_free_sparse( &AAt, context );
+      cholmod_l_free_sparse( &At, context );
+   }
+
+   void LinearSystem::factorNormalEquations( void )
+   // factors A'A, reusing the symbolic analysis if one already exists
+   {
+      double t0 = wallClock();
+      formNormalEquations();
+      if( L == NULL )
+      {
+         L = cholmod_l_analyze( AtA, context );
+      }
+      cholmod_l_factorize( AtA, L, context );
+      factorCurrent = true;
+      double t1 = wallClock();
+
+      cout << "[linsys] factorize: " << seconds( t0, t1 ) << "s" << "\n";
+      if( context.verbose() ) context.printStatistics( cout, "[linsys]" );
+   }
+
+   void LinearSystem::backsolveNormalEquations( void )
+   // solves A'A x = A'b using the current Cholesky factor
+   {
+      double t0 = wallClock();
+
+      cholmod_dense* Atb = cholmod_l_zeros( nVariables, 1, CHOLMOD_REAL, context );
+      double one[2] = { 1., 0. }, zero[2] = { 0., 0. };
+      cholmod_l_sdmult( A, 1, one, zero, b.to_cholmod(), Atb, context );
+      x = cholmod_l_solve( CHOLMOD_A, L, Atb, context );
+      cholmod_l_free_dense( &Atb, context );
+
+      double t1 = wallClock();
+      cout << "[linsys] backsolve: " << seconds( t0, t1 ) << "s" << "\n";
+   }
+
+   void LinearSystem::factorQR( void )
+   // computes a sparse QR factorization of A, reusing the symbolic analysis
+   // if one already exists
+   {
+      double t0 = wallClock();
+      if( QR == NULL )
+      {
+         int allowTolerance = true;
+         QR = SuiteSparseQR_symbolic<double>( context.qrOrdering(), allowTolerance, A, context );
+      }
+      SuiteSparseQR_numeric<double>( SPQR_DEFAULT_TOL, A, QR, context );
+      factorCurrent = true;
+      double t1 = wallClock();
+
+      cout << "[linsys] qr: " << seconds( t0, t1 ) << "s" << "\n";
+      if( context.verbose() ) context.printQRStatistics( cout, "[linsys]" );
+   }
+
+   void LinearSystem::backsolveQR( void )
+   // computes the least-squares solution x = R \ (Q'b) using the current QR factor
+   {
+      double t0 = wallClock();
+
+      cholmod_dense* Qtb = SuiteSparseQR_qmult<double>( SPQR_QTX, QR, b.to_cholmod(), context );
+      x = SuiteSparseQR_solve<double>( SPQR_RETX_EQUALS_B, QR, Qtb, context );
+      cholmod_l_free_dense( &Qtb, context );
+
+      double t1 = wallClock();
+      cout << "[linsys] backsolve: " << seconds( t0, t1 ) << "s" << "\n";
+   }
+
+   void LinearSystem::clearFactors( void )
+   // frees any stored factorization
+   {
+      if( AtA ) cholmod_l_free_sparse( &AtA, context );
+      if( L ) cholmod_l_free_factor( &L, context );
+      if( QR ) SuiteSparseQR_free<double>( &QR, context );
+
+      factorMethod = lsAutomatic;
+      factorCurrent = false;
+   }
+
+   void LinearSystem::solveLSQR( bool warmStart )
+   // solves min |Ax-b| using LSQR (Paige and Saunders 1982), which only
+   // requires products with A and A'; if warmStart is true, the previous
+   // solution is used as the starting point
+   {
+      double t0 = wallClock();
+
+      // solve for a correction to the starting point x0
+      DenseMatrix<Real> x0( nVariables, 1 ), u( b ), v, w, Av, Atu;
+      if( warmStart && x.nRows() == nVariables )
+      {
+         x0 = x;
+         multiply( x0, Av );
+         u -= Av;
+      }
+      x = DenseMatrix<Real>( nVariables, 1 );
+
+      double beta = u.norm( lTwo );
+      if( beta > 0. ) u *= 1./beta;
+      multiplyTranspose( u, v );
+      double alpha = v.norm( lTwo );
+      if( alpha > 0. ) v *= 1./alpha;
+      w = v;
+
+      double phibar = beta;
+      double rhobar = alpha;
+      // stop relative to |A'b| (rather than the initial residual), so
+      // that a good starting point requires few or no iterations
+      DenseMatrix<Real> Atb;
+      multiplyTranspose( b, Atb );
+      double stop = lsqrTolerance * Atb.norm( lTwo );
+      int maxIter = 4 * nVariables;
+      int iter = 0;
+
+      while( iter < maxIter && alpha * beta > stop )
+      {
+         // continue the bidiagonalization
+         multiply( v, Av );
+         u *= -alpha;
+         u += Av;
+         beta = u.norm( lTwo );
+         if( beta > 0. ) u *= 1./beta;
+
+         multiplyTranspose( u, Atu );
+         v *= -beta;
+         v += Atu;
+         alpha = v.norm( lTwo );
+         if( alpha > 0. ) v *= 1./alpha;
+
+         // apply the next plane rotation
+         double rho = sqrt( rhobar*rhobar + beta*beta );
+         double c = rhobar / rho;
+         double s = beta / rho;
+         double theta = s * alpha;
+         rhobar = -c * alpha;
+         double phi = c * phibar;
+         phibar = s * phibar;
+
+         // update the solution and search direction
+         axpy( Real( phi/rho ), w, x );
+         w *= -theta/rho;
+         w += v;
+         iter++;
+
+         // |A'r| = phibar * alpha * |c|
+         if( phibar * alpha * fabs( c ) <= stop ) break;
+      }
+
+      x += x0;
+
+      double t1 = wallClock();
+      cout << "[linsys] lsqr: " << seconds( t0, t1 ) << "s (" << iter << " iterations)" << "\n";
+   }
+
+   void LinearSystem::multiply( const DenseMatrix<Real>& v, DenseMatrix<Real>& Av ) const
+   // computes Av = A*v using the compressed-row representation
+   {
+      Av = DenseMatrix<Real>( nEquations, 1 );
 
       for( int i = 0; i < nEquations; i++ )
       {
-         b(i) = -currentEquations[i].constantTerm;
+         double sum = 0.;
+
+         for( int k = rowStart[i]; k < rowStart[i+1]; k++ )
+         {
+            sum += values[k] * v( columnIndex[k] );
+         }
+
+         Av(i) = sum;
       }
    }
 
-   void LinearSystem::computeSolution( void )
+   void LinearSystem::multiplyTranspose( const DenseMatrix<Real>& u, DenseMatrix<Real>& Atu ) const
+   // computes Atu = A'*u using the compressed-row representation
    {
-      // solve linear system Ax=b
-      x = SuiteSparseQR<double>( A.to_cholmod(), b.to_cholmod(), context );
-      
-      // put solution values in variables
-      for( IndexIter i  = index.begin();
-                     i != index.end();
-                     i ++ )
+      Atu = DenseMatrix<Real>( nVariables, 1 );
+
+      for( int i = 0; i < nEquations; i++ )
       {
-         i->first->value = x( i->second );
+         double ui = u(i);
+
+         for( int k = rowStart[i]; k < rowStart[i+1]; k++ )
+         {
+            Atu( columnIndex[k] ) += values[k] * ui;
+         }
       }
    }
 }
@@ -0,0 +1,257 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+#include "MarkerBuffer.h"
+
+namespace DDG
+{
+   MarkerBuffer :: Marker :: Marker( void )
+   : center( 0., 0., 0. ),
+     radius( 1. ),
+     specular( 1. )
+   {
+      for( int k = 0; k < 4; k++ ) color[k] = 1.;
+   }
+
+   MarkerBuffer :: MarkerBuffer( void )
+   : instanceBuffer( 0 ),
+     instanceBufferSize( 0 ),
+     dirtyBegin( 0 ),
+     dirtyEnd( 0 ),
+     initialized( false ),
+     instancing( false )
+   {}
+
+   void MarkerBuffer :: clear( void )
+   // releases all buffer objects
+   {
+      sphere.clear();
+      if( instanceBuffer ) glDeleteBuffers( 1, &instanceBuffer );
+      instanceBuffer = 0;
+      instanceBufferSize = 0;
+      initialized = false;
+   }
+
+   void MarkerBuffer :: setMarkers( const vector<Marker>& markers )
+   // replaces the list of markers
+   {
+      int n = markers.size();
+      instanceData.resize( instanceComponents * n );
+      slotOfKey.resize( n );
+      keyOfSlot.resize( n );
+
+      for( int i = 0; i < n; i++ )
+      {
+         storeMarker( i, markers[i] );
+         slotOfKey[i] = keyOfSlot[i] = i;
+      }
+
+      // (uploaded on the next call to draw())
+      dirtyBegin = 0;
+      dirtyEnd = n;
+   }
+
+   void MarkerBuffer :: setMarker( int key, const Marker& marker )
+   // adds or replaces the marker with the given key
+   {
+      if( key >= (int) slotOfKey.size() ) slotOfKey.resize( key+1, -1 );
+
+      int& slot( slotOfKey[key] );
+      if( slot < 0 )
+      {
+         slot = keyOfSlot.size();
+         keyOfSlot.push_back( key );
+         instanceData.resize( instanceComponents * keyOfSlot.size() );
+      }
+
+      storeMarker( slot, marker );
+      markDirty( slot );
+   }
+
+   void MarkerBuffer :: removeMarker( int key )
+   // removes the marker with the given key
+   {
+      if( key < 0 || key >= (int) slotOfKey.size() || slotOfKey[key] < 0 ) return;
+
+      // move the last marker into the slot that becomes free
+      int slot = slotOfKey[key];
+      int last = keyOfSlot.size() - 1;
+      if( slot != last )
+      {
+         copy( instanceData.begin() + instanceComponents*last,
+               instanceData.begin() + instanceComponents*(last+1),
+               instanceData.begin() + instanceComponents*slot );
+         keyOfSlot[slot] = keyOfSlot[last];
+         slotOfKey[ keyOfSlot[slot] ] = slot;
+         markDirty( slot );
+      }
+
+      slotOfKey[key] = -1;
+      keyOfSlot.pop_back();
+      instanceData.resize( instanceComponents * keyOfSlot.size() );
+      dirtyEnd = min( dirtyEnd, last );
+      if( dirtyBegin >= dirtyEnd ) dirtyBegin = dirtyEnd = 0;
+   }
+
+   void MarkerBuffer :: removeMarkers( void )
+   // removes all markers
+   {
+      instanceData.clear();
+      slotOfKey.clear();
+      keyOfSlot.clear();
+      dirtyBegin = dirtyEnd = 0;
+   }
+
+   void MarkerBuffer :: storeMarker( int slot, const Marker& m )
+   // writes a marker into instanceData
+   {
+      GLfloat* d = &instanceData[ instanceComponents*slot ];
+
+      d[0] = m.center.x;
+      d[1] = m.center.y;
+      d[2] = m.center.z;
+      d[3] = m.radius;
+      for( int k = 0; k < 4; k++ ) d[4+k] = m.color[k];
+      d[8] = m.specular;
+   }
+
+   void MarkerBuffer :: markDirty( int slot )
+   // records that a slot of instanceData must be uploaded
+   {
+      if( dirtyBegin == dirtyEnd )
+      {
+         dirtyBegin = slot;
+         dirtyEnd = slot+1;
+      }
+      else
+      {
+         dirtyBegin = min( dirtyBegin, slot );
+         dirtyEnd = max( dirtyEnd, slot+1 );
+      }
+   }
+
+   int MarkerBuffer :: size( void ) const
+   // returns the number of markers
+   {
+      return instanceData.size() / instanceComponents;
+   }
+
+   void MarkerBuffer :: init( void )
+   // tessellates the sphere and checks for instancing support
+   {
+      // unit sphere with the same tessellation as glutSolidSphere(), whose
+      // normals equal its positions
+      vector<GLfloat> positions;
+      vector<GLuint> triangles;
+      const double PI = 3.141592653589793238462;
+      for( int i = 0; i <= stacks; i++ )
+      {
+         double phi = PI * i / stacks;
+         for( int j = 0; j <= slices; j++ )
+         {
+            double theta = 2. * PI * j / slices;
+            positions.push_back( sin( phi ) * cos( theta ));
+            positions.push_back( sin( phi ) * sin( theta ));
+            positions.push_back( cos( phi ));
+         }
+      }
+      for( int i = 0; i < stacks; i++ )
+      for( int j = 0; j < slices; j++ )
+      {
+         GLuint a =  i   *( slices+1 ) + j;
+         GLuint b = (i+1)*( slices+1 ) + j;
+         triangles.push_back( a ); triangles.push_back( b ); triangles.push_back( a+1 );
+         triangles.push_back( b ); triangles.push_back( b+1 ); triangles.push_back( a+1 );
+      }
+      sphere.setStream( MeshBuffer::positionStream, positions, 3 );
+      sphere.setStream( MeshBuffer::normalStream, positions, 3 );
+      sphere.setIndices( MeshBuffer::triangles, triangles );
+
+      const char* extensions = (const char*) glGetString( GL_EXTENSIONS );
+      instancing = extensions &&
+                   strstr( extensions, "GL_ARB_draw_instanced" ) &&
+                   strstr( extensions, "GL_ARB_instanced_arrays" );
+
+      initialized = true;
+   }
+
+   void MarkerBuffer :: draw( Shader& shader )
+   // draws all markers
+   {
+      int n = size();
+      if( n == 0 ) return;
+      if( !initialized ) init();
+
+      shader.enable();
+      const GLint attribute[3] = {
+         glGetAttribLocation( shader, "center" ),
+         glGetAttribLocation( shader, "color" ),
+         glGetAttribLocation( shader, "specular" )
+      };
+      const int components[3] = { 4, 4, 1 };
+      const int offset[3] = { 0, 4, 8 };
+
+      if( instancing )
+      {
+         if( instanceBuffer == 0 ) glGenBuffers( 1, &instanceBuffer );
+         glBindBuffer( GL_ARRAY_BUFFER, instanceBuffer );
+         const GLsizeiptr markerBytes = instanceComponents * sizeof( GLfloat );
+         if( n > instanceBufferSize )
+         {
+            // leave room to add markers later without reallocating
+            instanceBufferSize = max( n, 2*instanceBufferSize );
+            glBufferData( GL_ARRAY_BUFFER, instanceBufferSize * markerBytes, NULL, GL_DYNAMIC_DRAW );
+            glBufferSubData( GL_ARRAY_BUFFER, 0, n * markerBytes, &instanceData[0] );
+         }
+         else if( dirtyBegin < dirtyEnd )
+         {
+            // only upload the markers that changed
+            glBufferSubData( GL_ARRAY_BUFFER, dirtyBegin * markerBytes,
+                             ( dirtyEnd - dirtyBegin ) * markerBytes,
+                             &instanceData[ instanceComponents*dirtyBegin ] );
+         }
+         dirtyBegin = dirtyEnd = 0;
+
+         // attributes advance once per marker rather than once per vertex
+         const GLsizei stride = instanceComponents * sizeof( GLfloat );
+         for( int k = 0; k < 3; k++ )
+         {
+            if( attribute[k] < 0 ) continue;
+            glEnableVertexAttribArray( attribute[k] );
+            glVertexAttribPointer( attribute[k], components[k], GL_FLOAT, GL_FALSE, stride,
+                                   (const GLvoid*) ( offset[k] * sizeof( GLfloat )));
+            glVertexAttribDivisorARB( attribute[k], 1 );
+         }
+         glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+         sphere.draw( MeshBuffer::triangles, MeshBuffer::positionStream, true, false, n );
+
+         for( int k = 0; k < 3; k++ )
+         {
+            if( attribute[k] < 0 ) continue;
+            glVertexAttribDivisorARB( attribute[k], 0 );
+            glDisableVertexAttribArray( attribute[k] );
+         }
+      }
+      else
+      {
+         // the same attributes, set as constants for each draw call
+         for( int i = 0; i < n; i++ )
+         {
+            const GLfloat* d = &instanceData[ instanceComponents*i ];
+            for( int k = 0; k < 3; k++ )
+            {
+               if( attribute[k] < 0 ) continue;
+               if( components[k] == 4 ) glVertexAttrib4fv( attribute[k], d + offset[k] );
+               else                     glVertexAttrib1f ( attribute[k], d[ offset[k] ] );
+            }
+
+            sphere.draw( MeshBuffer::triangles, MeshBuffer::positionStream, true, false );
+         }
+      }
+
+      shader.disable();
+   }
+}
@@ -1,17 +1,32 @@
 #include <map>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 #include "Mesh.h"
 #include "MeshIO.h"
+#include "LinearContext.h"
 #include "DiscreteExteriorCalculus.h"
 
 using namespace std;
 
 namespace DDG
 {
+   extern LinearContext context;
+
    Mesh :: Mesh( void )
+   : elementOrdering( fileOrder ),
+     normalsValid( false ),
+     version( 1 ),
+     cacheVersion( 0 ),
+     cornersValid( false )
    {}
    
    Mesh :: Mesh( const Mesh& mesh )
+   : elementOrdering( fileOrder ),
+     normalsValid( false ),
+     version( 1 ),
+     cacheVersion( 0 ),
+     cornersValid( false )
    {
       *this = mesh;
    }
@@ -32,6 +47,14 @@ namespace DDG
       map<     EdgeCIter,     EdgeIter,     EdgeCIterCompare >     edgeOldToNew;
       map<     FaceCIter,     FaceIter,     FaceCIterCompare >     faceOldToNew;
       
+      // reserve storage up front, since the iterators stored in the maps
+      // below would be invalidated if a vector were reallocated
+      halfedges.reserve( mesh.halfedges.size() );
+      vertices.reserve( mesh.vertices.size() );
+      edges.reserve( mesh.edges.size() );
+      faces.reserve( mesh.faces.size() );
+      boundaries.reserve( mesh.boundaries.size() );
+
       // copy geometry from the original mesh and create a
       // map from pointers in the original mesh to
       // those in the new mesh
@@ -50,6 +73,10 @@ namespace DDG
       faces.clear();
       for(     FaceCIter  f =     mesh.faces.begin();  f !=     mesh.faces.end();  f++ )
          faceOldToNew[ f  ] =     faces.insert(     faces.end(), *f  );
+
+      boundaries.clear();
+      for(     FaceCIter  f = mesh.boundaries.begin();  f != mesh.boundaries.end();  f++ )
+         faceOldToNew[ f  ] = boundaries.insert( boundaries.end(), *f  );
       
       // "search and replace" old pointers with new ones
       for( HalfEdgeIter he = halfedges.begin(); he != halfedges.end(); he++ )
@@ -61,9 +88,23 @@ namespace DDG
          he->face   =     faceOldToNew[ he->face   ];
       }
       
-      for( VertexIter v = vertices.begin(); v != vertices.end(); v++ ) v->he = halfedgeOldToNew[ v->he ];
+      // (isolated vertices keep pointing to the shared dummy halfedge)
+      for( VertexIter v = vertices.begin(); v != vertices.end(); v++ ) if( !v->isIsolated() ) v->he = halfedgeOldToNew[ v->he ];
       for(   EdgeIter e =    edges.begin(); e !=    edges.end(); e++ ) e->he = halfedgeOldToNew[ e->he ];
       for(   FaceIter f =    faces.begin(); f !=    faces.end(); f++ ) f->he = halfedgeOldToNew[ f->he ];
+      for(   FaceIter f = boundaries.begin(); f != boundaries.end(); f++ ) f->he = halfedgeOldToNew[ f->he ];
+
+      elementOrdering = mesh.elementOrdering;
+      originalVertexIndex = mesh.originalVertexIndex;
+      originalFaceIndex = mesh.originalFaceIndex;
+      taggedVertices = mesh.taggedVertices;
+      hledVertices = mesh.hledVertices;
+      inputFilename = mesh.inputFilename;
+      clearVertexChanges();
+
+      // cached geometry is recomputed on demand
+      cornersValid = false;
+      invalidateGeometry();
       
       return *this;
    }
@@ -71,6 +112,8 @@ namespace DDG
    int Mesh::read( const string& filename )
    {
       inputFilename = filename;
+      cornersValid = false;
+      invalidateGeometry();
       ifstream in( filename.c_str() );
       
       if( !in.is_open() )
@@ -82,7 +125,11 @@ namespace DDG
       int rval;
       if( !( rval = MeshIO::read( in, *this )))
       {
+         originalVertexIndex.clear();
+         originalFaceIndex.clear();
+         clearVertexChanges();
          indexElements();
+         reorder( elementOrdering );
          normalize();
          for( VertexIter v = vertices.begin(); v != vertices.end(); v++ ) v->texture = v->position;
       }
@@ -137,6 +184,274 @@ namespace DDG
       {
          v->position /= rMax;
       }
+
+      invalidateGeometry();
+   }
+   
+   void Mesh::updateNormals( void )
+   // brings the cached face and vertex normals up to date
+   {
+      const int F = faces.size();
+      const int V = vertices.size();
+
+      if( normalsValid && (int) faceNormals.size() == F && (int) vertexNormals.size() == V )
+      {
+         return;
+      }
+
+      // face normals come first, since vertex normals are built from them;
+      // elements are independent within each pass, so both passes run in
+      // parallel when compiled with OpenMP
+      faceNormals.resize( F );
+      vertexNormals.resize( V );
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < F; i++ )
+      {
+         updateFaceNormal( i );
+      }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < V; i++ )
+      {
+         updateVertexNormal( i );
+      }
+
+      normalsValid = true;
+   }
+
+   void Mesh::invalidateNormals( void )
+   // marks all cached normals as out of date
+   {
+      normalsValid = false;
+   }
+
+   const Vector& Mesh::normal( VertexCIter v ) const
+   // returns the cached unit normal of a vertex
+   {
+      return vertexNormals[ v->index ];
+   }
+
+   const Vector& Mesh::normal( FaceCIter f ) const
+   // returns the cached unit normal of a face
+   {
+      return faceNormals[ f->index ];
+   }
+
+   void Mesh::updateFaceNormal( int i )
+   // recomputes the cached normal of the ith face
+   {
+      faceNormals[i] = faces[i].normal();
+   }
+
+   void Mesh::updateVertexNormal( int i )
+   // recomputes the cached normal of the ith vertex (cf. Vertex::normal())
+   {
+      const Vertex& v( vertices[i] );
+
+      if( v.isIsolated() )
+      {
+         vertexNormals[i] = Vector( 0., 0., 0. );
+         return;
+      }
+
+      Vector N;
+      HalfEdgeCIter h = v.he;
+      do
+      {
+         if( !h->onBoundary ) N += faceNormals[ h->face->index ];
+         h = h->flip->next;
+      }
+      while( h != v.he );
+
+      vertexNormals[i] = N.unit();
+   }
+   
+   void Mesh::invalidateGeometry( void )
+   // marks all cached geometric quantities as out of date
+   {
+      version++;
+      invalidateNormals();
+   }
+
+   unsigned long Mesh::geometryVersion( void ) const
+   {
+      return version;
+   }
+
+   double Mesh::cotan( HalfEdgeCIter h ) const
+   {
+      updateGeometry();
+      return cotans[ h - halfedges.begin() ];
+   }
+
+   double Mesh::area( FaceCIter f ) const
+   {
+      updateGeometry();
+      return faceAreas[ f - faces.begin() ];
+   }
+
+   double Mesh::dualArea( VertexCIter v ) const
+   {
+      updateGeometry();
+      return dualAreas[ v - vertices.begin() ];
+   }
+
+   void Mesh::updateCorners( void ) const
+   // records which vertices each cached quantity depends on
+   {
+      const int V = vertices.size();
+      const int F = faces.size();
+      const int H = halfedges.size();
+      VertexCIter v0 = vertices.begin();
+
+      halfedgeCorners.resize( 3*H );
+      for( int i = 0; i < H; i++ )
+      {
+         HalfEdgeCIter h = halfedges.begin() + i;
+         int* c = &halfedgeCorners[3*i];
+
+         if( h->onBoundary )
+         {
+            c[0] = c[1] = c[2] = -1;
+            continue;
+         }
+
+         // same vertices as in HalfEdge::cotan()
+         c[0] = h->next->next->vertex - v0;
+         c[1] = h->vertex - v0;
+         c[2] = h->next->vertex - v0;
+      }
+
+      faceCorners.resize( 3*F );
+      for( int i = 0; i < F; i++ )
+      {
+         HalfEdgeCIter h = faces[i].he;
+         faceCorners[3*i+0] = h->vertex - v0;
+         faceCorners[3*i+1] = h->next->vertex - v0;
+         faceCorners[3*i+2] = h->next->next->vertex - v0;
+      }
+
+      // faces are visited in the same order as in Vertex::area()
+      vertexFaceStart.resize( V+1 );
+      vertexFaces.clear();
+      vertexFaces.reserve( 2*H );
+      for( int i = 0; i < V; i++ )
+      {
+         vertexFaceStart[i] = vertexFaces.size();
+
+         const Vertex& v( vertices[i] );
+         if( v.isIsolated() ) continue;
+
+         HalfEdgeCIter h = v.he;
+         do
+         {
+            if( !h->onBoundary ) vertexFaces.push_back( h->face - faces.begin() );
+            h = h->flip->next;
+         }
+         while( h != v.he );
+      }
+      vertexFaceStart[V] = vertexFaces.size();
+
+      cornersValid = true;
+   }
+
+   void Mesh::updateGeometry( void ) const
+   // recomputes the cached cotangents and areas if they are out of date
+   {
+      const int V = vertices.size();
+      const int F = faces.size();
+      const int H = halfedges.size();
+
+      if( cacheVersion == version &&
+          (int) px.size() == V &&
+          (int) faceAreas.size() == F &&
+          (int) cotans.size() == H )
+      {
+         return;
+      }
+
+      if( !cornersValid ||
+          (int) halfedgeCorners.size() != 3*H ||
+          (int) faceCorners.size() != 3*F ||
+          (int) vertexFaceStart.size() != V+1 )
+      {
+         updateCorners();
+      }
+
+      // copy positions into separate coordinate arrays, so that the loops
+      // below are straight-line arithmetic on flat arrays that the compiler
+      // can vectorize; each loop is also parallel over elements
+      px.resize( V ); py.resize( V ); pz.resize( V );
+      for( int i = 0; i < V; i++ )
+      {
+         const Vector& p( vertices[i].position );
+         px[i] = p.x; py[i] = p.y; pz[i] = p.z;
+      }
+
+      const double* x = V ? &px[0] : NULL;
+      const double* y = V ? &py[0] : NULL;
+      const double* z = V ? &pz[0] : NULL;
+
+      // cotangent of the angle opposite each halfedge
+      cotans.resize( H );
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < H; i++ )
+      {
+         const int* c = &halfedgeCorners[3*i];
+         if( c[0] < 0 ) { cotans[i] = 0.; continue; }
+
+         double ux = x[c[1]]-x[c[0]], uy = y[c[1]]-y[c[0]], uz = z[c[1]]-z[c[0]];
+         double vx = x[c[2]]-x[c[0]], vy = y[c[2]]-y[c[0]], vz = z[c[2]]-z[c[0]];
+
+         double nx = uy*vz - uz*vy;
+         double ny = uz*vx - ux*vz;
+         double nz = ux*vy - uy*vx;
+
+         cotans[i] = ( ux*vx + uy*vy + uz*vz ) / sqrt( nx*nx + ny*ny + nz*nz );
+      }
+
+      // face areas
+      faceAreas.resize( F );
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < F; i++ )
+      {
+         const int* c = &faceCorners[3*i];
+
+         double ux = x[c[1]]-x[c[0]], uy = y[c[1]]-y[c[0]], uz = z[c[1]]-z[c[0]];
+         double vx = x[c[2]]-x[c[0]], vy = y[c[2]]-y[c[0]], vz = z[c[2]]-z[c[0]];
+
+         double nx = uy*vz - uz*vy;
+         double ny = uz*vx - ux*vz;
+         double nz = ux*vy - uy*vx;
+
+         faceAreas[i] = sqrt( nx*nx + ny*ny + nz*nz ) / 2.;
+      }
+
+      // barycentric dual areas (one third of the incident face areas)
+      dualAreas.resize( V );
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for( int i = 0; i < V; i++ )
+      {
+         double A = 0.;
+         for( int k = vertexFaceStart[i]; k < vertexFaceStart[i+1]; k++ )
+         {
+            A += faceAreas[ vertexFaces[k] ];
+         }
+         dualAreas[i] = A / 3.;
+      }
+
+      cacheVersion = version;
    }
    
    void Mesh::indexElements( void )
@@ -163,6 +478,408 @@ namespace DDG
       }
    }
    
+   void Mesh::reorder( ElementOrdering ordering )
+   // physically permutes all mesh elements according to the given vertex
+   // ordering, remaps connectivity, and reassigns indices
+   {
+      int nV = vertices.size();
+      int nE = edges.size();
+      int nF = faces.size();
+      int nH = halfedges.size();
+
+      if( ordering == fileOrder || nV == 0 )
+      {
+         return;
+      }
+
+      cornersValid = false;
+      invalidateGeometry();
+
+      indexElements();
+
+      // order vertices
+      vector<int> vertexOrder;
+      if( ordering == mortonOrder )
+      {
+         orderMorton( vertexOrder );
+      }
+      else if( ordering == nestedDissectionOrder && orderNestedDissection( vertexOrder ))
+      {
+         // (done)
+      }
+      else
+      {
+         if( ordering == nestedDissectionOrder )
+         {
+            cerr << "Warning: nested dissection is not available; using reverse Cuthill-McKee instead." << endl;
+         }
+         orderCuthillMcKee( vertexOrder );
+      }
+
+      vector<int> newVertexIndex( nV );
+      for( int k = 0; k < nV; k++ )
+      {
+         newVertexIndex[ vertexOrder[k] ] = k;
+      }
+
+      // order faces by their lowest vertex in the new order
+      vector< pair<int,int> > faceKeys( nF );
+      for( int i = 0; i < nF; i++ )
+      {
+         int key = nV;
+         HalfEdgeCIter he = faces[i].he;
+         do
+         {
+            key = min( key, newVertexIndex[ he->vertex->index ] );
+            he = he->next;
+         }
+         while( he != faces[i].he );
+
+         faceKeys[i] = make_pair( key, i );
+      }
+      sort( faceKeys.begin(), faceKeys.end() );
+
+      vector<int> faceOrder( nF );
+      for( int i = 0; i < nF; i++ )
+      {
+         faceOrder[i] = faceKeys[i].second;
+      }
+
+      // order halfedges face by face (followed by the boundary loops),
+      // and edges by the first halfedge that refers to them
+      vector<int> halfedgeOrder;
+      vector<int> edgeOrder;
+      vector<bool> edgeVisited( nE, false );
+      halfedgeOrder.reserve( nH );
+      edgeOrder.reserve( nE );
+      for( int i = 0; i < nF + (int) boundaries.size(); i++ )
+      {
+         const Face& f( i < nF ? faces[ faceOrder[i] ] : boundaries[ i-nF ] );
+         HalfEdgeIter he = f.he;
+         do
+         {
+            halfedgeOrder.push_back( he - halfedges.begin() );
+
+            int e = he->edge->index;
+            if( !edgeVisited[e] )
+            {
+               edgeVisited[e] = true;
+               edgeOrder.push_back( e );
+            }
+
+            he = he->next;
+         }
+         while( he != f.he );
+      }
+
+      if( (int) halfedgeOrder.size() != nH || (int) edgeOrder.size() != nE )
+      {
+         cerr << "Error: could not reorder mesh (halfedges not covered by faces)!" << endl;
+         return;
+      }
+
+      permuteElements( vertexOrder, edgeOrder, faceOrder, halfedgeOrder );
+      indexElements();
+
+      // keep track of indices in the input file
+      if( originalVertexIndex.empty() )
+      {
+         originalVertexIndex.resize( nV );
+         for( int i = 0; i < nV; i++ ) originalVertexIndex[i] = i;
+      }
+      if( originalFaceIndex.empty() )
+      {
+         originalFaceIndex.resize( nF );
+         for( int i = 0; i < nF; i++ ) originalFaceIndex[i] = i;
+      }
+      vector<int> vertexIndex( originalVertexIndex );
+      vector<int> faceIndex( originalFaceIndex );
+      for( int k = 0; k < nV; k++ ) originalVertexIndex[k] = vertexIndex[ vertexOrder[k] ];
+      for( int k = 0; k < nF; k++ ) originalFaceIndex[k] = faceIndex[ faceOrder[k] ];
+
+      // update any tagged vertices
+      for( list<int>::iterator i = taggedVertices.begin(); i != taggedVertices.end(); i++ ) *i = newVertexIndex[ *i ];
+      for( list<int>::iterator i =   hledVertices.begin(); i !=   hledVertices.end(); i++ ) *i = newVertexIndex[ *i ];
+
+      // and any recorded changes
+      for( int a = 0; a < nVertexAttributes; a++ )
+      {
+         vector<int> changed;
+         takeVertexChanges( (VertexAttribute) a, changed );
+         for( size_t i = 0; i < changed.size(); i++ )
+         {
+            markVertexChanged( newVertexIndex[ changed[i] ], (VertexAttribute) a );
+         }
+      }
+   }
+
+   void Mesh::permuteElements( const vector<int>& vertexOrder,
+                               const vector<int>& edgeOrder,
+                               const vector<int>& faceOrder,
+                               const vector<int>& halfedgeOrder )
+   // rearranges element storage and remaps all references between elements
+   {
+      int nV = vertices.size();
+      int nE = edges.size();
+      int nF = faces.size();
+      int nH = halfedges.size();
+
+      // copy elements into their new positions
+      vector<HalfEdge> newHalfedges( nH );
+      vector<Vertex>   newVertices ( nV );
+      vector<Edge>     newEdges    ( nE );
+      vector<Face>     newFaces    ( nF );
+      vector<int> halfedgeMap( nH ), vertexMap( nV ), edgeMap( nE ), faceMap( nF );
+      for( int k = 0; k < nH; k++ ) { newHalfedges[k] = halfedges[ halfedgeOrder[k] ]; halfedgeMap[ halfedgeOrder[k] ] = k; }
+      for( int k = 0; k < nV; k++ ) { newVertices [k] = vertices [ vertexOrder  [k] ];   vertexMap[   vertexOrder[k] ] = k; }
+      for( int k = 0; k < nE; k++ ) { newEdges    [k] = edges    [ edgeOrder    [k] ];     edgeMap[     edgeOrder[k] ] = k; }
+      for( int k = 0; k < nF; k++ ) { newFaces    [k] = faces    [ faceOrder    [k] ];     faceMap[     faceOrder[k] ] = k; }
+
+      // "search and replace" old references with new ones (boundary
+      // loops stay where they are, and isolated vertices keep pointing
+      // to the dummy halfedge)
+      for( HalfEdgeIter he = newHalfedges.begin(); he != newHalfedges.end(); he++ )
+      {
+         he->next   = newHalfedges.begin() + halfedgeMap[ he->next   - halfedges.begin() ];
+         he->flip   = newHalfedges.begin() + halfedgeMap[ he->flip   - halfedges.begin() ];
+         he->vertex = newVertices.begin()  +   vertexMap[ he->vertex -  vertices.begin() ];
+         he->edge   = newEdges.begin()     +     edgeMap[ he->edge   -     edges.begin() ];
+         if( !he->onBoundary )
+         {
+            he->face = newFaces.begin() + faceMap[ he->face - faces.begin() ];
+         }
+      }
+
+      for( VertexIter v = newVertices.begin(); v != newVertices.end(); v++ )
+      {
+         if( !v->isIsolated() ) v->he = newHalfedges.begin() + halfedgeMap[ v->he - halfedges.begin() ];
+      }
+      for( EdgeIter e = newEdges.begin(); e != newEdges.end(); e++ ) e->he = newHalfedges.begin() + halfedgeMap[ e->he - halfedges.begin() ];
+      for( FaceIter f = newFaces.begin(); f != newFaces.end(); f++ ) f->he = newHalfedges.begin() + halfedgeMap[ f->he - halfedges.begin() ];
+      for( FaceIter f = boundaries.begin(); f != boundaries.end(); f++ ) f->he = newHalfedges.begin() + halfedgeMap[ f->he - halfedges.begin() ];
+
+      // swapping preserves iterators into the new storage
+      halfedges.swap( newHalfedges );
+      vertices.swap( newVertices );
+      edges.swap( newEdges );
+      faces.swap( newFaces );
+   }
+
+   void Mesh::vertexAdjacency( vector<int>& start, vector<int>& neighbors ) const
+   // builds the vertex adjacency graph in compressed-row format: the
+   // neighbors of vertex i are neighbors[start[i]..start[i+1]-1]
+   {
+      int nV = vertices.size();
+
+      start.assign( nV+1, 0 );
+      for( EdgeCIter e = edges.begin(); e != edges.end(); e++ )
+      {
+         start[ e->he->vertex->index + 1 ]++;
+         start[ e->he->flip->vertex->index + 1 ]++;
+      }
+      for( int i = 0; i < nV; i++ )
+      {
+         start[i+1] += start[i];
+      }
+
+      neighbors.resize( start[nV] );
+      vector<int> next( start.begin(), start.end()-1 );
+      for( EdgeCIter e = edges.begin(); e != edges.end(); e++ )
+      {
+         int i = e->he->vertex->index;
+         int j = e->he->flip->vertex->index;
+         neighbors[ next[i]++ ] = j;
+         neighbors[ next[j]++ ] = i;
+      }
+   }
+
+   class DegreeCompare
+   // orders vertices by increasing degree
+   {
+      public:
+         DegreeCompare( const vector<int>& start_ ) : start( start_ ) {}
+         bool operator()( int i, int j ) const { return start[i+1]-start[i] < start[j+1]-start[j]; }
+      protected:
+         const vector<int>& start;
+   };
+
+   static int pseudoPeripheralVertex( int root,
+                                      const vector<int>& start,
+                                      const vector<int>& neighbors,
+                                      vector<int>& level )
+   // starting at root, looks for a vertex whose breadth-first search has as
+   // many levels as possible (level must contain -1 for every vertex in the
+   // component of root, and is left that way on return)
+   {
+      const int maxSweeps = 8;
+      vector<int> queue;
+      int depth = -1;
+
+      for( int sweep = 0; sweep < maxSweeps; sweep++ )
+      {
+         // breadth-first search from root
+         queue.clear();
+         queue.push_back( root );
+         level[root] = 0;
+         for( size_t k = 0; k < queue.size(); k++ )
+         {
+            int i = queue[k];
+            for( int p = start[i]; p < start[i+1]; p++ )
+            {
+               int j = neighbors[p];
+               if( level[j] < 0 )
+               {
+                  level[j] = level[i] + 1;
+                  queue.push_back( j );
+               }
+            }
+         }
+
+         int lastLevel = level[ queue.back() ];
+         int candidate = queue.back();
+         for( int k = queue.size()-1; k >= 0 && level[ queue[k] ] == lastLevel; k-- )
+         {
+            if( start[queue[k]+1]-start[queue[k]] < start[candidate+1]-start[candidate] )
+            {
+               candidate = queue[k];
+            }
+         }
+
+         for( size_t k = 0; k < queue.size(); k++ )
+         {
+            level[ queue[k] ] = -1;
+         }
+
+         // stop once the number of levels no longer grows
+         if( lastLevel <= depth ) break;
+         depth = lastLevel;
+         root = candidate;
+      }
+
+      return root;
+   }
+
+   void Mesh::orderCuthillMcKee( vector<int>& order ) const
+   // computes a reverse Cuthill-McKee ordering of the vertices
+   {
+      int nV = vertices.size();
+      vector<int> start, neighbors;
+      vertexAdjacency( start, neighbors );
+
+      vector<int> level( nV, -1 );
+      vector<bool> visited( nV, false );
+      order.clear();
+      order.reserve( nV );
+
+      // order each connected component separately
+      for( int root = 0; root < nV; root++ )
+      {
+         if( visited[root] ) continue;
+
+         int s = pseudoPeripheralVertex( root, start, neighbors, level );
+         size_t first = order.size();
+         order.push_back( s );
+         visited[s] = true;
+
+         // breadth-first search, visiting neighbors in order of increasing degree
+         for( size_t k = first; k < order.size(); k++ )
+         {
+            int i = order[k];
+            size_t begin = order.size();
+            for( int p = start[i]; p < start[i+1]; p++ )
+            {
+               int j = neighbors[p];
+               if( !visited[j] )
+               {
+                  visited[j] = true;
+                  order.push_back( j );
+               }
+            }
+            stable_sort( order.begin()+begin, order.end(), DegreeCompare( start ));
+         }
+      }
+
+      reverse( order.begin(), order.end() );
+   }
+
+   static unsigned int spreadBits( unsigned int x )
+   // inserts two zero bits between each of the low 10 bits of x
+   {
+      x &= 0x000003ff;
+      x = ( x | ( x << 16 )) & 0xff0000ff;
+      x = ( x | ( x <<  8 )) & 0x0300f00f;
+      x = ( x | ( x <<  4 )) & 0x030c30c3;
+      x = ( x | ( x <<  2 )) & 0x09249249;
+      return x;
+   }
+
+   void Mesh::orderMorton( vector<int>& order ) const
+   // orders vertices along a Morton (Z-order) curve through their positions
+   {
+      int nV = vertices.size();
+
+      // compute bounding box
+      Vector cMin = vertices[0].position;
+      Vector cMax = vertices[0].position;
+      for( VertexCIter v = vertices.begin(); v != vertices.end(); v++ )
+      {
+         cMin.x = min( cMin.x, v->position.x ); cMax.x = max( cMax.x, v->position.x );
+         cMin.y = min( cMin.y, v->position.y ); cMax.y = max( cMax.y, v->position.y );
+         cMin.z = min( cMin.z, v->position.z ); cMax.z = max( cMax.z, v->position.z );
+      }
+      double extent = max( cMax.x-cMin.x, max( cMax.y-cMin.y, cMax.z-cMin.z ));
+      double scale = extent > 0. ? 1023./extent : 0.;
+
+      // sort vertices by the interleaved bits of their
+      // quantized coordinates (10 bits per axis)
+      vector< pair<unsigned int,int> > keys( nV );
+      for( int i = 0; i < nV; i++ )
+      {
+         const Vector& p( vertices[i].position );
+         unsigned int x = (unsigned int)( scale*( p.x-cMin.x ));
+         unsigned int y = (unsigned int)( scale*( p.y-cMin.y ));
+         unsigned int z = (unsigned int)( scale*( p.z-cMin.z ));
+         keys[i] = make_pair( spreadBits(x) | ( spreadBits(y) << 1 ) | ( spreadBits(z) << 2 ), i );
+      }
+      sort( keys.begin(), keys.end() );
+
+      order.resize( nV );
+      for( int i = 0; i < nV; i++ )
+      {
+         order[i] = keys[i].second;
+      }
+   }
+
+   bool Mesh::orderNestedDissection( vector<int>& order ) const
+   // computes a nested dissection ordering of the vertices using METIS (via
+   // CHOLMOD); returns false if CHOLMOD was built without METIS support
+   {
+      int nV = vertices.size();
+      vector<int> start, neighbors;
+      vertexAdjacency( start, neighbors );
+
+      // build the (symmetric) pattern of the vertex adjacency matrix
+      int sorted = false;
+      int packed = true;
+      int stype = 1;
+      cholmod_sparse* A = cholmod_l_allocate_sparse( nV, nV, max( 1, (int) neighbors.size() ),
+                                                     sorted, packed, stype, CHOLMOD_PATTERN, context );
+      UF_long* Ap = (UF_long*) A->p;
+      UF_long* Ai = (UF_long*) A->i;
+      for( int i = 0; i <= nV; i++ ) Ap[i] = start[i];
+      for( size_t k = 0; k < neighbors.size(); k++ ) Ai[k] = neighbors[k];
+
+      vector<UF_long> perm( nV );
+      int postorder = true;
+      int ok = cholmod_l_metis( A, NULL, 0, postorder, &perm[0], context );
+      cholmod_l_free_sparse( &A, context );
+
+      if( !ok ) return false;
+
+      order.assign( perm.begin(), perm.end() );
+      return true;
+   }
+
    double Mesh::area( void ) const
    {
       double sum = 0.0;
@@ -170,7 +887,7 @@ namespace DDG
           f != faces.end();
           f ++ )
       {
-         sum += f->area();
+         sum += area( f );
       }
       return sum;
    }
@@ -204,6 +921,8 @@ namespace DDG
    void Mesh::toggleVertexTag( int index ) 
    {
       vertices[index].toggleTag();
+      markVertexChanged( index, vertexTag );
+      markVertexChanged( index, vertexWinding );
 
       if ( vertices[index].tag )
       {
@@ -214,6 +933,7 @@ namespace DDG
       {
          taggedVertices.remove( index );
          hledVertices.remove( index );
+         markVertexChanged( index, vertexHighlight );
       }
    }
 
@@ -221,6 +941,10 @@ namespace DDG
    {
       if ( vertices[index].tag )
       {
+         if ( hledVertices.size() > 0 )
+            markVertexChanged( hledVertices.front(), vertexHighlight );
+         markVertexChanged( index, vertexHighlight );
+
          if ( hledVertices.size() == 0 )
             hledVertices.push_back( index );
          else if ( hledVertices.front() == index )
@@ -229,5 +953,39 @@ namespace DDG
             hledVertices.front() = index;
       }
    }
+
+   void Mesh::markVertexChanged( int index, VertexAttribute attribute )
+   {
+      vector<bool>& flags( vertexChangeFlags[attribute] );
+      if( flags.size() != vertices.size() ) flags.resize( vertices.size(), false );
+
+      // each vertex is listed only once, however often it changes
+      if( !flags[index] )
+      {
+         flags[index] = true;
+         changedVertices[attribute].push_back( index );
+      }
+   }
+
+   void Mesh::takeVertexChanges( VertexAttribute attribute, vector<int>& changed )
+   {
+      changed.clear();
+      changed.swap( changedVertices[attribute] );
+
+      vector<bool>& flags( vertexChangeFlags[attribute] );
+      for( size_t i = 0; i < changed.size(); i++ )
+      {
+         if( changed[i] < (int) flags.size() ) flags[ changed[i] ] = false;
+      }
+   }
+
+   void Mesh::clearVertexChanges( void )
+   {
+      for( int a = 0; a < nVertexAttributes; a++ )
+      {
+         changedVertices[a].clear();
+         vertexChangeFlags[a].clear();
+      }
+   }
 }
 
@@ -0,0 +1,467 @@
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "MeshBVH.h"
+
+namespace DDG
+{
+   const int maxLeafSize = 4;
+   // number of primitives below which a node is not split further
+
+   const int maxDepth = 64;
+   // size of the traversal stack (median splits keep the depth near log2 n)
+
+   class CenterCompare
+   // orders primitives by one coordinate of their center
+   {
+      public:
+         CenterCompare( const vector<Vector>& center_, int axis_ )
+         : center( center_ ), axis( axis_ ) {}
+
+         bool operator()( int i, int j ) const
+         {
+            return center[i][axis] < center[j][axis];
+         }
+
+      protected:
+         const vector<Vector>& center;
+         int axis;
+   };
+
+   static bool hitBox( const Vector& lower, const Vector& upper,
+                       const Vector& origin, const Vector& inverse,
+                       double tMax, double& tEnter )
+   // clips the ray against an axis-aligned box; returns true if it enters
+   // the box before tMax, and stores the distance at which it does so
+   {
+      double t0 = 0.;
+      double t1 = tMax;
+
+      for( int k = 0; k < 3; k++ )
+      {
+         double a = ( lower[k] - origin[k] ) * inverse[k];
+         double b = ( upper[k] - origin[k] ) * inverse[k];
+         if( a > b ) swap( a, b );
+
+         t0 = max( t0, a );
+         t1 = min( t1, b );
+         if( t0 > t1 ) return false;
+      }
+
+      tEnter = t0;
+      return true;
+   }
+
+   static bool hitTriangle( const Vector& p0, const Vector& p1, const Vector& p2,
+                            const Vector& origin, const Vector& direction,
+                            double& t, double& b1, double& b2 )
+   // intersects the ray with a triangle (from either side); b1 and b2 are
+   // the barycentric coordinates of the hit point with respect to p1 and p2
+   {
+      Vector e1 = p1 - p0;
+      Vector e2 = p2 - p0;
+
+      Vector q = cross( direction, e2 );
+      double det = dot( e1, q );
+      if( fabs( det ) < 1e-300 ) return false;
+
+      Vector s = origin - p0;
+      b1 = dot( s, q ) / det;
+      if( b1 < 0. || b1 > 1. ) return false;
+
+      Vector r = cross( s, e1 );
+      b2 = dot( direction, r ) / det;
+      if( b2 < 0. || b1 + b2 > 1. ) return false;
+
+      t = dot( e2, r ) / det;
+      return t > 0.;
+   }
+
+   static bool invert( const double A[16], double B[16] )
+   // inverts a 4x4 matrix by Gauss-Jordan elimination with partial pivoting
+   {
+      double M[4][8];
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         M[i][j] = A[ 4*j+i ]; // (column-major, as in OpenGL)
+         M[i][j+4] = ( i == j ? 1. : 0. );
+      }
+
+      for( int j = 0; j < 4; j++ )
+      {
+         int p = j;
+         for( int i = j+1; i < 4; i++ )
+         {
+            if( fabs( M[i][j] ) > fabs( M[p][j] )) p = i;
+         }
+         if( M[p][j] == 0. ) return false;
+         for( int k = 0; k < 8; k++ ) swap( M[j][k], M[p][k] );
+
+         double s = 1. / M[j][j];
+         for( int k = 0; k < 8; k++ ) M[j][k] *= s;
+
+         for( int i = 0; i < 4; i++ )
+         {
+            if( i == j ) continue;
+            double c = M[i][j];
+            for( int k = 0; k < 8; k++ ) M[i][k] -= c * M[j][k];
+         }
+      }
+
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         B[ 4*j+i ] = M[i][j+4];
+      }
+
+      return true;
+   }
+
+   MeshBVH :: Hit :: Hit( void )
+   : face( -1 ),
+     edge( -1 ),
+     vertex( -1 ),
+     t( 0. )
+   {}
+
+   MeshBVH :: MeshBVH( void )
+   : source( NULL ),
+     sourceCoordinates( positionCoordinates ),
+     sourceVersion( 0 ),
+     valid( false )
+   {}
+
+   void MeshBVH :: invalidate( void )
+   // forces the next call to update() to rebuild the hierarchies
+   {
+      valid = false;
+   }
+
+   void MeshBVH :: update( const Mesh& mesh, Coordinates coordinates )
+   // rebuilds the hierarchies only if they are out of date
+   {
+      if( valid &&
+          source == &mesh &&
+          sourceCoordinates == coordinates &&
+          sourceVersion == mesh.geometryVersion() &&
+          faceIndex.size() == mesh.faces.size() &&
+          vertexIndex.size() == mesh.vertices.size() )
+      {
+         return;
+      }
+
+      build( mesh, coordinates );
+   }
+
+   void MeshBVH :: build( const Mesh& mesh, Coordinates coordinates )
+   // builds the hierarchies over the faces and vertices of mesh
+   {
+      const int nF = mesh.faces.size();
+      const int nV = mesh.vertices.size();
+
+      // faces
+      vector<Vector> lower( nF ), upper( nF ), center( nF ), p( 3*nF );
+      vector<int> order( nF );
+      for( int i = 0; i < nF; i++ )
+      {
+         HalfEdgeCIter h = mesh.faces[i].he;
+         for( int k = 0; k < 3; k++ )
+         {
+            p[3*i+k] = ( coordinates == positionCoordinates ) ?
+                       h->vertex->position : h->vertex->texture;
+            h = h->next;
+         }
+
+         for( int k = 0; k < 3; k++ )
+         {
+            lower[i][k] = min( p[3*i][k], min( p[3*i+1][k], p[3*i+2][k] ));
+            upper[i][k] = max( p[3*i][k], max( p[3*i+1][k], p[3*i+2][k] ));
+         }
+         center[i] = ( lower[i] + upper[i] ) / 2.;
+         order[i] = i;
+      }
+
+      faceNodes.clear();
+      if( nF > 0 ) buildNodes( faceNodes, order, lower, upper, center, 0, nF );
+
+      corners.resize( 3*nF );
+      faceIndex.resize( nF );
+      faceVertices.resize( 3*nF );
+      faceEdges.resize( 3*nF );
+      for( int i = 0; i < nF; i++ )
+      {
+         const Face& f( mesh.faces[ order[i] ] );
+         HalfEdgeCIter h = f.he;
+
+         faceIndex[i] = f.index;
+         for( int k = 0; k < 3; k++ )
+         {
+            corners[3*i+k] = p[ 3*order[i]+k ];
+            faceVertices[3*i+k] = h->vertex->index;
+            faceEdges[3*i+(k+2)%3] = h->edge->index; // (opposite the third corner)
+            h = h->next;
+         }
+      }
+
+      // vertices
+      lower.resize( nV );
+      center.resize( nV );
+      order.resize( nV );
+      for( int i = 0; i < nV; i++ )
+      {
+         const Vertex& v( mesh.vertices[i] );
+         center[i] = ( coordinates == positionCoordinates ) ? v.position : v.texture;
+         order[i] = i;
+      }
+
+      vertexNodes.clear();
+      if( nV > 0 ) buildNodes( vertexNodes, order, center, center, center, 0, nV );
+
+      points.resize( nV );
+      vertexIndex.resize( nV );
+      for( int i = 0; i < nV; i++ )
+      {
+         points[i] = center[ order[i] ];
+         vertexIndex[i] = mesh.vertices[ order[i] ].index;
+      }
+
+      source = &mesh;
+      sourceCoordinates = coordinates;
+      sourceVersion = mesh.geometryVersion();
+      valid = true;
+   }
+
+   int MeshBVH :: buildNodes( vector<Node>& nodes,
+                              vector<int>& order,
+                              const vector<Vector>& lower,
+                              const vector<Vector>& upper,
+                              const vector<Vector>& center,
+                              int first, int count )
+   // recursively builds a subtree over a range of primitives
+   {
+      int n = nodes.size();
+      nodes.push_back( Node() );
+
+      Vector lo = lower[ order[first] ];
+      Vector hi = upper[ order[first] ];
+      Vector cLo = center[ order[first] ];
+      Vector cHi = cLo;
+      for( int i = first+1; i < first+count; i++ )
+      {
+         int j = order[i];
+         for( int k = 0; k < 3; k++ )
+         {
+            lo[k] = min( lo[k], lower[j][k] );
+            hi[k] = max( hi[k], upper[j][k] );
+            cLo[k] = min( cLo[k], center[j][k] );
+            cHi[k] = max( cHi[k], center[j][k] );
+         }
+      }
+
+      nodes[n].lower = lo;
+      nodes[n].upper = hi;
+      nodes[n].first = first;
+      nodes[n].count = count;
+      nodes[n].right = -1;
+
+      if( count <= maxLeafSize )
+      {
+         return n;
+      }
+
+      // split at the median along the axis where the centers are most spread out
+      Vector extent = cHi - cLo;
+      int axis = 0;
+      if( extent[1] > extent[axis] ) axis = 1;
+      if( extent[2] > extent[axis] ) axis = 2;
+
+      int half = count / 2;
+      nth_element( order.begin() + first,
+                   order.begin() + first + half,
+                   order.begin() + first + count,
+                   CenterCompare( center, axis ));
+
+      nodes[n].count = 0;
+      buildNodes( nodes, order, lower, upper, center, first, half );
+      int right = buildNodes( nodes, order, lower, upper, center, first+half, count-half );
+      nodes[n].right = right; // (nodes may have been reallocated)
+
+      return n;
+   }
+
+   bool MeshBVH :: intersect( const Vector& origin, const Vector& direction, Hit& hit ) const
+   // finds the first face hit by the given ray
+   {
+      if( faceNodes.empty() ) return false;
+
+      Vector inverse( 1./direction.x, 1./direction.y, 1./direction.z );
+      double tBest = HUGE_VAL;
+      int best = -1;
+      double b1Best = 0., b2Best = 0.;
+
+      int stack[ maxDepth ];
+      int top = 0;
+      stack[ top++ ] = 0;
+
+      while( top > 0 )
+      {
+         const Node& node( faceNodes[ stack[ --top ]] );
+
+         double tEnter;
+         if( !hitBox( node.lower, node.upper, origin, inverse, tBest, tEnter ))
+         {
+            continue;
+         }
+
+         if( node.count > 0 )
+         {
+            for( int i = node.first; i < node.first + node.count; i++ )
+            {
+               double t, b1, b2;
+               if( hitTriangle( corners[3*i], corners[3*i+1], corners[3*i+2],
+                                origin, direction, t, b1, b2 ) && t < tBest )
+               {
+                  tBest = t;
+                  best = i;
+                  b1Best = b1;
+                  b2Best = b2;
+               }
+            }
+         }
+         else if( top+2 <= maxDepth )
+         {
+            int left = &node - &faceNodes[0] + 1;
+            stack[ top++ ] = node.right;
+            stack[ top++ ] = left;
+         }
+      }
+
+      if( best < 0 ) return false;
+
+      // the closest vertex has the largest barycentric coordinate, and the
+      // closest edge is opposite the vertex with the smallest one
+      double b[3] = { 1. - b1Best - b2Best, b1Best, b2Best };
+      int kMax = 0, kMin = 0;
+      for( int k = 1; k < 3; k++ )
+      {
+         if( b[k] > b[kMax] ) kMax = k;
+         if( b[k] < b[kMin] ) kMin = k;
+      }
+
+      hit.face = faceIndex[best];
+      hit.vertex = faceVertices[ 3*best+kMax ];
+      hit.edge = faceEdges[ 3*best+kMin ];
+      hit.t = tBest;
+      hit.point = origin + tBest * direction;
+
+      return true;
+   }
+
+   int MeshBVH :: pickVertex( const Vector& origin, const Vector& direction, double tolerance ) const
+   // returns the vertex closest to the ray origin among all vertices near the ray
+   {
+      if( vertexNodes.empty() ) return -1;
+
+      Vector inverse( 1./direction.x, 1./direction.y, 1./direction.z );
+      double tBest = HUGE_VAL;
+      int best = -1;
+
+      int stack[ maxDepth ];
+      int top = 0;
+      stack[ top++ ] = 0;
+
+      while( top > 0 )
+      {
+         const Node& node( vertexNodes[ stack[ --top ]] );
+
+         // grow the box by the largest distance from the ray that is
+         // accepted anywhere inside it (which bounds the distance to the
+         // ray of any vertex in the cone around it)
+         double tFar = 0.;
+         for( int k = 0; k < 3; k++ )
+         {
+            double d = max( fabs( node.lower[k] - origin[k] ), fabs( node.upper[k] - origin[k] ));
+            tFar += d*d;
+         }
+         double r = tolerance * sqrt( tFar );
+         Vector grow( r, r, r );
+
+         double tEnter;
+         if( !hitBox( node.lower - grow, node.upper + grow, origin, inverse, tBest + r, tEnter ))
+         {
+            continue;
+         }
+
+         if( node.count > 0 )
+         {
+            for( int i = node.first; i < node.first + node.count; i++ )
+            {
+               Vector w = points[i] - origin;
+               double t = dot( w, direction );
+               if( t <= 0. || t >= tBest ) continue;
+
+               double d2 = w.norm2() - t*t;
+               if( d2 <= tolerance*tolerance*t*t )
+               {
+                  tBest = t;
+                  best = i;
+               }
+            }
+         }
+         else if( top+2 <= maxDepth )
+         {
+            int left = &node - &vertexNodes[0] + 1;
+            stack[ top++ ] = node.right;
+            stack[ top++ ] = left;
+         }
+      }
+
+      return best < 0 ? -1 : vertexIndex[best];
+   }
+
+   void MeshBVH :: pixelRay( double x, double y,
+                             const double modelview[16],
+                             const double projection[16],
+                             const int viewport[4],
+                             Vector& origin, Vector& direction )
+   // computes the ray through window coordinates (x,y) for the given view
+   {
+      // combined transformation from object to clip coordinates
+      double M[16], Minv[16];
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         double s = 0.;
+         for( int k = 0; k < 4; k++ ) s += projection[4*k+i] * modelview[4*j+k];
+         M[4*j+i] = s;
+      }
+
+      if( !invert( M, Minv ))
+      {
+         origin = Vector( 0., 0., 0. );
+         direction = Vector( 0., 0., -1. );
+         return;
+      }
+
+      // map the pixel on the near and far clipping planes back to object space
+      double ndc[2] = { 2. * ( x - viewport[0] ) / viewport[2] - 1.,
+                        2. * ( y - viewport[1] ) / viewport[3] - 1. };
+      Vector p[2];
+      for( int n = 0; n < 2; n++ )
+      {
+         double c[4] = { ndc[0], ndc[1], n == 0 ? -1. : 1., 1. };
+         double q[4];
+         for( int i = 0; i < 4; i++ )
+         {
+            q[i] = 0.;
+            for( int k = 0; k < 4; k++ ) q[i] += Minv[4*k+i] * c[k];
+         }
+         p[n] = Vector( q[0], q[1], q[2] ) / q[3];
+      }
+
+      origin = p[0];
+      direction = ( p[1] - p[0] ).unit();
+   }
+}
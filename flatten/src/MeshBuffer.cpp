@@ -0,0 +1,223 @@
+#include "MeshBuffer.h"
+
+namespace DDG
+{
+   MeshBuffer :: MeshBuffer( void )
+   {
+      for( int i = 0; i < nStreams; i++ )
+      {
+         streamBuffer[i] = 0;
+         streamSize[i] = 0;
+         streamComponents[i] = 0;
+      }
+   }
+
+   void MeshBuffer :: clear( void )
+   // releases all buffer objects
+   {
+      for( int i = 0; i < nStreams; i++ )
+      {
+         if( streamBuffer[i] ) glDeleteBuffers( 1, &streamBuffer[i] );
+         streamBuffer[i] = 0;
+         streamSize[i] = 0;
+         streamComponents[i] = 0;
+      }
+
+      for( int i = 0; i < nPrimitives; i++ )
+      {
+         setLevels( (Primitive) i, 0 );
+      }
+   }
+
+   void MeshBuffer :: setStream( Stream s, const std::vector<GLfloat>& data, int nComponents )
+   // replaces the contents of a stream
+   {
+      int n = data.size() / nComponents;
+      GLsizeiptr bytes = n * nComponents * sizeof( GLfloat );
+
+      if( streamBuffer[s] == 0 ) glGenBuffers( 1, &streamBuffer[s] );
+      glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[s] );
+
+      // reuse the existing storage if the size is unchanged
+      if( n == streamSize[s] && nComponents == streamComponents[s] )
+      {
+         if( bytes > 0 ) glBufferSubData( GL_ARRAY_BUFFER, 0, bytes, &data[0] );
+      }
+      else
+      {
+         glBufferData( GL_ARRAY_BUFFER, bytes, bytes > 0 ? &data[0] : NULL, GL_STATIC_DRAW );
+      }
+
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+      streamSize[s] = n;
+      streamComponents[s] = nComponents;
+   }
+
+   void MeshBuffer :: updateStream( Stream s, int first, int count, const GLfloat* data )
+   // overwrites the values of vertices first, ..., first+count-1
+   {
+      if( streamBuffer[s] == 0 || count <= 0 || first < 0 || first+count > streamSize[s] )
+      {
+         return;
+      }
+
+      GLintptr offset = first * streamComponents[s] * sizeof( GLfloat );
+      GLsizeiptr bytes = count * streamComponents[s] * sizeof( GLfloat );
+
+      glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[s] );
+      glBufferSubData( GL_ARRAY_BUFFER, offset, bytes, data );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+   bool MeshBuffer :: hasStream( Stream s ) const
+   // returns true if data has been uploaded to the given stream
+   {
+      return streamBuffer[s] != 0 && streamSize[s] > 0;
+   }
+
+   int MeshBuffer :: size( Stream s ) const
+   // returns the number of vertices in the given stream
+   {
+      return streamSize[s];
+   }
+
+   void MeshBuffer :: setIndices( Primitive p, const std::vector<GLuint>& indices, int level )
+   // replaces the vertex indices used to draw the given primitive type
+   {
+      if( level >= levels( p )) setLevels( p, level+1 );
+
+      GLuint& buffer( indexBuffer[p][level] );
+      int& count( indexCount[p][level] );
+      GLsizeiptr bytes = indices.size() * sizeof( GLuint );
+
+      if( buffer == 0 ) glGenBuffers( 1, &buffer );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, buffer );
+
+      if( (int) indices.size() == count )
+      {
+         if( bytes > 0 ) glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, bytes, &indices[0] );
+      }
+      else
+      {
+         glBufferData( GL_ELEMENT_ARRAY_BUFFER, bytes, bytes > 0 ? &indices[0] : NULL, GL_STATIC_DRAW );
+      }
+
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+      count = indices.size();
+   }
+
+   void MeshBuffer :: setLevels( Primitive p, int n )
+   // sets the number of levels of the given primitive type
+   {
+      for( int i = n; i < levels( p ); i++ )
+      {
+         if( indexBuffer[p][i] ) glDeleteBuffers( 1, &indexBuffer[p][i] );
+      }
+
+      indexBuffer[p].resize( n, 0 );
+      indexCount[p].resize( n, 0 );
+   }
+
+   int MeshBuffer :: levels( Primitive p ) const
+   // returns the number of levels of the given primitive type
+   {
+      return indexBuffer[p].size();
+   }
+
+   int MeshBuffer :: size( Primitive p, int level ) const
+   // returns the number of indices for the given primitive type and level
+   {
+      if( level < 0 || level >= levels( p )) return 0;
+      return indexCount[p][level];
+   }
+
+   void MeshBuffer :: draw( Primitive p, Stream positions, bool useNormals, bool useColors, int instances, int level ) const
+   // draws all primitives of the given type
+   {
+      int count = size( p, level );
+      if( count == 0 || !hasStream( positions ) || instances <= 0 )
+      {
+         return;
+      }
+
+      bindStreams( positions, useNormals, useColors );
+
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer[p][level] );
+      if( instances == 1 )
+      {
+         glDrawElements( mode( p ), count, GL_UNSIGNED_INT, NULL );
+      }
+      else
+      {
+         glDrawElementsInstancedARB( mode( p ), count, GL_UNSIGNED_INT, NULL, instances );
+      }
+
+      unbindStreams();
+   }
+
+   void MeshBuffer :: draw( Primitive p, const std::vector<int>& first, const std::vector<int>& count,
+                            Stream positions, bool useNormals, bool useColors ) const
+   // draws the given ranges of the index buffer
+   {
+      if( first.empty() || size( p ) == 0 || !hasStream( positions ))
+      {
+         return;
+      }
+
+      std::vector<GLsizei> counts( count.begin(), count.end() );
+      std::vector<const GLvoid*> offsets( first.size() );
+      for( size_t i = 0; i < first.size(); i++ )
+      {
+         offsets[i] = (const GLvoid*) ( first[i] * sizeof( GLuint ));
+      }
+
+      bindStreams( positions, useNormals, useColors );
+
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer[p][0] );
+      glMultiDrawElements( mode( p ), &counts[0], GL_UNSIGNED_INT, &offsets[0], offsets.size() );
+
+      unbindStreams();
+   }
+
+   void MeshBuffer :: bindStreams( Stream positions, bool useNormals, bool useColors ) const
+   // sets up vertex arrays for drawing
+   {
+      glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT );
+
+      glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[positions] );
+      glEnableClientState( GL_VERTEX_ARRAY );
+      glVertexPointer( streamComponents[positions], GL_FLOAT, 0, NULL );
+
+      if( useNormals && hasStream( normalStream ))
+      {
+         glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[normalStream] );
+         glEnableClientState( GL_NORMAL_ARRAY );
+         glNormalPointer( GL_FLOAT, 0, NULL );
+      }
+
+      if( useColors && hasStream( colorStream ))
+      {
+         glBindBuffer( GL_ARRAY_BUFFER, streamBuffer[colorStream] );
+         glEnableClientState( GL_COLOR_ARRAY );
+         glColorPointer( streamComponents[colorStream], GL_FLOAT, 0, NULL );
+      }
+   }
+
+   void MeshBuffer :: unbindStreams( void ) const
+   // restores the vertex array state changed by bindStreams()
+   {
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+      glPopClientAttrib();
+   }
+
+   GLenum MeshBuffer :: mode( Primitive p )
+   // returns the OpenGL primitive mode for a primitive type
+   {
+      const GLenum modes[ nPrimitives ] = { GL_TRIANGLES, GL_LINES, GL_POINTS };
+      return modes[p];
+   }
+}
@@ -0,0 +1,269 @@
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "MeshChunks.h"
+
+namespace DDG
+{
+   class CentroidCompare
+   // orders primitives by one coordinate of their centroid
+   {
+      public:
+         CentroidCompare( const vector<Vector>& centroid_, int axis_ )
+         : centroid( centroid_ ), axis( axis_ ) {}
+
+         bool operator()( int i, int j ) const
+         {
+            return centroid[i][axis] < centroid[j][axis];
+         }
+
+      protected:
+         const vector<Vector>& centroid;
+         int axis;
+   };
+
+   MeshChunks :: MeshChunks( void )
+   : positions( NULL ),
+     indices( NULL ),
+     nVertices( 0 ),
+     maxPrimitives( 0 )
+   {}
+
+   void MeshChunks :: clear( void )
+   // removes all chunks
+   {
+      chunks.clear();
+   }
+
+   int MeshChunks :: size( void ) const
+   // returns the number of chunks
+   {
+      return chunks.size();
+   }
+
+   void MeshChunks :: build( const vector<float>& positions_,
+                             vector<unsigned int>& indices_,
+                             int verticesPerPrimitive,
+                             int primitivesPerChunk )
+   // splits the primitives into chunks
+   {
+      chunks.clear();
+
+      positions = &positions_;
+      indices = &indices_;
+      nVertices = verticesPerPrimitive;
+      maxPrimitives = max( 1, primitivesPerChunk );
+
+      int n = indices_.size() / nVertices;
+      order.resize( n );
+      centroids.resize( n );
+      for( int i = 0; i < n; i++ )
+      {
+         order[i] = i;
+
+         Vector c( 0., 0., 0. );
+         for( int k = 0; k < nVertices; k++ )
+         {
+            const float* p = &positions_[ 3*indices_[ nVertices*i + k ] ];
+            c += Vector( p[0], p[1], p[2] );
+         }
+         centroids[i] = c / (double) nVertices;
+      }
+
+      split( 0, n );
+
+      // store the primitives in chunk order
+      vector<unsigned int> sorted( nVertices*n );
+      for( int i = 0; i < n; i++ )
+      for( int k = 0; k < nVertices; k++ )
+      {
+         sorted[ nVertices*i + k ] = indices_[ nVertices*order[i] + k ];
+      }
+      sorted.insert( sorted.end(), indices_.begin() + nVertices*n, indices_.end() );
+      indices_.swap( sorted );
+
+      positions = NULL;
+      indices = NULL;
+      vector<int>().swap( order );
+      vector<Vector>().swap( centroids );
+   }
+
+   void MeshChunks :: split( int begin, int end )
+   // sorts primitives begin, ..., end-1 into chunks
+   {
+      if( end - begin <= maxPrimitives )
+      {
+         if( end > begin ) addChunk( begin, end );
+         return;
+      }
+
+      // split at the median along the axis where the centroids are most spread out
+      Vector lo = centroids[ order[begin] ];
+      Vector hi = lo;
+      for( int i = begin; i < end; i++ )
+      {
+         const Vector& c( centroids[ order[i] ] );
+         for( int k = 0; k < 3; k++ )
+         {
+            lo[k] = min( lo[k], c[k] );
+            hi[k] = max( hi[k], c[k] );
+         }
+      }
+
+      Vector extent = hi - lo;
+      int axis = 0;
+      if( extent[1] > extent[axis] ) axis = 1;
+      if( extent[2] > extent[axis] ) axis = 2;
+
+      int middle = begin + ( end - begin ) / 2;
+      nth_element( order.begin() + begin,
+                   order.begin() + middle,
+                   order.begin() + end,
+                   CentroidCompare( centroids, axis ));
+
+      split( begin, middle );
+      split( middle, end );
+   }
+
+   void MeshChunks :: addChunk( int begin, int end )
+   // computes the bounds of primitives begin, ..., end-1
+   {
+      const vector<float>& p( *positions );
+      const vector<unsigned int>& ind( *indices );
+
+      Chunk c;
+      c.first = nVertices * begin;
+      c.count = nVertices * ( end - begin );
+
+      // sphere around the bounding box
+      Vector lo( HUGE_VAL, HUGE_VAL, HUGE_VAL );
+      Vector hi = -lo;
+      for( int i = begin; i < end; i++ )
+      for( int k = 0; k < nVertices; k++ )
+      {
+         const float* x = &p[ 3*ind[ nVertices*order[i] + k ] ];
+         for( int j = 0; j < 3; j++ )
+         {
+            lo[j] = min( lo[j], (double) x[j] );
+            hi[j] = max( hi[j], (double) x[j] );
+         }
+      }
+      c.center = ( lo + hi ) / 2.;
+      c.radius = 0.;
+      for( int i = begin; i < end; i++ )
+      for( int k = 0; k < nVertices; k++ )
+      {
+         const float* x = &p[ 3*ind[ nVertices*order[i] + k ] ];
+         c.radius = max( c.radius, ( Vector( x[0], x[1], x[2] ) - c.center ).norm() );
+      }
+
+      // cone around the average triangle normal
+      c.axis = Vector( 0., 0., 0. );
+      c.cosAngle = -1.;
+      c.sinAngle = 0.;
+      if( nVertices == 3 )
+      {
+         vector<Vector> normals;
+         normals.reserve( end - begin );
+         for( int i = begin; i < end; i++ )
+         {
+            const unsigned int* t = &ind[ 3*order[i] ];
+            Vector x0( p[3*t[0]+0], p[3*t[0]+1], p[3*t[0]+2] );
+            Vector x1( p[3*t[1]+0], p[3*t[1]+1], p[3*t[1]+2] );
+            Vector x2( p[3*t[2]+0], p[3*t[2]+1], p[3*t[2]+2] );
+
+            Vector N = cross( x1-x0, x2-x0 );
+            if( N.norm2() == 0. ) continue; // (degenerate triangles are never seen)
+            N.normalize();
+            normals.push_back( N );
+            c.axis += N;
+         }
+
+         if( c.axis.norm2() > 0. )
+         {
+            c.axis.normalize();
+            double cosAngle = 1.;
+            for( size_t i = 0; i < normals.size(); i++ )
+            {
+               cosAngle = min( cosAngle, dot( c.axis, normals[i] ));
+            }
+
+            // cones wider than a hemisphere cannot rule anything out
+            if( cosAngle > 0. )
+            {
+               c.cosAngle = cosAngle;
+               c.sinAngle = sqrt( max( 0., 1. - cosAngle*cosAngle ));
+            }
+         }
+      }
+
+      chunks.push_back( c );
+   }
+
+   void MeshChunks :: visible( const double transform[16], const Vector& eye, bool cullBackfaces,
+                               vector<int>& first, vector<int>& count ) const
+   // lists the ranges of the index buffer covered by visible chunks
+   {
+      // the six frustum planes, as rows of the transformation (w +/- x,y,z >= 0)
+      double planes[6][4];
+      for( int i = 0; i < 3; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         planes[2*i+0][j] = transform[4*j+3] + transform[4*j+i];
+         planes[2*i+1][j] = transform[4*j+3] - transform[4*j+i];
+      }
+
+      first.clear();
+      count.clear();
+      for( size_t i = 0; i < chunks.size(); i++ )
+      {
+         const Chunk& c( chunks[i] );
+         if( !isVisible( c, planes, eye, cullBackfaces )) continue;
+
+         // merge with the previous range if adjacent
+         if( !first.empty() && first.back() + count.back() == c.first )
+         {
+            count.back() += c.count;
+         }
+         else
+         {
+            first.push_back( c.first );
+            count.push_back( c.count );
+         }
+      }
+   }
+
+   bool MeshChunks :: isVisible( const Chunk& c, const double planes[6][4],
+                                 const Vector& eye, bool cullBackfaces ) const
+   // checks whether a chunk might be visible
+   {
+      for( int i = 0; i < 6; i++ )
+      {
+         const double* P = planes[i];
+         double scale = sqrt( P[0]*P[0] + P[1]*P[1] + P[2]*P[2] );
+         if( P[0]*c.center.x + P[1]*c.center.y + P[2]*c.center.z + P[3] < -c.radius*scale )
+         {
+            return false;
+         }
+      }
+
+      if( cullBackfaces && c.cosAngle > 0. )
+      {
+         // every point p of the chunk is within the sphere, and every normal N
+         // within the cone, so dot( N, p-eye ) is at least
+         // |d| cos( angle(axis,d) + angle of the cone ) - radius, where
+         // d = center - eye; if this is positive, all triangles face away
+         Vector d = c.center - eye;
+         double distance = d.norm();
+         if( distance <= c.radius ) return true;
+
+         double cosPhi = dot( c.axis, d ) / distance;
+         double sinPhi = sqrt( max( 0., 1. - cosPhi*cosPhi ));
+         double cosSum = cosPhi*c.cosAngle - sinPhi*c.sinAngle;
+         if( distance*cosSum > c.radius ) return false;
+      }
+
+      return true;
+   }
+}
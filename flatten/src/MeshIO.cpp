@@ -64,28 +64,34 @@ namespace DDG
    }
    
    void MeshIO :: write( ostream& out, const Mesh& mesh )
-   // writes a mesh to a valid, open output stream out
+   // writes a mesh to a valid, open output stream out (vertices and faces
+   // are written in their original order, even if the mesh was reordered)
    {
-      int currentIndex = 1;
+      int nV = mesh.vertices.size();
+      int nF = mesh.faces.size();
+
+      // find the current index of the kth vertex/face in the input file
+      vector<int> fileVertex( nV );
+      vector<int> fileFace( nF );
+      for( int i = 0; i < nV; i++ ) fileVertex[ mesh.originalVertexIndex.empty() ? i : mesh.originalVertexIndex[i] ] = i;
+      for( int i = 0; i < nF; i++ ) fileFace  [ mesh.originalFaceIndex.empty()   ? i : mesh.originalFaceIndex[i]   ] = i;
+
       map<VertexCIter,int> vertexIndex;
    
-      for( VertexCIter v  = mesh.vertices.begin();
-                       v != mesh.vertices.end();
-                       v++ )
+      for( int k = 0; k < nV; k++ )
       {
+         VertexCIter v = mesh.vertices.begin() + fileVertex[k];
+
          out << "v " << v->position.x << " "
                      << v->position.y << " "
                      << v->position.z << endl;
    
-         vertexIndex[ v ] = currentIndex;
-         currentIndex++;
+         vertexIndex[ v ] = k+1;
       }
 
-      for( FaceCIter f  = mesh.faces.begin();
-                     f != mesh.faces.end();
-                     f ++ )
+      for( int k = 0; k < nF; k++ )
       {
-         HalfEdgeIter he = f->he;
+         HalfEdgeIter he = mesh.faces[ fileFace[k] ].he;
    
          for( int j = 0; j < 3; j++ )
          {
@@ -94,9 +100,9 @@ namespace DDG
          }
       }
    
-      for( size_t i = 0; i < mesh.faces.size(); i++ )
+      for( int k = 0; k < nF; k++ )
       {
-         const Face& f( mesh.faces[i] );
+         const Face& f( mesh.faces[ fileFace[k] ] );
          HalfEdgeIter he = f.he;
    
          out << "f ";
@@ -104,7 +110,7 @@ namespace DDG
          int j = 0;
          do
          {
-            out << vertexIndex[ he->vertex ] << "/" << 1+(i*3+j) << " ";
+            out << vertexIndex[ he->vertex ] << "/" << 1+(k*3+j) << " ";
             he = he->next;
             j++;
          }
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <queue>
+#include <cmath>
+using namespace std;
+
+#include "MeshLOD.h"
+
+namespace DDG
+{
+   MeshLOD :: Quadric :: Quadric( void )
+   {
+      for( int k = 0; k < 10; k++ ) q[k] = 0.;
+   }
+
+   void MeshLOD :: Quadric :: addPlane( const Vector& normal, double offset )
+   // adds the squared distance to the plane dot(normal,x) + offset = 0
+   {
+      double a = normal.x, b = normal.y, c = normal.z, d = offset;
+
+      q[0] += a*a; q[1] += a*b; q[2] += a*c; q[3] += a*d;
+                   q[4] += b*b; q[5] += b*c; q[6] += b*d;
+                                q[7] += c*c; q[8] += c*d;
+                                             q[9] += d*d;
+   }
+
+   void MeshLOD :: Quadric :: operator+=( const Quadric& r )
+   // adds another quadric
+   {
+      for( int k = 0; k < 10; k++ ) q[k] += r.q[k];
+   }
+
+   double MeshLOD :: Quadric :: operator()( const Vector& p ) const
+   // evaluates the quadric at p
+   {
+      double x = p.x, y = p.y, z = p.z;
+
+      return      q[0]*x*x + 2.*q[1]*x*y + 2.*q[2]*x*z + 2.*q[3]*x
+                           +    q[4]*y*y + 2.*q[5]*y*z + 2.*q[6]*y
+                                         +    q[7]*z*z + 2.*q[8]*z
+                                                       +    q[9];
+   }
+
+   bool MeshLOD :: Collapse :: operator<( const Collapse& c ) const
+   // orders collapses by decreasing cost, so that the cheapest one is on
+   // top of a std::priority_queue
+   {
+      return cost > c.cost;
+   }
+
+   MeshLOD :: MeshLOD( void )
+   : nAlive( 0 )
+   {}
+
+   void MeshLOD :: clear( void )
+   // removes all levels
+   {
+      levelTriangles.clear();
+      levelLines.clear();
+      levelErrors.clear();
+   }
+
+   int MeshLOD :: levels( void ) const
+   // returns the number of levels, including the original mesh
+   {
+      return 1 + levelTriangles.size();
+   }
+
+   const vector<unsigned int>& MeshLOD :: triangles( int level ) const
+   // returns the triangles of a coarse level
+   {
+      return levelTriangles[ level-1 ];
+   }
+
+   const vector<unsigned int>& MeshLOD :: lines( int level ) const
+   // returns the edges of a coarse level
+   {
+      return levelLines[ level-1 ];
+   }
+
+   double MeshLOD :: error( int level ) const
+   // returns the largest quadric error of any collapse up to this level
+   {
+      if( level == 0 ) return 0.;
+      return levelErrors[ level-1 ];
+   }
+
+   int MeshLOD :: select( double tolerance ) const
+   // returns the coarsest level whose error is at most tolerance
+   {
+      // (errors increase with the level)
+      for( int level = levels()-1; level > 0; level-- )
+      {
+         if( error( level ) <= tolerance ) return level;
+      }
+      return 0;
+   }
+
+   void MeshLOD :: build( const vector<float>& positions,
+                          const vector<unsigned int>& triangles,
+                          int minTriangles )
+   // builds coarser levels of the mesh
+   {
+      clear();
+
+      int nV = positions.size() / 3;
+      int nT = triangles.size() / 3;
+      if( nT <= minTriangles ) return;
+
+      position.resize( nV );
+      for( int i = 0; i < nV; i++ )
+      {
+         position[i] = Vector( positions[3*i+0],
+                               positions[3*i+1],
+                               positions[3*i+2] );
+      }
+
+      quadric.assign( nV, Quadric() );
+      boundary.assign( nV, false );
+      locked.assign( nV, false );
+      removed.assign( nV, false );
+      stamps.assign( nV, 0 );
+
+      corners.assign( triangles.begin(), triangles.begin() + 3*nT );
+      alive.assign( nT, true );
+      nAlive = nT;
+      vertexTriangles.assign( nV, vector<int>() );
+
+      // each vertex starts out with the planes of its triangles
+      vector<Vector> normal( nT );
+      for( int t = 0; t < nT; t++ )
+      {
+         const Vector& p0( position[ corners[3*t+0] ] );
+         const Vector& p1( position[ corners[3*t+1] ] );
+         const Vector& p2( position[ corners[3*t+2] ] );
+
+         normal[t] = cross( p1-p0, p2-p0 );
+         if( normal[t].norm2() > 0. ) normal[t].normalize();
+
+         for( int k = 0; k < 3; k++ )
+         {
+            quadric[ corners[3*t+k] ].addPlane( normal[t], -dot( normal[t], p0 ));
+            vertexTriangles[ corners[3*t+k] ].push_back( t );
+         }
+      }
+
+      // sort the edges of all triangles, so that copies of the same edge
+      // are adjacent
+      vector< pair< pair<int,int>, int > > edges( 3*nT );
+      for( int t = 0; t < nT; t++ )
+      for( int k = 0; k < 3; k++ )
+      {
+         int a = corners[ 3*t + k ];
+         int b = corners[ 3*t + (k+1)%3 ];
+         edges[3*t+k] = make_pair( make_pair( min(a,b), max(a,b) ), t );
+      }
+      sort( edges.begin(), edges.end() );
+
+      priority_queue<Collapse> queue;
+      for( size_t e = 0; e < edges.size(); )
+      {
+         size_t count = 1;
+         while( e+count < edges.size() && edges[e+count].first == edges[e].first ) count++;
+
+         int a = edges[e].first.first;
+         int b = edges[e].first.second;
+
+         if( count == 1 )
+         {
+            // boundary edges get an additional plane perpendicular to the
+            // surface, which keeps them from moving inward
+            Vector n = cross( position[b] - position[a], normal[ edges[e].second ] );
+            if( n.norm2() > 0. ) n.normalize();
+            quadric[a].addPlane( n, -dot( n, position[a] ));
+            quadric[b].addPlane( n, -dot( n, position[a] ));
+            boundary[a] = boundary[b] = true;
+         }
+         else if( count > 2 )
+         {
+            // vertices of non-manifold edges are never removed
+            locked[a] = locked[b] = true;
+         }
+
+         e += count;
+      }
+
+      for( size_t e = 0; e < edges.size(); e++ )
+      {
+         if( e > 0 && edges[e].first == edges[e-1].first ) continue;
+
+         Collapse c;
+         if( bestCollapse( edges[e].first.first, edges[e].first.second, c ))
+         {
+            queue.push( c );
+         }
+      }
+
+      // collapse edges in order of increasing cost, storing a level each
+      // time the number of triangles has dropped by a factor of four
+      int target = max( nT/4, minTriangles );
+      double maxCost = 0.;
+      vector<int> ring;
+      while( nAlive > minTriangles && !queue.empty() )
+      {
+         Collapse c = queue.top();
+         queue.pop();
+
+         if( removed[c.u] || removed[c.v] ||
+             stamps[c.u] != c.stampU || stamps[c.v] != c.stampV ||
+             !canCollapse( c.u, c.v ))
+         {
+            continue;
+         }
+
+         collapse( c.u, c.v );
+         maxCost = max( maxCost, c.cost );
+
+         // the quadric of v has changed, so update the cost of its edges
+         neighbors( c.v, ring );
+         for( size_t i = 0; i < ring.size(); i++ )
+         {
+            Collapse d;
+            if( bestCollapse( c.v, ring[i], d )) queue.push( d );
+         }
+
+         if( nAlive <= target )
+         {
+            addLevel( sqrt( maxCost ));
+            target = max( nAlive/4, minTriangles );
+         }
+      }
+
+      // keep whatever was left once no more collapses were possible
+      int last = levelTriangles.empty() ? nT : levelTriangles.back().size() / 3;
+      if( nAlive < last ) addLevel( sqrt( maxCost ));
+
+      // free temporary storage
+      vector<Vector>().swap( position );
+      vector<Quadric>().swap( quadric );
+      vector<bool>().swap( boundary );
+      vector<bool>().swap( locked );
+      vector<bool>().swap( removed );
+      vector<int>().swap( stamps );
+      vector<int>().swap( corners );
+      vector<bool>().swap( alive );
+      vector< vector<int> >().swap( vertexTriangles );
+      nAlive = 0;
+   }
+
+   void MeshLOD :: neighbors( int i, vector<int>& n ) const
+   // lists the vertices that share a triangle with vertex i
+   {
+      n.clear();
+      const vector<int>& ts( vertexTriangles[i] );
+      for( size_t k = 0; k < ts.size(); k++ )
+      for( int j = 0; j < 3; j++ )
+      {
+         int w = corners[ 3*ts[k] + j ];
+         if( w != i ) n.push_back( w );
+      }
+      sort( n.begin(), n.end() );
+      n.erase( unique( n.begin(), n.end() ), n.end() );
+   }
+
+   bool MeshLOD :: bestCollapse( int a, int b, Collapse& c ) const
+   // finds the cheaper direction in which edge ab can be collapsed
+   {
+      // both directions are charged the combined quadric, evaluated at the
+      // vertex that remains
+      Quadric q = quadric[a];
+      q += quadric[b];
+
+      double costAB = q( position[b] ); // a merged into b
+      double costBA = q( position[a] ); // b merged into a
+
+      bool okAB = !locked[a] && ( !boundary[a] || boundary[b] );
+      bool okBA = !locked[b] && ( !boundary[b] || boundary[a] );
+      if( !okAB && !okBA ) return false;
+
+      if( okAB && ( !okBA || costAB <= costBA ))
+      {
+         c.u = a; c.v = b; c.cost = costAB;
+      }
+      else
+      {
+         c.u = b; c.v = a; c.cost = costBA;
+      }
+      c.cost = max( 0., c.cost );
+      c.stampU = stamps[c.u];
+      c.stampV = stamps[c.v];
+
+      return true;
+   }
+
+   bool MeshLOD :: canCollapse( int u, int v ) const
+   // checks whether u can be merged into v
+   {
+      if( locked[u] ) return false;
+      if( boundary[u] && !boundary[v] ) return false;
+
+      // count the triangles that contain both u and v (which will be removed)
+      const vector<int>& ts( vertexTriangles[u] );
+      int k = 0;
+      for( size_t i = 0; i < ts.size(); i++ )
+      {
+         const int* c = &corners[ 3*ts[i] ];
+         if( c[0] == v || c[1] == v || c[2] == v ) k++;
+      }
+
+      // a boundary vertex may only slide along a boundary edge, and an
+      // interior edge must have exactly two triangles
+      if( k == 0 || k > 2 ) return false;
+      if( boundary[u] && k != 1 ) return false;
+      if( !boundary[u] && k != 2 ) return false;
+
+      // link condition: u and v must not have any common neighbors other
+      // than the opposite corners of the triangles being removed
+      vector<int> nu, nv;
+      neighbors( u, nu );
+      neighbors( v, nv );
+      int common = 0;
+      for( size_t i = 0, j = 0; i < nu.size() && j < nv.size(); )
+      {
+         if     ( nu[i] < nv[j] ) i++;
+         else if( nv[j] < nu[i] ) j++;
+         else { common++; i++; j++; }
+      }
+      if( common != k ) return false;
+
+      // no remaining triangle may flip over or become degenerate
+      for( size_t i = 0; i < ts.size(); i++ )
+      {
+         const int* c = &corners[ 3*ts[i] ];
+         if( c[0] == v || c[1] == v || c[2] == v ) continue;
+
+         Vector p[3], q[3];
+         for( int j = 0; j < 3; j++ )
+         {
+            p[j] = position[ c[j] ];
+            q[j] = c[j] == u ? position[v] : p[j];
+         }
+
+         Vector n0 = cross( p[1]-p[0], p[2]-p[0] );
+         Vector n1 = cross( q[1]-q[0], q[2]-q[0] );
+         if( dot( n0, n1 ) <= 0. ) return false;
+      }
+
+      return true;
+   }
+
+   void MeshLOD :: collapse( int u, int v )
+   // merges u into v
+   {
+      vector<int>& ts( vertexTriangles[u] );
+      for( size_t i = 0; i < ts.size(); i++ )
+      {
+         int t = ts[i];
+         int* c = &corners[ 3*t ];
+
+         if( c[0] == v || c[1] == v || c[2] == v )
+         {
+            // triangles containing the edge disappear
+            alive[t] = false;
+            nAlive--;
+            for( int j = 0; j < 3; j++ )
+            {
+               if( c[j] == u ) continue;
+               vector<int>& other( vertexTriangles[ c[j] ] );
+               other.erase( find( other.begin(), other.end(), t ));
+            }
+         }
+         else
+         {
+            // all others now refer to v instead of u
+            for( int j = 0; j < 3; j++ )
+            {
+               if( c[j] == u ) c[j] = v;
+            }
+            vertexTriangles[v].push_back( t );
+         }
+      }
+      vector<int>().swap( ts );
+
+      quadric[v] += quadric[u];
+      removed[u] = true;
+      stamps[v]++;
+   }
+
+   void MeshLOD :: addLevel( double error )
+   // stores the current triangles as a new level
+   {
+      levelTriangles.push_back( vector<unsigned int>() );
+      levelLines.push_back( vector<unsigned int>() );
+      levelErrors.push_back( error );
+
+      vector<unsigned int>& t( levelTriangles.back() );
+      t.reserve( 3*nAlive );
+      vector< pair<unsigned int,unsigned int> > edges;
+      edges.reserve( 3*nAlive );
+
+      for( size_t i = 0; i < alive.size(); i++ )
+      {
+         if( !alive[i] ) continue;
+
+         for( int k = 0; k < 3; k++ )
+         {
+            unsigned int a = corners[ 3*i + k ];
+            unsigned int b = corners[ 3*i + (k+1)%3 ];
+            t.push_back( a );
+            edges.push_back( make_pair( min(a,b), max(a,b) ));
+         }
+      }
+
+      sort( edges.begin(), edges.end() );
+      edges.erase( unique( edges.begin(), edges.end() ), edges.end() );
+
+      vector<unsigned int>& l( levelLines.back() );
+      l.resize( 2*edges.size() );
+      for( size_t i = 0; i < edges.size(); i++ )
+      {
+         l[2*i+0] = edges[i].first;
+         l[2*i+1] = edges[i].second;
+      }
+   }
+}
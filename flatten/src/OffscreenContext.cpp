@@ -0,0 +1,174 @@
+#include <iostream>
+using namespace std;
+
+#include "OffscreenContext.h"
+
+#ifdef DDG_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <GLUT/glut.h>
+
+namespace DDG
+{
+   OffscreenContext :: OffscreenContext( void )
+   : w( 0 ), h( 0 ),
+     display( NULL ),
+     config( NULL ),
+     surface( NULL ),
+     context( NULL )
+   {}
+
+   OffscreenContext :: ~OffscreenContext( void )
+   {
+      destroy();
+   }
+
+   bool OffscreenContext :: available( void )
+   // returns true if offscreen rendering was compiled in
+   {
+#ifdef DDG_EGL
+      return true;
+#else
+      return false;
+#endif
+   }
+
+#ifdef DDG_EGL
+   bool OffscreenContext :: create( int width, int height )
+   // creates a context with a framebuffer of the given size
+   {
+      destroy();
+
+      // prefer the surfaceless platform, which needs neither a display
+      // server nor a GPU; otherwise use whatever display EGL provides
+      EGLDisplay d = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+      PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+         (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+      if( getPlatformDisplay )
+      {
+         d = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+      }
+#endif
+      if( d == EGL_NO_DISPLAY ) d = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+      EGLint major, minor;
+      if( d == EGL_NO_DISPLAY || !eglInitialize( d, &major, &minor ))
+      {
+         cerr << "Error: could not initialize EGL!" << endl;
+         return false;
+      }
+      display = d;
+
+      const EGLint configAttributes[] = {
+         EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+         EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+         EGL_RED_SIZE,        8,
+         EGL_GREEN_SIZE,      8,
+         EGL_BLUE_SIZE,       8,
+         EGL_DEPTH_SIZE,      24,
+         EGL_NONE
+      };
+      EGLConfig c;
+      EGLint nConfigs = 0;
+      if( !eglChooseConfig( d, configAttributes, &c, 1, &nConfigs ) || nConfigs == 0 )
+      {
+         cerr << "Error: no suitable EGL configuration!" << endl;
+         destroy();
+         return false;
+      }
+      config = c;
+
+      const EGLint surfaceAttributes[] = {
+         EGL_WIDTH,  width,
+         EGL_HEIGHT, height,
+         EGL_NONE
+      };
+      EGLSurface s = eglCreatePbufferSurface( d, c, surfaceAttributes );
+      if( s == EGL_NO_SURFACE )
+      {
+         cerr << "Error: could not create a " << width << "x" << height << " EGL surface!" << endl;
+         destroy();
+         return false;
+      }
+      surface = s;
+
+      // (desktop OpenGL with the default compatibility profile, since the
+      // viewer uses the fixed-function pipeline alongside GLSL)
+      eglBindAPI( EGL_OPENGL_API );
+      EGLContext x = eglCreateContext( d, c, EGL_NO_CONTEXT, NULL );
+      if( x == EGL_NO_CONTEXT || !eglMakeCurrent( d, s, s, x ))
+      {
+         cerr << "Error: could not create an OpenGL context!" << endl;
+         if( x != EGL_NO_CONTEXT ) context = x;
+         destroy();
+         return false;
+      }
+      context = x;
+
+      w = width;
+      h = height;
+      glViewport( 0, 0, w, h );
+
+      return true;
+   }
+
+   void OffscreenContext :: destroy( void )
+   // releases the context
+   {
+      if( display )
+      {
+         EGLDisplay d = (EGLDisplay) display;
+
+         eglMakeCurrent( d, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+         if( context ) eglDestroyContext( d, (EGLContext) context );
+         if( surface ) eglDestroySurface( d, (EGLSurface) surface );
+         eglReleaseThread();
+      }
+
+      // (the display itself is shared by all contexts in the process, so
+      // it is not terminated here)
+      display = config = surface = context = NULL;
+      w = h = 0;
+   }
+#else
+   bool OffscreenContext :: create( int width, int height )
+   // offscreen rendering is not available in this build
+   {
+      cerr << "Error: offscreen rendering is not available (rebuild with DDG_EGL defined)." << endl;
+      return false;
+   }
+
+   void OffscreenContext :: destroy( void )
+   {
+      w = h = 0;
+   }
+#endif
+
+   void OffscreenContext :: read( Image& image ) const
+   // copies the contents of the current viewport into an image
+   {
+      GLint viewport[4] = { 0, 0, 0, 0 };
+      if( w > 0 && h > 0 ) glGetIntegerv( GL_VIEWPORT, viewport );
+
+      image = Image( viewport[2], viewport[3] );
+      if( viewport[2] == 0 || viewport[3] == 0 ) return;
+
+      glFinish();
+      glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+      glReadPixels( viewport[0], viewport[1], viewport[2], viewport[3],
+                    GL_BGR, GL_FLOAT, &image(0,0) );
+   }
+
+   int OffscreenContext :: width( void ) const
+   {
+      return w;
+   }
+
+   int OffscreenContext :: height( void ) const
+   {
+      return h;
+   }
+}
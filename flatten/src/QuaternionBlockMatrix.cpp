@@ -0,0 +1,149 @@
+#include "QuaternionBlockMatrix.h"
+
+namespace DDG
+{
+   QuaternionBlockMatrix :: QuaternionBlockMatrix( void )
+   : m( 0 ),
+     n( 0 ),
+     rowStart( 1, 0 )
+   {}
+
+   QuaternionBlockMatrix :: QuaternionBlockMatrix( const SparseMatrix<Quaternion>& A )
+   {
+      build( A );
+   }
+
+   void QuaternionBlockMatrix :: build( const SparseMatrix<Quaternion>& A )
+   // replaces the contents with a compressed copy of A
+   {
+      m = A.nRows();
+      n = A.nColumns();
+
+      // count nonzeros in each row
+      rowStart.assign( m+1, 0 );
+      for( SparseMatrix<Quaternion>::const_iterator e  = A.begin();
+                                                    e != A.end();
+                                                    e ++ )
+      {
+         rowStart[ e->first.second + 1 ]++;
+      }
+      for( int i = 0; i < m; i++ )
+      {
+         rowStart[i+1] += rowStart[i];
+      }
+
+      // scatter entries into rows; since EntryMap is sorted by column,
+      // the column indices within each row end up sorted as well
+      int nnz = rowStart[m];
+      columnIndex.resize( nnz );
+      blocks.resize( nnz );
+      std::vector<int> next( rowStart.begin(), rowStart.end()-1 );
+      for( SparseMatrix<Quaternion>::const_iterator e  = A.begin();
+                                                    e != A.end();
+                                                    e ++ )
+      {
+         int k = next[ e->first.second ]++;
+
+         columnIndex[k] = e->first.first;
+         blocks[k] = e->second;
+      }
+   }
+
+   int QuaternionBlockMatrix :: nRows( void ) const
+   // returns the number of (quaternionic) rows
+   {
+      return m;
+   }
+
+   int QuaternionBlockMatrix :: nColumns( void ) const
+   // returns the number of (quaternionic) columns
+   {
+      return n;
+   }
+
+   int QuaternionBlockMatrix :: nBlocks( void ) const
+   // returns the number of nonzero blocks
+   {
+      return blocks.size();
+   }
+
+   void QuaternionBlockMatrix :: multiply( const DenseMatrix<Quaternion>& x, DenseMatrix<Quaternion>& y ) const
+   // computes y = A*x
+   {
+      assert( x.nRows() == n );
+
+      int k = x.nColumns();
+      if( y.nRows() != m || y.nColumns() != k )
+      {
+         y = DenseMatrix<Quaternion>( m, k );
+      }
+
+      const Quaternion* X = x.entries();
+            Quaternion* Y = y.entries();
+
+      for( int c = 0; c < k; c++ )
+      {
+         const Quaternion* xc = X + c*n;
+               Quaternion* yc = Y + c*m;
+
+         for( int i = 0; i < m; i++ )
+         {
+            Quaternion sum( 0. );
+
+            for( int p = rowStart[i]; p < rowStart[i+1]; p++ )
+            {
+               sum += blocks[p] * xc[ columnIndex[p] ];
+            }
+
+            yc[i] = sum;
+         }
+      }
+   }
+
+   void QuaternionBlockMatrix :: multiplyAdjoint( const DenseMatrix<Quaternion>& x, DenseMatrix<Quaternion>& y ) const
+   // computes y = A^* x, where A^* is the conjugate transpose of A
+   {
+      assert( x.nRows() == m );
+
+      int k = x.nColumns();
+      y = DenseMatrix<Quaternion>( n, k );
+
+      const Quaternion* X = x.entries();
+            Quaternion* Y = y.entries();
+
+      for( int c = 0; c < k; c++ )
+      {
+         const Quaternion* xc = X + c*m;
+               Quaternion* yc = Y + c*n;
+
+         for( int i = 0; i < m; i++ )
+         {
+            for( int p = rowStart[i]; p < rowStart[i+1]; p++ )
+            {
+               yc[ columnIndex[p] ] += blocks[p].conj() * xc[i];
+            }
+         }
+      }
+   }
+
+   void QuaternionBlockMatrix :: diagonalInverse( DenseMatrix<Quaternion>& d ) const
+   // sets d(i) to the inverse of the diagonal block A(i,i), or to
+   // one if that block is zero (used as a Jacobi preconditioner)
+   {
+      d = DenseMatrix<Quaternion>( m );
+
+      for( int i = 0; i < m; i++ )
+      {
+         d(i) = 1.;
+
+         for( int p = rowStart[i]; p < rowStart[i+1]; p++ )
+         {
+            if( columnIndex[p] == i && blocks[p].norm2() > 0. )
+            {
+               d(i) = blocks[p].inv();
+            }
+         }
+      }
+   }
+}
+
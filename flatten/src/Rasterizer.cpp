@@ -0,0 +1,706 @@
+#include <cmath>
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+using namespace std;
+
+#include "Rasterizer.h"
+
+#if defined( __AVX__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+namespace DDG
+{
+   // vertex positions are snapped to a grid of 1/256th of a pixel; since the
+   // guard band keeps coordinates below 2^15, every edge function value is
+   // then an exact double, so neighboring triangles agree on shared edges
+   static const double subpixels = 256.;
+   static const double guardBand = 2.;
+
+   // smallest depth difference resolved by a 24-bit depth buffer, which is
+   // the unit of glPolygonOffset()
+   static const double depthResolution = 1. / 16777216.;
+
+   class TaskList
+   // a range of tasks shared by a group of threads
+   {
+      public:
+         void (*run)( void* data, int task );
+         void* data;
+         int nTasks;
+         int next;
+         pthread_mutex_t mutex;
+   };
+
+   static void* runTasks( void* list )
+   // runs tasks from a shared list until none are left
+   {
+      TaskList& tasks( *(TaskList*) list );
+
+      while( true )
+      {
+         pthread_mutex_lock( &tasks.mutex );
+         int task = tasks.next++;
+         pthread_mutex_unlock( &tasks.mutex );
+
+         if( task >= tasks.nTasks ) break;
+         tasks.run( tasks.data, task );
+      }
+
+      return NULL;
+   }
+
+   static void runParallel( int nThreads, int nTasks, void (*run)( void*, int ), void* data )
+   // runs tasks 0, ..., nTasks-1 on up to nThreads threads (including the
+   // calling thread) and waits for all of them to finish
+   {
+      if( nThreads <= 1 || nTasks <= 1 )
+      {
+         for( int i = 0; i < nTasks; i++ ) run( data, i );
+         return;
+      }
+
+      TaskList tasks;
+      tasks.run = run;
+      tasks.data = data;
+      tasks.nTasks = nTasks;
+      tasks.next = 0;
+      pthread_mutex_init( &tasks.mutex, NULL );
+
+      // (if a thread cannot be started, the remaining ones simply take
+      // on more tasks)
+      vector<pthread_t> workers;
+      for( int i = 1; i < min( nThreads, nTasks ); i++ )
+      {
+         pthread_t thread;
+         if( pthread_create( &thread, NULL, runTasks, &tasks ) == 0 )
+         {
+            workers.push_back( thread );
+         }
+      }
+
+      runTasks( &tasks );
+
+      for( size_t i = 0; i < workers.size(); i++ )
+      {
+         pthread_join( workers[i], NULL );
+      }
+      pthread_mutex_destroy( &tasks.mutex );
+   }
+
+   static inline int coverage( const double* E, const double* dE, const bool* topLeft, int count )
+   // returns a bit mask of the pixels i < count (at most four) covered by a
+   // triangle, where pixel i has edge function values E[k] + i*dE[k]; pixels
+   // on an edge are covered only if it is a top or left edge
+   {
+      int mask = ( 1 << count ) - 1;
+
+#if defined( __AVX__ )
+      const __m256d offsets = _mm256_set_pd( 3., 2., 1., 0. );
+      const __m256d zero = _mm256_setzero_pd();
+      for( int k = 0; k < 3; k++ )
+      {
+         __m256d e = _mm256_add_pd( _mm256_set1_pd( E[k] ),
+                                    _mm256_mul_pd( offsets, _mm256_set1_pd( dE[k] )));
+         __m256d inside = topLeft[k] ? _mm256_cmp_pd( e, zero, _CMP_GE_OQ )
+                                     : _mm256_cmp_pd( e, zero, _CMP_GT_OQ );
+         mask &= _mm256_movemask_pd( inside );
+      }
+#elif defined( __SSE2__ )
+      const __m128d offsets0 = _mm_set_pd( 1., 0. );
+      const __m128d offsets1 = _mm_set_pd( 3., 2. );
+      const __m128d zero = _mm_setzero_pd();
+      for( int k = 0; k < 3; k++ )
+      {
+         __m128d e = _mm_set1_pd( E[k] );
+         __m128d d = _mm_set1_pd( dE[k] );
+         __m128d e0 = _mm_add_pd( e, _mm_mul_pd( offsets0, d ));
+         __m128d e1 = _mm_add_pd( e, _mm_mul_pd( offsets1, d ));
+         __m128d inside0 = topLeft[k] ? _mm_cmpge_pd( e0, zero ) : _mm_cmpgt_pd( e0, zero );
+         __m128d inside1 = topLeft[k] ? _mm_cmpge_pd( e1, zero ) : _mm_cmpgt_pd( e1, zero );
+         mask &= _mm_movemask_pd( inside0 ) | ( _mm_movemask_pd( inside1 ) << 2 );
+      }
+#else
+      for( int k = 0; k < 3; k++ )
+      {
+         for( int i = 0; i < count; i++ )
+         {
+            double e = E[k] + i*dE[k];
+            if( topLeft[k] ? e < 0. : e <= 0. ) mask &= ~( 1 << i );
+         }
+      }
+#endif
+
+      return mask;
+   }
+
+   static inline double planeDistance( const double* v, int plane )
+   // returns a value that is nonnegative if the clip-space point v = (x,y,z,w)
+   // is on the inside of the given clipping plane
+   {
+      switch( plane )
+      {
+         case 0:  return v[2] + v[3];              // near plane
+         case 1:  return guardBand*v[3] - v[0];    // guard band
+         case 2:  return guardBand*v[3] + v[0];
+         case 3:  return guardBand*v[3] - v[1];
+         default: return guardBand*v[3] + v[1];
+      }
+   }
+
+   Rasterizer :: Rasterizer( void )
+   : w( 0 ), h( 0 ),
+     tilesX( 0 ), tilesY( 0 ),
+     threads( 0 ),
+     eye( 0., 0., 1. ),
+     light( 0., 0., 1. ),
+     offsetFactor( 0. ),
+     offsetUnits( 0. ),
+     current( NULL ),
+     nTasks( 0 )
+   {
+      for( int i = 0; i < 16; i++ )
+      {
+         transform[i] = ( i%5 == 0 ) ? 1. : 0.;
+      }
+   }
+
+   void Rasterizer :: resize( int width, int height )
+   {
+      w = max( 0, width );
+      h = max( 0, height );
+      tilesX = ( w + tileSize - 1 ) / tileSize;
+      tilesY = ( h + tileSize - 1 ) / tileSize;
+      colorBuffer.resize( 3*w*h );
+      depthBuffer.resize( w*h );
+   }
+
+   int Rasterizer :: width( void ) const
+   {
+      return w;
+   }
+
+   int Rasterizer :: height( void ) const
+   {
+      return h;
+   }
+
+   void Rasterizer :: setThreads( int n )
+   {
+      threads = max( 0, n );
+   }
+
+   int Rasterizer :: nThreads( void ) const
+   {
+      if( threads > 0 ) return threads;
+
+      long n = sysconf( _SC_NPROCESSORS_ONLN );
+      return n > 0 ? (int) n : 1;
+   }
+
+   void Rasterizer :: setView( const double modelview[16], const double projection[16] )
+   {
+      // (column-major, as in OpenGL)
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         double sum = 0.;
+         for( int k = 0; k < 4; k++ )
+         {
+            sum += projection[ i + 4*k ] * modelview[ k + 4*j ];
+         }
+         transform[ i + 4*j ] = sum;
+      }
+   }
+
+   void Rasterizer :: setLighting( const Vector& eyePosition, const Vector& lightPosition )
+   {
+      eye = eyePosition;
+      light = lightPosition;
+   }
+
+   void Rasterizer :: setDepthOffset( double factor, double units )
+   {
+      offsetFactor = factor;
+      offsetUnits = units;
+   }
+
+   void Rasterizer :: clear( const Vector& color )
+   {
+      for( int i = 0; i < w*h; i++ )
+      {
+         colorBuffer[ 3*i+0 ] = color.x;
+         colorBuffer[ 3*i+1 ] = color.y;
+         colorBuffer[ 3*i+2 ] = color.z;
+         depthBuffer[ i ] = 1.;
+      }
+   }
+
+   void Rasterizer :: drawTriangles( const vector<float>& positions,
+                                     const vector<float>& normals,
+                                     const vector<float>& colors, int colorComponents,
+                                     const vector<unsigned int>& indices )
+   {
+      DrawCall call;
+      call.positions = &positions;
+      call.normals = &normals;
+      call.colors = &colors;
+      call.colorComponents = colorComponents;
+      call.indices = &indices;
+      call.verticesPerPrimitive = 3;
+      call.lineWidth = 0.;
+      call.shaded = true;
+      call.blended = false;
+      call.offsetFactor = offsetFactor;
+      call.offsetUnits = offsetUnits;
+
+      draw( call );
+   }
+
+   void Rasterizer :: drawLines( const vector<float>& positions,
+                                 const vector<float>& colors, int colorComponents,
+                                 const vector<unsigned int>& indices,
+                                 double lineWidth )
+   {
+      DrawCall call;
+      call.positions = &positions;
+      call.normals = NULL;
+      call.colors = &colors;
+      call.colorComponents = colorComponents;
+      call.indices = &indices;
+      call.verticesPerPrimitive = 2;
+      call.lineWidth = lineWidth;
+      call.shaded = false;
+      call.blended = ( colorComponents == 4 );
+      call.offsetFactor = 0.;
+      call.offsetUnits = 0.;
+
+      draw( call );
+   }
+
+   void Rasterizer :: read( Image& image ) const
+   {
+      image = Image( w, h );
+      if( w == 0 || h == 0 ) return;
+
+      float* pixels = &image(0,0);
+      for( int i = 0; i < w*h; i++ )
+      {
+         pixels[ 3*i+0 ] = colorBuffer[ 3*i+2 ];
+         pixels[ 3*i+1 ] = colorBuffer[ 3*i+1 ];
+         pixels[ 3*i+2 ] = colorBuffer[ 3*i+0 ];
+      }
+   }
+
+   void Rasterizer :: draw( const DrawCall& call )
+   {
+      int nVertices = call.positions->size() / 3;
+      int nPrimitives = call.indices->size() / call.verticesPerPrimitive;
+      if( w == 0 || h == 0 || nVertices == 0 || nPrimitives == 0 ) return;
+
+      int n = nThreads();
+      current = &call;
+
+      // transform vertices
+      clipVertices.resize( nVertices );
+      nTasks = n;
+      runParallel( n, nTasks, transformVertices, this );
+
+      // clip, project, and bin primitives; each task handles a contiguous
+      // range of primitives and has its own bins, so that the order of
+      // primitives within a tile is the order in which they were given
+      nTasks = min( n, nPrimitives );
+      primitives.resize( nTasks );
+      bins.resize( nTasks );
+      for( int i = 0; i < nTasks; i++ )
+      {
+         primitives[i].clear();
+         bins[i].resize( tilesX*tilesY );
+         for( int j = 0; j < tilesX*tilesY; j++ ) bins[i][j].clear();
+      }
+      runParallel( n, nTasks, setupPrimitives, this );
+
+      // rasterize tiles
+      runParallel( n, tilesX*tilesY, rasterizeTile, this );
+
+      current = NULL;
+   }
+
+   void Rasterizer :: transformVertices( void* rasterizer, int task )
+   {
+      Rasterizer& r( *(Rasterizer*) rasterizer );
+      const DrawCall& call( *r.current );
+      const double* M = r.transform;
+
+      int nVertices = r.clipVertices.size();
+      int begin = (long) nVertices *  task    / r.nTasks;
+      int end   = (long) nVertices * (task+1) / r.nTasks;
+
+      for( int i = begin; i < end; i++ )
+      {
+         const float* p = &(*call.positions)[ 3*i ];
+         ClipVertex& v( r.clipVertices[i] );
+
+         v.x = M[0]*p[0] + M[4]*p[1] + M[ 8]*p[2] + M[12];
+         v.y = M[1]*p[0] + M[5]*p[1] + M[ 9]*p[2] + M[13];
+         v.z = M[2]*p[0] + M[6]*p[1] + M[10]*p[2] + M[14];
+         v.w = M[3]*p[0] + M[7]*p[1] + M[11]*p[2] + M[15];
+
+         float* a = v.attributes;
+         const float* c = &(*call.colors)[ call.colorComponents*i ];
+         a[0] = c[0];
+         a[1] = c[1];
+         a[2] = c[2];
+         a[3] = call.colorComponents == 4 ? c[3] : 1.f;
+
+         for( int k = 0; k < 3; k++ )
+         {
+            a[4+k] = call.normals ? (*call.normals)[ 3*i+k ] : 0.f;
+            a[7+k] = p[k];
+         }
+      }
+   }
+
+   void Rasterizer :: setupPrimitives( void* rasterizer, int task )
+   {
+      Rasterizer& r( *(Rasterizer*) rasterizer );
+      const DrawCall& call( *r.current );
+      const vector<unsigned int>& indices( *call.indices );
+      const int n = call.verticesPerPrimitive;
+
+      int nPrimitives = indices.size() / n;
+      int begin = (long) nPrimitives *  task    / r.nTasks;
+      int end   = (long) nPrimitives * (task+1) / r.nTasks;
+
+      Primitive p;
+      ClipVertex polygon[16];
+      for( int i = begin; i < end; i++ )
+      {
+         for( int k = 0; k < n; k++ )
+         {
+            polygon[k] = r.clipVertices[ indices[ n*i+k ]];
+         }
+
+         if( n == 3 )
+         {
+            // clip, and split what is left into a triangle fan
+            int m = r.clip( polygon, 3 );
+            for( int k = 1; k+1 < m; k++ )
+            {
+               r.project( polygon[0],   p, 0 );
+               r.project( polygon[k],   p, 1 );
+               r.project( polygon[k+1], p, 2 );
+               r.addPrimitive( p, task );
+            }
+         }
+         else
+         {
+            if( !r.clipLine( polygon[0], polygon[1] )) continue;
+
+            // lines are drawn as rectangles (i.e., as two triangles)
+            // extending lineWidth/2 pixels to either side
+            const ClipVertex& a( polygon[0] );
+            const ClipVertex& b( polygon[1] );
+            double dx = ( b.x/b.w - a.x/a.w ) * r.w;
+            double dy = ( b.y/b.w - a.y/a.w ) * r.h;
+            double length = sqrt( dx*dx + dy*dy );
+            if( length == 0. ) continue;
+            double nx = -.5 * call.lineWidth * dy / length;
+            double ny =  .5 * call.lineWidth * dx / length;
+
+            r.project( a, p, 0,  nx,  ny );
+            r.project( a, p, 1, -nx, -ny );
+            r.project( b, p, 2, -nx, -ny );
+            r.addPrimitive( p, task );
+
+            r.project( a, p, 0,  nx,  ny );
+            r.project( b, p, 1, -nx, -ny );
+            r.project( b, p, 2,  nx,  ny );
+            r.addPrimitive( p, task );
+         }
+      }
+   }
+
+   int Rasterizer :: clip( ClipVertex* polygon, int n ) const
+   {
+      ClipVertex buffer[16];
+      ClipVertex* in = polygon;
+      ClipVertex* out = buffer;
+
+      for( int plane = 0; plane < 5 && n > 0; plane++ )
+      {
+         int m = 0;
+         for( int i = 0; i < n; i++ )
+         {
+            const ClipVertex& a( in[i] );
+            const ClipVertex& b( in[(i+1)%n] );
+            double da = planeDistance( &a.x, plane );
+            double db = planeDistance( &b.x, plane );
+
+            if( da >= 0. ) out[m++] = a;
+            if( ( da >= 0. ) != ( db >= 0. ))
+            {
+               // add the point where the edge crosses the plane
+               double t = da / ( da - db );
+               ClipVertex& c( out[m++] );
+               c.x = a.x + t*( b.x - a.x );
+               c.y = a.y + t*( b.y - a.y );
+               c.z = a.z + t*( b.z - a.z );
+               c.w = a.w + t*( b.w - a.w );
+               for( int k = 0; k < nAttributes; k++ )
+               {
+                  c.attributes[k] = a.attributes[k] + t*( b.attributes[k] - a.attributes[k] );
+               }
+            }
+         }
+
+         n = m;
+         swap( in, out );
+      }
+
+      if( in != polygon )
+      {
+         for( int i = 0; i < n; i++ ) polygon[i] = in[i];
+      }
+
+      return n;
+   }
+
+   bool Rasterizer :: clipLine( ClipVertex& a, ClipVertex& b ) const
+   {
+      double t0 = 0., t1 = 1.;
+
+      for( int plane = 0; plane < 5; plane++ )
+      {
+         double da = planeDistance( &a.x, plane );
+         double db = planeDistance( &b.x, plane );
+
+         if( da < 0. && db < 0. ) return false;
+         if( da < 0. ) t0 = max( t0, da / ( da - db ));
+         if( db < 0. ) t1 = min( t1, da / ( da - db ));
+      }
+      if( t0 > t1 ) return false;
+
+      ClipVertex c[2];
+      double t[2] = { t0, t1 };
+      for( int i = 0; i < 2; i++ )
+      {
+         c[i].x = a.x + t[i]*( b.x - a.x );
+         c[i].y = a.y + t[i]*( b.y - a.y );
+         c[i].z = a.z + t[i]*( b.z - a.z );
+         c[i].w = a.w + t[i]*( b.w - a.w );
+         for( int k = 0; k < nAttributes; k++ )
+         {
+            c[i].attributes[k] = a.attributes[k] + t[i]*( b.attributes[k] - a.attributes[k] );
+         }
+      }
+      a = c[0];
+      b = c[1];
+
+      return true;
+   }
+
+   void Rasterizer :: project( const ClipVertex& c, Primitive& p, int corner, double dx, double dy ) const
+   {
+      double invW = 1. / c.w;
+
+      double x = ( .5 + .5 * c.x * invW ) * w + dx;
+      double y = ( .5 + .5 * c.y * invW ) * h + dy;
+      p.x[corner] = floor( x * subpixels + .5 ) / subpixels;
+      p.y[corner] = floor( y * subpixels + .5 ) / subpixels;
+      p.z[corner] = .5 + .5 * c.z * invW;
+      p.invW[corner] = invW;
+
+      for( int k = 0; k < nAttributes; k++ )
+      {
+         p.attributes[corner][k] = c.attributes[k] * invW;
+      }
+   }
+
+   void Rasterizer :: addPrimitive( const Primitive& p, int task )
+   {
+      // pixel (i,j) is covered if its center (i+1/2,j+1/2) is inside p
+      double xMin = min( p.x[0], min( p.x[1], p.x[2] ));
+      double xMax = max( p.x[0], max( p.x[1], p.x[2] ));
+      double yMin = min( p.y[0], min( p.y[1], p.y[2] ));
+      double yMax = max( p.y[0], max( p.y[1], p.y[2] ));
+
+      int i0 = max( 0,   (int) ceil ( xMin - .5 ));
+      int i1 = min( w-1, (int) floor( xMax - .5 ));
+      int j0 = max( 0,   (int) ceil ( yMin - .5 ));
+      int j1 = min( h-1, (int) floor( yMax - .5 ));
+      if( i0 > i1 || j0 > j1 ) return;
+
+      int index = primitives[task].size();
+      primitives[task].push_back( p );
+
+      for( int ty = j0/tileSize; ty <= j1/tileSize; ty++ )
+      for( int tx = i0/tileSize; tx <= i1/tileSize; tx++ )
+      {
+         bins[task][ tx + tilesX*ty ].push_back( index );
+      }
+   }
+
+   void Rasterizer :: rasterizeTile( void* rasterizer, int tile )
+   {
+      Rasterizer& r( *(Rasterizer*) rasterizer );
+
+      int x0 = ( tile % r.tilesX ) * tileSize;
+      int y0 = ( tile / r.tilesX ) * tileSize;
+      int x1 = min( r.w, x0 + tileSize );
+      int y1 = min( r.h, y0 + tileSize );
+
+      for( int task = 0; task < r.nTasks; task++ )
+      {
+         const vector<int>& bin( r.bins[task][tile] );
+         for( size_t i = 0; i < bin.size(); i++ )
+         {
+            r.rasterize( r.primitives[task][ bin[i] ], x0, y0, x1, y1 );
+         }
+      }
+   }
+
+   void Rasterizer :: rasterize( const Primitive& p, int x0, int y0, int x1, int y1 )
+   {
+      const DrawCall& call( *current );
+
+      // orient the triangle counter-clockwise (in window coordinates, where
+      // y points up)
+      int a = 0, b = 1, c = 2;
+      double area = ( p.x[b]-p.x[a] )*( p.y[c]-p.y[a] ) -
+                    ( p.y[b]-p.y[a] )*( p.x[c]-p.x[a] );
+      if( area == 0. ) return;
+      if( area < 0. )
+      {
+         swap( b, c );
+         area = -area;
+      }
+
+      // edge k is opposite vertex k, and its edge function is positive on
+      // the same side as vertex k
+      const int corner[3] = { a, b, c };
+      const int from[3]   = { b, c, a };
+      const int to[3]     = { c, a, b };
+      double dEdx[3], dEdy[3];
+      bool topLeft[3];
+      for( int k = 0; k < 3; k++ )
+      {
+         double ex = p.x[ to[k] ] - p.x[ from[k] ];
+         double ey = p.y[ to[k] ] - p.y[ from[k] ];
+         dEdx[k] = -ey;
+         dEdy[k] =  ex;
+         topLeft[k] = ( ey < 0. ) || ( ey == 0. && ex < 0. );
+      }
+
+      // depth is linear in window coordinates; triangles are pushed back by
+      // the polygon offset
+      double zA = p.z[ corner[0] ], zB = p.z[ corner[1] ], zC = p.z[ corner[2] ];
+      double dzdx = ( zA*dEdx[0] + zB*dEdx[1] + zC*dEdx[2] ) / area;
+      double dzdy = ( zA*dEdy[0] + zB*dEdy[1] + zC*dEdy[2] ) / area;
+      double offset = call.offsetFactor * max( fabs( dzdx ), fabs( dzdy )) +
+                      call.offsetUnits * depthResolution;
+
+      // pixels covered by the triangle within the given rectangle
+      double xMin = min( p.x[0], min( p.x[1], p.x[2] ));
+      double xMax = max( p.x[0], max( p.x[1], p.x[2] ));
+      double yMin = min( p.y[0], min( p.y[1], p.y[2] ));
+      double yMax = max( p.y[0], max( p.y[1], p.y[2] ));
+      int i0 = max( x0,   (int) ceil ( xMin - .5 ));
+      int i1 = min( x1-1, (int) floor( xMax - .5 ));
+      int j0 = max( y0,   (int) ceil ( yMin - .5 ));
+      int j1 = min( y1-1, (int) floor( yMax - .5 ));
+
+      float attributes[ nAttributes ];
+      float color[4];
+      for( int j = j0; j <= j1; j++ )
+      {
+         // edge functions at the first pixel of the row (exact, since all
+         // coordinates lie on the subpixel grid)
+         double E[3];
+         for( int k = 0; k < 3; k++ )
+         {
+            E[k] = ( p.x[ to[k] ] - p.x[ from[k] ] ) * ( j + .5 - p.y[ from[k] ] ) -
+                   ( p.y[ to[k] ] - p.y[ from[k] ] ) * ( i0 + .5 - p.x[ from[k] ] );
+         }
+
+         for( int i = i0; i <= i1; i += 4 )
+         {
+            double e[3];
+            for( int k = 0; k < 3; k++ ) e[k] = E[k] + ( i - i0 ) * dEdx[k];
+
+            int mask = coverage( e, dEdx, topLeft, min( 4, i1 - i + 1 ));
+            for( int l = 0; mask != 0; l++, mask >>= 1 )
+            {
+               if( !( mask & 1 )) continue;
+
+               // barycentric coordinates
+               double lambda[3];
+               for( int k = 0; k < 3; k++ ) lambda[k] = ( e[k] + l * dEdx[k] ) / area;
+
+               // depth test
+               double z = lambda[0]*zA + lambda[1]*zB + lambda[2]*zC + offset;
+               if( z < 0. || z > 1. ) continue;
+               int pixel = ( i + l ) + w * j;
+               if( z >= depthBuffer[ pixel ] ) continue;
+               depthBuffer[ pixel ] = z;
+
+               // perspective-correct attributes
+               double invW = 0.;
+               for( int k = 0; k < 3; k++ ) invW += lambda[k] * p.invW[ corner[k] ];
+               for( int n = 0; n < nAttributes; n++ )
+               {
+                  double sum = 0.;
+                  for( int k = 0; k < 3; k++ ) sum += lambda[k] * p.attributes[ corner[k] ][n];
+                  attributes[n] = sum / invW;
+               }
+
+               shade( call, attributes, color );
+
+               float* target = &colorBuffer[ 3*pixel ];
+               float alpha = call.blended ? color[3] : 1.f;
+               for( int k = 0; k < 3; k++ )
+               {
+                  target[k] = alpha * color[k] + ( 1.f - alpha ) * target[k];
+               }
+            }
+         }
+      }
+   }
+
+   void Rasterizer :: shade( const DrawCall& call, const float* attributes, float* color ) const
+   {
+      for( int k = 0; k < 4; k++ ) color[k] = attributes[k];
+
+      if( call.shaded )
+      {
+         // same as shaders/fragment.glsl
+         Vector N( attributes[4], attributes[5], attributes[6] );
+         Vector P( attributes[7], attributes[8], attributes[9] );
+         if( N.norm() > 0. ) N.normalize();
+         Vector L = ( light - P ).unit();
+         Vector E = ( eye - P ).unit();
+         Vector R = 2.*dot(L,N)*N - L;
+
+         const double shininess = 8.;
+         const double sharpness = 10.;
+         double diffuse = max( 0., dot( N, L ));
+         double specular = pow( max( 0., dot( R, E )), shininess );
+         double NE = max( 0., dot( N, E ));
+         double fresnel = pow( sqrt( max( 0., 1. - NE*NE )), sharpness );
+
+         for( int k = 0; k < 3; k++ )
+         {
+            color[k] = diffuse*color[k] + .5*specular + .5*fresnel;
+         }
+         color[3] = 1.;
+      }
+
+      for( int k = 0; k < 4; k++ )
+      {
+         color[k] = max( 0.f, min( 1.f, color[k] ));
+      }
+   }
+}
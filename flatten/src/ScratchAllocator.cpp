@@ -0,0 +1,234 @@
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+using namespace std;
+
+#include "ScratchAllocator.h"
+
+namespace DDG
+{
+   struct BlockInfo
+   {
+      size_t size;   // requested size
+      size_t mapped; // length of the scratch mapping (zero for heap blocks)
+   };
+
+   union BlockHeader
+   // stored just before each block; the union pads the header so that
+   // blocks have the same alignment as memory returned by malloc()
+   {
+      BlockInfo info;
+      long double align;
+   };
+
+   const size_t minScratchBlock = 1<<20;
+   // blocks smaller than this are always allocated from the heap
+
+   static size_t budgetBytes = 0;
+   static size_t heapTotal = 0;
+   static size_t scratchTotal = 0;
+   static size_t scratchPeak = 0;
+   static string scratchDirectory;
+
+   void ScratchAllocator :: install( cholmod_common* common )
+   // makes SuiteSparse allocate memory through ScratchAllocator
+   {
+#if defined( SUITESPARSE_MAIN_VERSION ) && SUITESPARSE_MAIN_VERSION >= 7
+      SuiteSparse_config_malloc_func_set( allocate );
+      SuiteSparse_config_calloc_func_set( allocateZero );
+      SuiteSparse_config_realloc_func_set( reallocate );
+      SuiteSparse_config_free_func_set( release );
+#elif defined( SUITESPARSE_MAIN_VERSION ) && ( SUITESPARSE_MAIN_VERSION > 4 || SUITESPARSE_SUB_VERSION >= 3 )
+      SuiteSparse_config.malloc_func = allocate;
+      SuiteSparse_config.calloc_func = allocateZero;
+      SuiteSparse_config.realloc_func = reallocate;
+      SuiteSparse_config.free_func = release;
+#else
+      // older versions keep the allocation routines in cholmod_common
+      common->malloc_memory = allocate;
+      common->calloc_memory = allocateZero;
+      common->realloc_memory = reallocate;
+      common->free_memory = release;
+#endif
+   }
+
+   void ScratchAllocator :: setBudget( size_t bytes )
+   // sets the maximum number of bytes allocated from the heap
+   {
+      budgetBytes = bytes;
+   }
+
+   size_t ScratchAllocator :: budget( void )
+   // returns the current budget
+   {
+      return budgetBytes;
+   }
+
+   void ScratchAllocator :: setDirectory( const string& path )
+   // sets the directory where scratch files are created
+   {
+      scratchDirectory = path;
+   }
+
+   size_t ScratchAllocator :: heapBytes( void )
+   // returns the number of bytes currently allocated from the heap
+   {
+      return heapTotal;
+   }
+
+   size_t ScratchAllocator :: scratchBytes( void )
+   // returns the number of bytes currently stored in scratch files
+   {
+      return scratchTotal;
+   }
+
+   size_t ScratchAllocator :: peakScratchBytes( void )
+   // returns the largest number of bytes ever stored in scratch files
+   {
+      return scratchPeak;
+   }
+
+   void* ScratchAllocator :: allocate( size_t size )
+   // replacement for malloc
+   {
+      return allocateBlock( size, false );
+   }
+
+   void* ScratchAllocator :: allocateZero( size_t count, size_t size )
+   // replacement for calloc
+   {
+      if( size != 0 && count > (size_t)(-1) / size )
+      {
+         return NULL;
+      }
+
+      return allocateBlock( count*size, true );
+   }
+
+   void* ScratchAllocator :: reallocate( void* p, size_t size )
+   // replacement for realloc
+   {
+      if( p == NULL )
+      {
+         return allocateBlock( size, false );
+      }
+
+      BlockHeader* h = (BlockHeader*) p - 1;
+      size_t oldSize = h->info.size;
+
+      // heap blocks that stay within the budget are resized in place
+      if( h->info.mapped == 0 &&
+          ( budgetBytes == 0 || size < minScratchBlock || heapTotal + size - oldSize <= budgetBytes ))
+      {
+         BlockHeader* g = (BlockHeader*) realloc( h, size + sizeof( BlockHeader ));
+         if( g == NULL ) return NULL;
+
+         __sync_fetch_and_add( &heapTotal, size );
+         __sync_fetch_and_sub( &heapTotal, oldSize );
+         g->info.size = size;
+         return g + 1;
+      }
+
+      // otherwise move the contents to a new block
+      void* q = allocateBlock( size, false );
+      if( q == NULL ) return NULL;
+
+      memcpy( q, p, min( size, oldSize ));
+      release( p );
+      return q;
+   }
+
+   void ScratchAllocator :: release( void* p )
+   // replacement for free
+   {
+      if( p == NULL ) return;
+
+      BlockHeader* h = (BlockHeader*) p - 1;
+
+      if( h->info.mapped )
+      {
+         size_t length = h->info.mapped;
+         __sync_fetch_and_sub( &scratchTotal, length );
+         munmap( h, length );
+      }
+      else
+      {
+         __sync_fetch_and_sub( &heapTotal, h->info.size + sizeof( BlockHeader ));
+         free( h );
+      }
+   }
+
+   void* ScratchAllocator :: allocateBlock( size_t size, bool zero )
+   // allocates a block from the heap, or from a scratch file if the
+   // block is large and the heap budget would otherwise be exceeded
+   {
+      size_t total = size + sizeof( BlockHeader );
+      BlockHeader* h = NULL;
+
+      if( budgetBytes > 0 && size >= minScratchBlock && heapTotal + total > budgetBytes )
+      {
+         size_t page = sysconf( _SC_PAGESIZE );
+         size_t length = ( total + page - 1 ) / page * page;
+
+         // (if no scratch file can be created, we fall back to the heap)
+         h = (BlockHeader*) mapBlock( length );
+         if( h )
+         {
+            h->info.mapped = length;
+
+            size_t s = __sync_add_and_fetch( &scratchTotal, length );
+            size_t peak = scratchPeak;
+            while( s > peak && !__sync_bool_compare_and_swap( &scratchPeak, peak, s ))
+            {
+               peak = scratchPeak;
+            }
+         }
+      }
+
+      if( h == NULL )
+      {
+         h = (BlockHeader*)( zero ? calloc( 1, total ) : malloc( total ));
+         if( h == NULL ) return NULL;
+
+         h->info.mapped = 0;
+         __sync_fetch_and_add( &heapTotal, total );
+      }
+
+      h->info.size = size;
+      return h + 1;
+   }
+
+   void* ScratchAllocator :: mapBlock( size_t length )
+   // creates a scratch file of the given length and maps it into memory
+   // (the file is initially zero, and is deleted once it is unmapped)
+   {
+      string directory = scratchDirectory;
+      if( directory.empty() )
+      {
+         const char* tmp = getenv( "TMPDIR" );
+         directory = tmp ? tmp : "/tmp";
+      }
+
+      string pattern = directory + "/ddg-scratch-XXXXXX";
+      vector<char> name( pattern.begin(), pattern.end() );
+      name.push_back( '\0' );
+
+      int fd = mkstemp( &name[0] );
+      if( fd < 0 ) return NULL;
+      unlink( &name[0] );
+
+      if( ftruncate( fd, length ) != 0 )
+      {
+         close( fd );
+         return NULL;
+      }
+
+      void* p = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+      close( fd );
+
+      if( p == MAP_FAILED ) return NULL;
+      return p;
+   }
+}
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+#include "SolverQueue.h"
+
+namespace DDG
+{
+   const size_t workerStackSize = 64<<20;
+   // METIS and the supernodal factorization recurse quite deeply, and the
+   // default stack of a secondary thread is small on some platforms (512k
+   // on Mac OS X), so workers get the same amount of stack as a main thread
+
+   SolverTask :: SolverTask( void )
+   : cancelFlag( false ),
+     fraction( 0. )
+   {
+      pthread_mutex_init( &mutex, NULL );
+   }
+
+   SolverTask :: ~SolverTask( void )
+   {
+      pthread_mutex_destroy( &mutex );
+   }
+
+   void SolverTask :: cancel( void )
+   // requests that the task stop as soon as possible
+   {
+      pthread_mutex_lock( &mutex );
+      cancelFlag = true;
+      pthread_mutex_unlock( &mutex );
+   }
+
+   bool SolverTask :: cancelled( void ) const
+   // returns true if cancel() has been called
+   {
+      pthread_mutex_lock( &mutex );
+      bool c = cancelFlag;
+      pthread_mutex_unlock( &mutex );
+
+      return c;
+   }
+
+   void SolverTask :: setProgress( double f, const string& stage )
+   // reports the fraction of work done and the current stage
+   {
+      pthread_mutex_lock( &mutex );
+      fraction = f;
+      stageName = stage;
+      pthread_mutex_unlock( &mutex );
+   }
+
+   double SolverTask :: progress( void ) const
+   // returns the most recently reported fraction of work done
+   {
+      pthread_mutex_lock( &mutex );
+      double f = fraction;
+      pthread_mutex_unlock( &mutex );
+
+      return f;
+   }
+
+   string SolverTask :: stage( void ) const
+   // returns the most recently reported stage
+   {
+      pthread_mutex_lock( &mutex );
+      string s = stageName;
+      pthread_mutex_unlock( &mutex );
+
+      return s;
+   }
+
+   SolverQueue :: SolverQueue( int nThreads_ )
+   : nThreads( max( 1, nThreads_ )),
+     stopping( false )
+   {
+      pthread_mutex_init( &mutex, NULL );
+      pthread_cond_init( &available, NULL );
+   }
+
+   SolverQueue :: ~SolverQueue( void )
+   {
+      shutdown();
+
+      // tasks that were never finished are simply discarded
+      for( list<SolverTask*>::iterator t = completed.begin(); t != completed.end(); t++ )
+      {
+         delete *t;
+      }
+
+      pthread_cond_destroy( &available );
+      pthread_mutex_destroy( &mutex );
+   }
+
+   void SolverQueue :: submit( SolverTask* task )
+   // appends a task to the queue
+   {
+      pthread_mutex_lock( &mutex );
+
+      if( stopping )
+      {
+         pthread_mutex_unlock( &mutex );
+         delete task;
+         return;
+      }
+
+      if( threads.empty() ) start();
+
+      pending.push_back( task );
+      pthread_cond_signal( &available );
+      pthread_mutex_unlock( &mutex );
+   }
+
+   int SolverQueue :: poll( void )
+   // finishes every task that has completed since the last call
+   {
+      list<SolverTask*> done;
+
+      pthread_mutex_lock( &mutex );
+      done.swap( completed );
+      pthread_mutex_unlock( &mutex );
+
+      // finish() is called without holding the lock, since it may well
+      // submit another task
+      int nFinished = 0;
+      for( list<SolverTask*>::iterator t = done.begin(); t != done.end(); t++ )
+      {
+         if( !(*t)->cancelled() )
+         {
+            (*t)->finish();
+            nFinished++;
+         }
+         delete *t;
+      }
+
+      return nFinished;
+   }
+
+   bool SolverQueue :: busy( void ) const
+   // returns true if any task is waiting, running, or not yet finished
+   {
+      pthread_mutex_lock( &mutex );
+      bool b = !pending.empty() || !running.empty() || !completed.empty();
+      pthread_mutex_unlock( &mutex );
+
+      return b;
+   }
+
+   bool SolverQueue :: status( double& fraction, string& stage ) const
+   // gets the progress of the oldest running (or waiting) task
+   {
+      bool active = true;
+
+      pthread_mutex_lock( &mutex );
+      if( !running.empty() )
+      {
+         fraction = running.front()->progress();
+         stage = running.front()->stage();
+      }
+      else if( !pending.empty() )
+      {
+         fraction = 0.;
+         stage = "waiting";
+      }
+      else
+      {
+         active = false;
+      }
+      pthread_mutex_unlock( &mutex );
+
+      return active;
+   }
+
+   void SolverQueue :: cancelAll( void )
+   // cancels every task that has not yet been finished
+   {
+      pthread_mutex_lock( &mutex );
+      for( list<SolverTask*>::iterator t = pending.begin(); t != pending.end(); t++ )
+      {
+         delete *t;
+      }
+      pending.clear();
+
+      for( list<SolverTask*>::iterator t = running.begin(); t != running.end(); t++ )
+      {
+         (*t)->cancel();
+      }
+
+      for( list<SolverTask*>::iterator t = completed.begin(); t != completed.end(); t++ )
+      {
+         (*t)->cancel();
+      }
+      pthread_mutex_unlock( &mutex );
+   }
+
+   void SolverQueue :: shutdown( void )
+   // cancels all tasks and joins the worker threads
+   {
+      cancelAll();
+
+      pthread_mutex_lock( &mutex );
+      stopping = true;
+      pthread_cond_broadcast( &available );
+      pthread_mutex_unlock( &mutex );
+
+      for( size_t i = 0; i < threads.size(); i++ )
+      {
+         pthread_join( threads[i], NULL );
+      }
+      threads.clear();
+   }
+
+   void SolverQueue :: start( void )
+   // launches the worker threads
+   {
+      pthread_attr_t attributes;
+      pthread_attr_init( &attributes );
+      pthread_attr_setstacksize( &attributes, workerStackSize );
+
+      for( int i = 0; i < nThreads; i++ )
+      {
+         pthread_t thread;
+         if( pthread_create( &thread, &attributes, work, this ) != 0 )
+         {
+            cerr << "Warning: could not start solver thread!" << endl;
+            continue;
+         }
+         threads.push_back( thread );
+      }
+
+      pthread_attr_destroy( &attributes );
+
+      if( threads.empty() )
+      {
+         cerr << "Error: no solver threads are available!" << endl;
+         exit( 1 );
+      }
+   }
+
+   void* SolverQueue :: work( void* queue )
+   // worker thread entry point
+   {
+      ((SolverQueue*) queue)->workLoop();
+      return NULL;
+   }
+
+   void SolverQueue :: workLoop( void )
+   // repeatedly takes the next task off the queue and runs it
+   {
+      pthread_mutex_lock( &mutex );
+      while( true )
+      {
+         while( pending.empty() && !stopping )
+         {
+            pthread_cond_wait( &available, &mutex );
+         }
+         if( stopping ) break;
+
+         SolverTask* task = pending.front();
+         pending.pop_front();
+         list<SolverTask*>::iterator r = running.insert( running.end(), task );
+         pthread_mutex_unlock( &mutex );
+
+         if( !task->cancelled() )
+         {
+            task->run();
+         }
+
+         pthread_mutex_lock( &mutex );
+         running.erase( r );
+         completed.push_back( task );
+      }
+      pthread_mutex_unlock( &mutex );
+   }
+}
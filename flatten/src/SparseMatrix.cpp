@@ -1,7 +1,131 @@
 #include "SparseMatrix.h"
+#include "QuaternionBlockMatrix.h"
 
 namespace DDG
 {
+   const double cgTolerance = 1e-10;
+   // relative residual at which the quaternionic iterative solvers stop
+
+   const int maxRefineIter = 10;
+   const double refineTolerance = 1e-13;
+   const double minRefineProgress = 0.5;
+   // mixed-precision solves stop once the backward error |b-Ax|/(|A||x|+|b|)
+   // drops below refineTolerance, and give up (falling back to double
+   // precision) if an iteration fails to reduce the residual by at least
+   // a factor of minRefineProgress
+
+#ifdef CHOLMOD_VER_CODE
+#if CHOLMOD_VERSION >= CHOLMOD_VER_CODE(5,0)
+#define DDG_SINGLE_PRECISION_FACTOR
+#endif
+#endif
+
+   static void precondition( const DenseMatrix<Quaternion>& d,
+                             const DenseMatrix<Quaternion>& r,
+                                   DenseMatrix<Quaternion>& z )
+   // applies the block Jacobi preconditioner z = D^-1 r
+   {
+      z = r;
+
+      for( int c = 0; c < r.nColumns(); c++ )
+      for( int i = 0; i < r.nRows(); i++ )
+      {
+         z(i,c) = d(i) * r(i,c);
+      }
+   }
+
+#ifdef DDG_SINGLE_PRECISION_FACTOR
+   cholmod_factor* factorSinglePrecision( cholmod_sparse* A, cholmod_factor* L )
+   // factors A in single precision, reusing the symbolic analysis in L if given
+   {
+      cholmod_sparse* As = cholmod_l_copy_sparse( A, context );
+      cholmod_l_sparse_xtype( As->xtype + CHOLMOD_SINGLE, As, context );
+
+      if( L == NULL )
+      {
+         L = cholmod_l_analyze( As, context );
+      }
+      cholmod_l_factorize( As, L, context );
+      cholmod_l_free_sparse( &As, context );
+
+      return L;
+   }
+
+   cholmod_dense* refineSolution( cholmod_sparse* A, cholmod_factor* L, cholmod_dense* b, bool& converged )
+   // solves Ax = b in double precision using the single-precision
+   // factor L of A and iterative refinement
+   {
+      double one[2] = { 1., 0. };
+      double minusOne[2] = { -1., 0. };
+
+      cholmod_dense* x = cholmod_l_zeros( b->nrow, b->ncol, b->xtype, context );
+      size_t n = b->nrow * b->ncol * ( b->xtype == CHOLMOD_COMPLEX ? 2 : 1 );
+      double normA = cholmod_l_norm_sparse( A, 0, context );
+      double normB = cholmod_l_norm_dense( b, 0, context );
+      double previous = 0.;
+
+      converged = false;
+      for( int iter = 0; iter < maxRefineIter; iter++ )
+      {
+         // r = b - Ax (in double precision)
+         cholmod_dense* r = cholmod_l_copy_dense( b, context );
+         cholmod_l_sdmult( A, 0, minusOne, one, x, r, context );
+
+         double normR = cholmod_l_norm_dense( r, 0, context );
+         double normX = cholmod_l_norm_dense( x, 0, context );
+         if( normR <= refineTolerance * ( normA*normX + normB ))
+         {
+            cholmod_l_free_dense( &r, context );
+            converged = true;
+            break;
+         }
+         if( iter > 0 && normR > minRefineProgress * previous )
+         {
+            cholmod_l_free_dense( &r, context );
+            break;
+         }
+         previous = normR;
+
+         // solve Ld = r in single precision, then x += d
+         cholmod_l_dense_xtype( r->xtype + CHOLMOD_SINGLE, r, context );
+         cholmod_dense* d = cholmod_l_solve( CHOLMOD_A, L, r, context );
+         cholmod_l_dense_xtype( d->xtype + CHOLMOD_DOUBLE, d, context );
+
+         double* xData = (double*) x->x;
+         double* dData = (double*) d->x;
+         for( size_t i = 0; i < n; i++ )
+         {
+            xData[i] += dData[i];
+         }
+
+         cholmod_l_free_dense( &d, context );
+         cholmod_l_free_dense( &r, context );
+      }
+
+      return x;
+   }
+#else
+   cholmod_factor* factorSinglePrecision( cholmod_sparse* A, cholmod_factor* L )
+   // single-precision factors are unavailable, so callers keep
+   // the double-precision factorization
+   {
+      static bool warned = false;
+      if( !warned )
+      {
+         cerr << "Warning: single-precision factorization requires CHOLMOD 5 or later; using double precision." << endl;
+         warned = true;
+      }
+      return NULL;
+   }
+
+   cholmod_dense* refineSolution( cholmod_sparse* A, cholmod_factor* L, cholmod_dense* b, bool& converged )
+   // never reached, since no factor is ever marked as single precision
+   {
+      converged = false;
+      return NULL;
+   }
+#endif
+
    template <>
    const SparseMatrix<Real>& SparseMatrix<Real> :: operator=( cholmod_sparse* B )
    {
@@ -99,6 +223,16 @@ namespace DDG
       return cData;
    }
 
+   template <>
+   cholmod_sparse* SparseMatrix<Quaternion> :: to_cholmod_upper( void )
+   {
+      // keep the upper triangle of the real 4x4 block expansion
+      cholmod_sparse* C = cholmod_l_copy( to_cholmod(), 1, 1, context );
+      cholmod_l_free_sparse( &cData, context );
+      cData = C;
+      return cData;
+   }
+
    template <>
    void SparseMatrix<Real> :: allocateSparse( void )
    {
@@ -148,14 +282,15 @@ namespace DDG
                 DenseMatrix<Real>& b )
    // solves the sparse linear system Ax = b using sparse QR factorization
    {
-      int t0 = clock();
-      x = SuiteSparseQR<double>( A.to_cholmod(), b.to_cholmod(), context );
-      int t1 = clock();
+      double t0 = wallClock();
+      x = SuiteSparseQR<double>( context.qrOrdering(), SPQR_DEFAULT_TOL, A.to_cholmod(), b.to_cholmod(), context );
+      double t1 = wallClock();
 
       cout << "[qr] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[qr] max residual: " << residual( A, x, b ) << "\n";
       cout << "[qr] size: " << A.nRows() << " x " << A.nColumns() << "\n";
       cout << "[qr] rank: " << (*context).SPQR_istat[4] << "\n";
+      if( context.verbose() ) context.printQRStatistics( cout, "[qr]" );
    }
 
    template <>
@@ -164,30 +299,138 @@ namespace DDG
                 DenseMatrix<Complex>& b )
    // solves the sparse linear system Ax = b using sparse QR factorization
    {
-      int t0 = clock();
-      x = SuiteSparseQR< complex<double> >( A.to_cholmod(), b.to_cholmod(), context );
-      int t1 = clock();
+      double t0 = wallClock();
+      x = SuiteSparseQR< complex<double> >( context.qrOrdering(), SPQR_DEFAULT_TOL, A.to_cholmod(), b.to_cholmod(), context );
+      double t1 = wallClock();
 
       cout << "[qr] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[qr] max residual: " << residual( A, x, b ) << "\n";
       cout << "[qr] size: " << A.nRows() << " x " << A.nColumns() << " (complex)" << "\n";
       cout << "[qr] rank: " << (*context).SPQR_istat[4] << "\n";
+      if( context.verbose() ) context.printQRStatistics( cout, "[qr]" );
    }
 
    template <>
    void solve( SparseMatrix<Quaternion>& A,
                 DenseMatrix<Quaternion>& x,
                 DenseMatrix<Quaternion>& b )
-   // solves the sparse linear system Ax = b using sparse QR factorization
+   // solves the sparse linear system Ax = b in the least-squares sense using
+   // conjugate gradients on the normal equations (CGLS); quaternionic entries
+   // are kept as 4x4 blocks rather than expanded into a real matrix
    {
-      int t0 = clock();
-      x = SuiteSparseQR<double>( A.to_cholmod(), b.to_cholmod(), context );
-      int t1 = clock();
+      double t0 = wallClock();
 
-      cout << "[qr] time: " << seconds( t0, t1 ) << "s" << "\n";
-      cout << "[qr] max residual: " << residual( A, x, b ) << "\n";
-      cout << "[qr] size: " << A.nRows() << " x " << A.nColumns() << " (quaternion)" << "\n";
-      cout << "[qr] rank: " << (*context).SPQR_istat[4]/4 << "\n";
+      QuaternionBlockMatrix B( A );
+      x = DenseMatrix<Quaternion>( B.nColumns(), b.nColumns() );
+
+      DenseMatrix<Quaternion> r( b ), s, p, q;
+      B.multiplyAdjoint( r, s );
+      p = s;
+
+      double gamma = inner( s, s ).re();
+      double stop = cgTolerance * sqrt( gamma );
+      int maxIter = 4 * B.nColumns() * b.nColumns();
+      int iter = 0;
+
+      while( iter < maxIter && sqrt( gamma ) > stop )
+      {
+         B.multiply( p, q );
+         double alpha = gamma / inner( q, q ).re();
+         axpy( Quaternion(  alpha ), p, x );
+         axpy( Quaternion( -alpha ), q, r );
+
+         B.multiplyAdjoint( r, s );
+         double gammaNew = inner( s, s ).re();
+         p *= gammaNew / gamma;
+         p += s;
+         gamma = gammaNew;
+         iter++;
+      }
+
+      double t1 = wallClock();
+
+      cout << "[cgls] time: " << seconds( t0, t1 ) << "s" << "\n";
+      cout << "[cgls] max residual: " << residual( A, x, b ) << "\n";
+      cout << "[cgls] size: " << A.nRows() << " x " << A.nColumns() << " (quaternion)" << "\n";
+      cout << "[cgls] blocks: " << B.nBlocks() << "\n";
+      cout << "[cgls] iterations: " << iter << "\n";
+
+      // CGLS can stall on ill-conditioned systems; rather than return an
+      // inaccurate solution, fall back to QR on the real 4x4 block expansion
+      if( sqrt( gamma ) > stop )
+      {
+         cerr << "Warning: CGLS did not converge in " << iter << " iterations; solving with QR instead." << endl;
+
+         x = SuiteSparseQR<double>( context.qrOrdering(), SPQR_DEFAULT_TOL, A.to_cholmod(), b.to_cholmod(), context );
+         double t2 = wallClock();
+
+         cout << "[qr] time: " << seconds( t1, t2 ) << "s" << "\n";
+         cout << "[qr] max residual: " << residual( A, x, b ) << "\n";
+         cout << "[qr] rank: " << (*context).SPQR_istat[4]/4 << "\n";
+      }
+   }
+
+   template <>
+   void solvePositiveDefinite( SparseMatrix<Quaternion>& A,
+                                DenseMatrix<Quaternion>& x,
+                                DenseMatrix<Quaternion>& b )
+   // solves the positive definite sparse linear system Ax = b using block
+   // Jacobi-preconditioned conjugate gradients on the 4x4 block structure
+   {
+      double t0 = wallClock();
+
+      QuaternionBlockMatrix B( A );
+      x = DenseMatrix<Quaternion>( B.nColumns(), b.nColumns() );
+
+      DenseMatrix<Quaternion> d, r( b ), z, p, q;
+      B.diagonalInverse( d );
+      precondition( d, r, z );
+      p = z;
+
+      double rz = inner( r, z ).re();
+      double stop = cgTolerance * b.norm( lTwo );
+      int maxIter = 4 * B.nColumns() * b.nColumns();
+      int iter = 0;
+
+      while( iter < maxIter && r.norm( lTwo ) > stop )
+      {
+         B.multiply( p, q );
+         double alpha = rz / inner( p, q ).re();
+         axpy( Quaternion(  alpha ), p, x );
+         axpy( Quaternion( -alpha ), q, r );
+
+         precondition( d, r, z );
+         double rzNew = inner( r, z ).re();
+         p *= rzNew / rz;
+         p += z;
+         rz = rzNew;
+         iter++;
+      }
+
+      double t1 = wallClock();
+
+      cout << "[cg] time: " << seconds( t0, t1 ) << "s" << "\n";
+      cout << "[cg] max residual: " << residual( A, x, b ) << "\n";
+      cout << "[cg] size: " << A.nRows() << " x " << A.nColumns() << " (quaternion)" << "\n";
+      cout << "[cg] blocks: " << B.nBlocks() << "\n";
+      cout << "[cg] iterations: " << iter << "\n";
+
+      // likewise, fall back to a Cholesky factorization of the real expansion
+      if( r.norm( lTwo ) > stop )
+      {
+         cerr << "Warning: CG did not converge in " << iter << " iterations; solving with Cholesky instead." << endl;
+
+         cholmod_sparse* Ac = A.to_cholmod();
+         Ac->stype = 1;
+         cholmod_factor* L = cholmod_l_analyze( Ac, context );
+         cholmod_l_factorize( Ac, L, context );
+         x = cholmod_l_solve( CHOLMOD_A, L, b.to_cholmod(), context );
+         if( L ) cholmod_l_free_factor( &L, context );
+         double t2 = wallClock();
+
+         cout << "[chol] time: " << seconds( t1, t2 ) << "s" << "\n";
+         cout << "[chol] max residual: " << residual( A, x, b ) << "\n";
+      }
    }
 
    template <>
@@ -196,7 +439,7 @@ namespace DDG
                         DenseMatrix<Complex>& b )
    // solves the sparse linear system Ax = b using sparse LU factorization
    {
-      int t0 = clock();
+      double t0 = wallClock();
       cholmod_sparse* Ac = A.to_cholmod();
       int n = Ac->nrow;
       UF_long* Ap = (UF_long*) Ac->p;
@@ -211,7 +454,7 @@ namespace DDG
       umfpack_zl_free_symbolic( &Symbolic );
       umfpack_zl_free_numeric( &Numeric );
 
-      int t1 = clock();
+      double t1 = wallClock();
       cout << "[lu] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[lu] max residual: " << residual( A, x, b ) << "\n";
    }
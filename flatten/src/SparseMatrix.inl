@@ -22,6 +22,9 @@ namespace DDG
    const int maxEigIter = 20;
    // number of iterations used to solve eigenvalue problems
    const double maxEigRes = 1;
+   const double eigTolerance = 1e-8;
+   // relative change in the eigenvector below which positive-definite
+   // eigenvalue iterations stop early (e.g., when warm-started)
 
    template <class T>
    SparseMatrix<T> :: SparseMatrix( int m_, int n_ )
@@ -381,6 +384,19 @@ namespace DDG
 
    template <class T>
    cholmod_sparse* SparseMatrix<T> :: to_cholmod( void )
+   {
+      return compress( false );
+   }
+
+   template <class T>
+   cholmod_sparse* SparseMatrix<T> :: to_cholmod_upper( void )
+   {
+      return compress( true );
+   }
+
+   template <class T>
+   cholmod_sparse* SparseMatrix<T> :: compress( bool upperOnly )
+   // builds cData, optionally keeping only entries on or above the diagonal
    {
       if( cData )
       {
@@ -389,6 +405,7 @@ namespace DDG
       }
 
       allocateSparse();
+      if( upperOnly ) cData->stype = 1;
 
       // build compressed matrix (note that EntryMap stores entries in column-major order)
        double* pr =  (double*) cData->x;
@@ -401,6 +418,8 @@ namespace DDG
                           e ++ )
       {
          int c = e->first.first;
+         if( upperOnly && e->first.second > c ) continue;
+
          if( c != j )
          {
             for( int k = j+1; k <= c; k++ )
@@ -426,6 +445,14 @@ namespace DDG
    template <>
    cholmod_sparse* SparseMatrix<Quaternion> :: to_cholmod( void );
 
+   template <>
+   cholmod_sparse* SparseMatrix<Quaternion> :: to_cholmod_upper( void );
+
+   template <>
+   void solvePositiveDefinite( SparseMatrix<Quaternion>& A,
+                                DenseMatrix<Quaternion>& x,
+                                DenseMatrix<Quaternion>& b );
+
    template <class T>
    T& SparseMatrix<T> :: operator()( int row, int col )
    {
@@ -497,7 +524,7 @@ namespace DDG
                         DenseMatrix<T>& b )
    // solves the sparse linear system Ax = b using sparse LU factorization
    {
-      int t0 = clock();
+      double t0 = wallClock();
       cholmod_sparse* Ac = A.to_cholmod();
       int n = Ac->nrow;
       UF_long* Ap = (UF_long*) Ac->p;
@@ -512,7 +539,7 @@ namespace DDG
       umfpack_dl_free_symbolic( &Symbolic );
       umfpack_dl_free_numeric( &Numeric );
 
-      int t1 = clock();
+      double t1 = wallClock();
       cout << "[lu] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[lu] max residual: " << residual( A, x, b ) << "\n";
    }
@@ -523,18 +550,27 @@ namespace DDG
                                 DenseMatrix<T>& b )
    // solves the positive definite sparse linear system Ax = b using sparse Cholesky factorization
    {
-      int t0 = clock();
-      cholmod_sparse* Ac = A.to_cholmod();
-      Ac->stype = 1;
-      cholmod_factor* L = cholmod_l_analyze( Ac, context );
-      cholmod_l_factorize( Ac, L, context );
-      x = cholmod_l_solve( CHOLMOD_A, L, b.to_cholmod(), context );
+      double t0 = wallClock();
+      if( context.mixedPrecision() )
+      {
+         SparseFactor<T> L;
+         L.build( A );
+         backsolvePositiveDefinite( L, x, b );
+      }
+      else
+      {
+         cholmod_sparse* Ac = A.to_cholmod_upper();
+         cholmod_factor* L = cholmod_l_analyze( Ac, context );
+         cholmod_l_factorize( Ac, L, context );
+         x = cholmod_l_solve( CHOLMOD_A, L, b.to_cholmod(), context );
 
-      if( L ) cholmod_l_free_factor( &L, context );
-      int t1 = clock();
+         if( L ) cholmod_l_free_factor( &L, context );
+      }
+      double t1 = wallClock();
 
       cout << "[chol] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[chol] max residual: " << residual( A, x, b ) << "\n";
+      if( context.verbose() ) context.printStatistics( cout, "[chol]" );
    }
 
    template <class T>
@@ -543,6 +579,22 @@ namespace DDG
                                      DenseMatrix<T>& b )
    // backsolves the prefactored positive definite sparse linear system LL'x = b
    {
+      if( L.mixedPrecision() )
+      {
+         bool converged;
+         cholmod_dense* y = refineSolution( L.matrix(), L.to_cholmod(), b.to_cholmod(), converged );
+
+         if( converged )
+         {
+            x = y;
+            return;
+         }
+
+         cholmod_l_free_dense( &y, context );
+         cerr << "[chol] iterative refinement stalled; refactoring in double precision" << endl;
+         L.promote();
+      }
+
       x = cholmod_l_solve( CHOLMOD_A, L.to_cholmod(), b.to_cholmod(), context );
    }
 
@@ -553,7 +605,7 @@ namespace DDG
    // solves A x = lambda x for the smallest nonzero eigenvalue lambda
    // A must be symmetric; x is used as an initial guess
    {
-      int t0 = clock();
+      double t0 = wallClock();
       // initialize y to have the same dimension as x
       DenseMatrix<T> y(x);
       // fixed numbr of iterations for simplicity
@@ -564,7 +616,7 @@ namespace DDG
          y.normalize();
          x = y;
       }
-      int t1 = clock();
+      double t1 = wallClock();
 
       cout << "[eig] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[eig] max residual: " << residual( A, x ) << "\n";
@@ -577,7 +629,7 @@ namespace DDG
    // solves A x = lambda B x for the smallest nonzero generalized eigenvalue lambda
    // A and B must be symmetric; x is used as an initial guess
    {
-      int t0 = clock();
+      double t0 = wallClock();
 
       // initialize y to have the same dimension as x
       DenseMatrix<T> y(x);
@@ -587,11 +639,11 @@ namespace DDG
          x = B * x;
          x.removeMean();
          solveSymmetric(A, y, x);
-         y /= sqrt((y.transpose() * (B * y)).norm());
+         y /= sqrt( inner( y, B*y ).norm() );
          x = y;
       }
 
-      int t1 = clock();
+      double t1 = wallClock();
 
       cout << "[eig] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[eig] max residual: " << residual( A, B, x ) << "\n";
@@ -604,7 +656,7 @@ namespace DDG
    // solves A x = lambda x for the smallest nonzero eigenvalue lambda
    // A must be positive (semi-)definite; x is used as an initial guess
    {
-      int t0 = clock();
+      double t0 = wallClock();
 
       DenseMatrix<T> y(x);
 
@@ -619,7 +671,7 @@ namespace DDG
          x = y;
       }
 
-      int t1 = clock();
+      double t1 = wallClock();
 
       cout << "[eig] time: " << seconds( t0, t1 ) << "s" << "\n";
       cout << "[eig] max residual: " << residual( A, x ) << "\n";
@@ -632,24 +684,43 @@ namespace DDG
    // solves A x = lambda x for the smallest nonzero eigenvalue lambda
    // A must be positive (semi-)definite; x is used as an initial guess
    {
-      int t0 = clock();
-
-      DenseMatrix<T> y(x);
-
       SparseFactor<T> L;
       L.build(A);
 
-      for( int iter = 0; iter < maxEigIter; iter++ )
+      smallestEigPositiveDefinite( L, A, B, x );
+   }
+
+   template <class T>
+   void smallestEigPositiveDefinite( SparseFactor<T>& L,
+                                     SparseMatrix<T>& A,
+                                     SparseMatrix<T>& B,
+                                      DenseMatrix<T>& x )
+   // solves A x = lambda B x using the prefactored matrix L = chol(A)
+   {
+      double t0 = wallClock();
+
+      DenseMatrix<T> y(x);
+
+      int iter = 0;
+      while( iter < maxEigIter )
       {
+         DenseMatrix<T> x0 = x;
+
          x = B * x;
          x.removeMean();
          backsolvePositiveDefinite(L, y, x);
-         y /= (y.transpose() * (B * y)).norm();
+         y /= sqrt( inner( y, B*y ).norm() );
          x = y;
+         iter++;
+
+         // stop once the eigenvector no longer changes, which happens
+         // after one or two iterations if x was already a good guess
+         if( (x-x0).norm( lTwo ) <= eigTolerance * x.norm( lTwo )) break;
       }
-      int t1 = clock();
+      double t1 = wallClock();
 
       cout << "[eig] time: " << seconds( t0, t1 ) << "s" << "\n";
+      cout << "[eig] iterations: " << iter << "\n";
       cout << "[eig] max residual: " << residual( A, B, x ) << "\n";
    }
 
@@ -669,7 +740,7 @@ namespace DDG
    {
       DenseMatrix<T> y(x);
       y.normalize();
-      Complex lambda = (y.transpose() * (A * y))(0,0);
+      Complex lambda = inner( y, A*y );
       // std::cout << lambda << "\n";
       // Res(A,y) := Ay - (y^T A y) y
       return (A * y - lambda * y).norm();
@@ -683,8 +754,8 @@ namespace DDG
    {
       DenseMatrix<T> y(x);
       // normalize y w.r.t. B
-      y /= sqrt((y.transpose() * (B * y)).norm());
-      Complex lambda = (y.transpose() * (A * y))(0,0);
+      y /= sqrt( inner( y, B*y ).norm() );
+      Complex lambda = inner( y, A*y );
       // Res(A,B,y) := Ay - (y^T A y) B y
       return (A * y - lambda * (B * y)).norm();
    }
@@ -695,7 +766,7 @@ namespace DDG
                        const  DenseMatrix<T>& x )
    // returns <x,Ax>/<x,x>
    {
-      return (x.transpose()*(A*x))(0) * (x.transpose()*x)(0).inv();
+      return inner( x, A*x ) * inner( x, x ).inv();
    }
 
    template <class T>
@@ -704,7 +775,7 @@ namespace DDG
                        const  DenseMatrix<T>& x )
    // returns <Ax,x>/<Bx,x>
    {
-      return (x.transpose()*(A*x))(0) * (x.transpose()*(B*x))(0).inv();
+      return inner( x, A*x ) * inner( x, B*x ).inv();
    }
 
    template <class T>
@@ -714,7 +785,7 @@ namespace DDG
                        const  DenseMatrix<T>& x )
    // returns <Ax,x>/<(B-EE^T)x,x>
    {
-      return (x.transpose()*(A*x))(0) * (x.transpose()*(B*x-E*(E.transpose()*x)))(0).inv();
+      return inner( x, A*x ) * inner( x, B*x-E*(E.transpose()*x) ).inv();
    }
 
    template <class T>
@@ -737,41 +808,130 @@ namespace DDG
 
    template <class T>
    SparseFactor<T> :: SparseFactor( void )
-   : L( NULL )
+   : L( NULL ),
+     A( NULL )
    {}
 
    template <class T>
    SparseFactor<T> :: ~SparseFactor( void )
    {
-      if( L )
-      {
-         cholmod_l_free_factor( &L, context );
-      }
+      clear();
    }
 
    template <class T>
-   void SparseFactor<T> :: build( SparseMatrix<T>& A )
+   void SparseFactor<T> :: clear( void )
    {
       if( L )
       {
          cholmod_l_free_factor( &L, context );
          L = NULL;
       }
+      if( A )
+      {
+         cholmod_l_free_sparse( &A, context );
+         A = NULL;
+      }
+   }
 
-      int t0, t1;
+   template <class T>
+   void SparseFactor<T> :: build( SparseMatrix<T>& A_ )
+   {
+      clear();
 
-      cholmod_sparse* Ac = A.to_cholmod();
-      Ac->stype = 1;
+      double t0, t1;
 
-      t0 = clock();
+      cholmod_sparse* Ac = A_.to_cholmod_upper();
+
+      if( context.mixedPrecision() )
+      {
+         // keep a double-precision copy of A for iterative refinement
+         A = cholmod_l_copy_sparse( Ac, context );
+
+         t0 = wallClock();
+         L = factorSinglePrecision( A, NULL );
+         t1 = wallClock();
+
+         if( L )
+         {
+            cerr << "factorize (single): " << seconds(t0,t1) << "s" << endl;
+            if( context.verbose() ) context.printStatistics( cerr, "[chol]" );
+            return;
+         }
+
+         cholmod_l_free_sparse( &A, context );
+         A = NULL;
+      }
+
+      t0 = wallClock();
       L = cholmod_l_analyze( Ac, context );
-      t1 = clock();
+      t1 = wallClock();
       cerr << "analyze: " << seconds(t0,t1) << "s" << endl;
 
-      t0 = clock();
+      t0 = wallClock();
       cholmod_l_factorize( Ac, L, context );
-      t1 = clock();
+      t1 = wallClock();
       cerr << "factorize: " << seconds(t0,t1) << "s" << endl;
+      if( context.verbose() ) context.printStatistics( cerr, "[chol]" );
+   }
+
+   template <class T>
+   void SparseFactor<T> :: refactor( SparseMatrix<T>& A_ )
+   {
+      if( L == NULL )
+      {
+         build( A_ );
+         return;
+      }
+
+      // reuse the existing ordering and symbolic analysis
+      cholmod_sparse* Ac = A_.to_cholmod_upper();
+
+      double t0 = wallClock();
+      if( mixedPrecision() )
+      {
+         cholmod_l_free_sparse( &A, context );
+         A = cholmod_l_copy_sparse( Ac, context );
+         factorSinglePrecision( A, L );
+      }
+      else
+      {
+         cholmod_l_factorize( Ac, L, context );
+      }
+      double t1 = wallClock();
+      cerr << "refactorize: " << seconds(t0,t1) << "s" << endl;
+      if( context.verbose() ) context.printStatistics( cerr, "[chol]" );
+   }
+
+   template <class T>
+   bool SparseFactor<T> :: mixedPrecision( void ) const
+   {
+      return A != NULL;
+   }
+
+   template <class T>
+   void SparseFactor<T> :: promote( void )
+   {
+      if( !mixedPrecision() )
+      {
+         return;
+      }
+
+      cholmod_l_free_factor( &L, context );
+
+      double t0 = wallClock();
+      L = cholmod_l_analyze( A, context );
+      cholmod_l_factorize( A, L, context );
+      double t1 = wallClock();
+      cerr << "factorize (double): " << seconds(t0,t1) << "s" << endl;
+
+      cholmod_l_free_sparse( &A, context );
+      A = NULL;
+   }
+
+   template <class T>
+   cholmod_sparse* SparseFactor<T> :: matrix( void )
+   {
+      return A;
    }
 
    template <class T>
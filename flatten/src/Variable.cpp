@@ -2,11 +2,21 @@
 
 namespace DDG
 {
+   static unsigned int nextVariableID = 0;
+   // id assigned to the next variable constructed
+
+   static unsigned int newVariableID( void )
+   // returns a new id; atomic, so that variables can be created from several threads
+   {
+      return __sync_fetch_and_add( &nextVariableID, 1 );
+   }
+
    Variable :: Variable( double value_,
                          bool fixed_ )
    // initialize a variable which has value zero and is not fixed by default
    : value( value_ ),
-     fixed( fixed_ )
+     fixed( fixed_ ),
+     id( newVariableID() )
    {}
 
    Variable :: Variable( std::string name_,
@@ -15,9 +25,28 @@ namespace DDG
    // initialize a named variable which has value zero and is not fixed by default
    : name( name_ ),
      value( value_ ),
-     fixed( fixed_ )
+     fixed( fixed_ ),
+     id( newVariableID() )
+   {}
+
+   Variable :: Variable( const Variable& v )
+   // copies the name, value, and fixed flag of v; the copy gets a new id
+   : name( v.name ),
+     value( v.value ),
+     fixed( v.fixed ),
+     id( newVariableID() )
    {}
 
+   const Variable& Variable :: operator=( const Variable& v )
+   // copies the name, value, and fixed flag of v; the id is unchanged
+   {
+      name = v.name;
+      value = v.value;
+      fixed = v.fixed;
+
+      return *this;
+   }
+
    double& Variable :: operator*( void )
    // returns a reference to the numerical value
    {
@@ -6,6 +6,8 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
 using namespace std;
 
 #include "Viewer.h"
@@ -16,15 +18,106 @@ namespace DDG
 {
    // declare static member variables
    Mesh Viewer::mesh;
-   GLuint Viewer::surfaceDL = 0;
+   MeshBuffer Viewer::surface;
+   MeshBuffer Viewer::faceSurface;
+   MeshBuffer Viewer::field;
+   MarkerBuffer Viewer::markers;
+   MarkerBuffer Viewer::highlights;
+   MeshBVH Viewer::picker;
+   MeshLOD Viewer::lod;
+   MeshChunks Viewer::surfaceChunks;
+   MeshChunks Viewer::wireframeChunks;
+   MeshChunks Viewer::fieldChunks;
+   MeshChunks Viewer::faceChunks;
+   bool Viewer::faceSurfaceCurrent = false;
+   bool Viewer::jobGeometryCurrent = false;
+   bool Viewer::closedSurface = false;
    int Viewer::windowSize[2] = { 512, 512 };
    Camera Viewer::camera;
    Shader Viewer::shader;
+   Shader Viewer::markerShader;
    bool Viewer::renderTaggedVertices = true;
    bool Viewer::renderVectorField = false;
    bool Viewer::renderWireframe = false;
    bool Viewer::render3D = false;
    bool Viewer::renderQuasiConformal = false;
+   bool Viewer::renderPotential = false;
+   SolverQueue Viewer::solver( 1 );
+   int Viewer::meshRevision = 0;
+   string Viewer::windowTitle( "DDG" );
+
+   class ProcessTask : public SolverTask
+   // runs Application::run() on a copy of the mesh, then copies the
+   // result (a flattening or a vector field) back into Viewer::mesh
+   {
+      public:
+         ProcessTask( Application& app_ )
+         : app( app_ ),
+           mesh( Viewer::mesh ),
+           revision( Viewer::meshRevision )
+         {}
+
+         virtual void run( void )
+         {
+            app.run( mesh, this );
+         }
+
+         virtual void finish( void )
+         {
+            Mesh& target( Viewer::mesh );
+
+            if( revision != Viewer::meshRevision ||
+                mesh.vertices.size() != target.vertices.size() ||
+                mesh.halfedges.size() != target.halfedges.size() ||
+                mesh.faces.size() != target.faces.size() )
+            {
+               cerr << "Mesh was modified while processing; discarding result." << endl;
+               return;
+            }
+
+            for( size_t i = 0; i < mesh.vertices.size(); i++ )
+            {
+               target.vertices[i].winding = mesh.vertices[i].winding;
+               target.vertices[i].potential = mesh.vertices[i].potential;
+            }
+
+            for( size_t i = 0; i < mesh.halfedges.size(); i++ )
+            {
+               target.halfedges[i].connection = mesh.halfedges[i].connection;
+            }
+
+            for( size_t i = 0; i < mesh.faces.size(); i++ )
+            {
+               target.faces[i].direction = mesh.faces[i].direction;
+            }
+
+            target.hledVertices = mesh.hledVertices;
+
+            // (meshes with boundary are flattened rather than given a field)
+            bool flattened = !mesh.boundaries.empty();
+            if( flattened )
+            {
+               for( size_t i = 0; i < mesh.vertices.size(); i++ )
+               {
+                  target.vertices[i].texture = mesh.vertices[i].texture;
+               }
+               Viewer::updateTexture();
+            }
+
+            if( Viewer::renderPotential || Viewer::renderQuasiConformal ) Viewer::updateColors();
+            Viewer::updateMarkers();
+            if( !flattened )
+            {
+               Viewer::renderVectorField = true;
+               Viewer::updateVectorField();
+            }
+         }
+
+      protected:
+         Application& app;
+         Mesh mesh;
+         int revision;
+   };
    
    void Viewer :: init( void )
    {
@@ -32,10 +125,226 @@ namespace DDG
       initGLUT();
       setGL();
       initGLSL();
-      updateDisplayList();
+      updateBuffers();
       glutMainLoop();
    }
    
+   RenderJob :: RenderJob( void )
+   : process( false ),
+     render3D( true ),
+     wireframe( false ),
+     vectorField( false ),
+     colors( plainColors ),
+     rotation( 1. ),
+     zoom( 1. ),
+     width( 512 ),
+     height( 512 )
+   {}
+
+   bool Viewer :: renderOffscreen( const vector<RenderJob>& jobs, int nWorkers, bool software )
+   // renders each job without a window
+   {
+      nWorkers = max( 1, min( nWorkers, (int) jobs.size() ));
+
+      // without OpenGL, the processors are shared among the workers (zero
+      // lets the rasterizer use all of them)
+      if( !software && !OffscreenContext::available() ) software = true;
+      long nProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+      int nThreads = nWorkers == 1 ? 0 : max( 1L, nProcessors / nWorkers );
+
+      if( nWorkers == 1 )
+      {
+         return renderJobs( jobs, 0, 1, software, nThreads );
+      }
+
+      // each worker process takes every nWorkers-th job
+      vector<pid_t> workers;
+      bool success = true;
+      for( int i = 0; i < nWorkers; i++ )
+      {
+         cout.flush();
+         pid_t pid = fork();
+
+         if( pid == 0 )
+         {
+            // (skip static destructors, which belong to the parent)
+            bool ok = renderJobs( jobs, i, nWorkers, software, nThreads );
+            cout.flush();
+            _exit( ok ? 0 : 1 );
+         }
+
+         if( pid < 0 )
+         {
+            cerr << "Warning: could not start worker process; rendering its jobs here." << endl;
+            success = renderJobs( jobs, i, nWorkers, software, nThreads ) && success;
+            continue;
+         }
+
+         workers.push_back( pid );
+      }
+
+      for( size_t i = 0; i < workers.size(); i++ )
+      {
+         int status;
+         if( waitpid( workers[i], &status, 0 ) < 0 ||
+             !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+         {
+            success = false;
+         }
+      }
+
+      return success;
+   }
+
+   bool Viewer :: renderJobs( const vector<RenderJob>& jobs, int first, int stride,
+                              bool software, int nThreads )
+   // renders jobs first, first+stride, first+2*stride, ...
+   {
+      // a single context, large enough for every job, is used for all jobs
+      // (so that buffers and shaders never outlive their context)
+      int width = 0, height = 0;
+      for( size_t i = first; i < jobs.size(); i += stride )
+      {
+         width  = max( width,  jobs[i].width  );
+         height = max( height, jobs[i].height );
+      }
+      if( width == 0 ) return true;
+
+      OffscreenContext context;
+      if( !software && !context.create( width, height ))
+      {
+         cerr << "Warning: falling back to software rendering." << endl;
+         software = true;
+      }
+
+      if( !software )
+      {
+         setGL();
+         initGLSL();
+      }
+
+      Rasterizer rasterizer;
+      rasterizer.setThreads( nThreads );
+
+      bool success = true;
+      for( size_t i = first; i < jobs.size(); i += stride )
+      {
+         if( renderJob( jobs[i], software ? NULL : &context, rasterizer ))
+         {
+            cout << "Rendered " << jobs[i].output << endl;
+         }
+         else
+         {
+            cerr << "Error: could not render " << jobs[i].output << endl;
+            success = false;
+         }
+      }
+
+      if( !software )
+      {
+         surface.clear();
+         faceSurface.clear();
+         field.clear();
+         markers.clear();
+         highlights.clear();
+         jobGeometryCurrent = false;
+      }
+
+      return success;
+   }
+
+   bool Viewer :: renderJob( const RenderJob& job, OffscreenContext* context, Rasterizer& rasterizer )
+   // renders a single job into the current offscreen context, or in
+   // software if there is no context
+   {
+      static string loadedInput;
+      static bool loadedProcessed = false;
+      static vector<int> loadedTags;
+
+      // consecutive jobs often show the same mesh, which is then only
+      // loaded (and processed) once
+      if( job.input != loadedInput || job.process != loadedProcessed || job.tags != loadedTags )
+      {
+         loadedInput.clear();
+         if( mesh.read( job.input ))
+         {
+            return false;
+         }
+
+         if( job.process )
+         {
+            // tags are numbered as in the file, which differs from
+            // Vertex::index if read() reordered the mesh
+            const int nV = mesh.vertices.size();
+            vector<int> vertexIndex( nV );
+            for( int i = 0; i < nV; i++ )
+            {
+               vertexIndex[ mesh.originalVertexIndex.empty() ? i : mesh.originalVertexIndex[i] ] = i;
+            }
+
+            for( size_t k = 0; k < job.tags.size(); k++ )
+            {
+               if( job.tags[k] >= nV )
+               {
+                  cerr << "Error: " << job.input << " has no vertex " << job.tags[k] << endl;
+                  return false;
+               }
+
+               int i = vertexIndex[ job.tags[k] ];
+               if( !mesh.vertices[i].tag ) mesh.toggleVertexTag( i );
+            }
+
+            Application app;
+            app.run( mesh );
+         }
+
+         loadedInput = job.input;
+         loadedProcessed = job.process;
+         loadedTags = job.tags;
+         jobGeometryCurrent = false;
+      }
+
+      render3D = job.render3D;
+      renderWireframe = job.wireframe;
+      renderVectorField = job.vectorField;
+      renderQuasiConformal = ( job.colors == RenderJob::quasiConformalColors );
+      renderPotential = ( job.colors == RenderJob::potentialColors );
+      renderTaggedVertices = false;
+
+      camera.pClick = camera.pDrag = Quaternion( 1. );
+      camera.rLast = job.rotation;
+      camera.zoom = job.zoom;
+
+      Image image;
+      if( context )
+      {
+         // the geometry and vector field depend only on the mesh, so they
+         // are uploaded once per mesh; simplified levels are never needed,
+         // since the camera does not move
+         if( !jobGeometryCurrent )
+         {
+            updateGeometry( false );
+            updateVectorField();
+            jobGeometryCurrent = true;
+         }
+         updateColors();
+         updateMarkers();
+
+         glViewport( 0, 0, job.width, job.height );
+         drawFrame();
+         context->read( image );
+      }
+      else
+      {
+         rasterizer.resize( job.width, job.height );
+         drawFrame( rasterizer );
+         rasterizer.read( image );
+      }
+      image.write( job.output.c_str() );
+
+      return true;
+   }
+   
    void Viewer :: initGLUT( void )
    {
       int argc = 0;
@@ -61,6 +370,7 @@ namespace DDG
       glutAddMenuEntry( "[f] Wireframe",  menuWireframe    );
       glutAddMenuEntry( "[s] Switch 2D/3D",  menuRender3D  );
       glutAddMenuEntry( "[q] Quasi Conformal Error",  menuQuasiConformal );
+      glutAddMenuEntry( "[p] Potential", menuPotential );
       glutAddMenuEntry( "[t] Tagged Vertices", menuTaggedVertices );
       glutAddMenuEntry( "[v] Vector Field", menuVectorField );
       glutAddMenuEntry( "([) Increase Winding Number",  menuIncWinding );
@@ -71,6 +381,7 @@ namespace DDG
       int mainMenu = glutCreateMenu( Viewer::menu );
       glutSetMenu( mainMenu );
       glutAddMenuEntry( "[space] Process Mesh", menuProcess    );
+      glutAddMenuEntry( "[x] Cancel Processing", menuCancel    );
       glutAddMenuEntry( "[r] Reset Mesh",       menuResetMesh  );
       glutAddMenuEntry( "[w] Write Mesh",       menuWriteMesh  );
       glutAddMenuEntry( "[\\] Screenshot",      menuScreenshot );
@@ -83,6 +394,8 @@ namespace DDG
    {
       shader.loadVertex( "shaders/vertex.glsl" );
       shader.loadFragment( "shaders/fragment.glsl" );
+      markerShader.loadVertex( "shaders/marker_vertex.glsl" );
+      markerShader.loadFragment( "shaders/marker_fragment.glsl" );
    }
 
    void Viewer :: menu( int value )
@@ -92,6 +405,9 @@ namespace DDG
          case( menuProcess ):
             mProcess();
             break;
+         case( menuCancel ):
+            mCancel();
+            break;
          case( menuResetMesh ):
             mResetMesh();
             break;
@@ -116,6 +432,9 @@ namespace DDG
          case( menuQuasiConformal ):
             mQuasiConformal();
             break;
+         case( menuPotential ):
+            mPotential();
+            break;
          case( menuVectorField ):
             mVectorField();
             break;
@@ -152,6 +471,9 @@ namespace DDG
          case 'q':
             mQuasiConformal();
             break;
+         case 'p':
+            mPotential();
+            break;
          case 's':
             mRender3D();
             break;
@@ -182,6 +504,9 @@ namespace DDG
          case ' ':
             mProcess();
             break;
+         case 'x':
+            mCancel();
+            break;
          case 27:
             mExit();
             break;
@@ -225,10 +550,31 @@ namespace DDG
    
    void Viewer :: idle( void )
    {
+      solver.poll();
+      updateWindowTitle();
       camera.idle();
       glutPostRedisplay();
    }
    
+   void Viewer :: updateWindowTitle( void )
+   {
+      stringstream title;
+      title << "DDG";
+
+      double fraction;
+      string stage;
+      if( solver.status( fraction, stage ))
+      {
+         title << " -- " << stage << " (" << (int)( 100.*fraction ) << "%)";
+      }
+
+      if( title.str() != windowTitle )
+      {
+         windowTitle = title.str();
+         glutSetWindowTitle( windowTitle.c_str() );
+      }
+   }
+   
    void Viewer :: storeViewerState( void )
    {
       ofstream out( ".viewer_state.txt" );
@@ -259,16 +605,29 @@ namespace DDG
 
    void Viewer :: mProcess( void )
    {
-      Application app;
-      app.run(mesh);
-      renderVectorField = true;
-      updateDisplayList();
+      // keep the application (and its solver state) across runs; since only
+      // one task runs at a time, it is never used by two threads at once
+      static Application app;
+
+      if( solver.busy() )
+      {
+         cerr << "Mesh is still being processed (press 'x' to cancel)." << endl;
+         return;
+      }
+
+      solver.submit( new ProcessTask( app ));
+   }
+
+   void Viewer :: mCancel( void )
+   {
+      solver.cancelAll();
    }
    
    void Viewer :: mResetMesh( void )
    {
+      meshRevision++;
       mesh.reload();
-      updateDisplayList();
+      updateBuffers();
    }
    
    void Viewer :: mWriteMesh( void )
@@ -279,37 +638,43 @@ namespace DDG
    void Viewer :: mExit( void )
    {
       //storeViewerState();
+      solver.shutdown();
       exit( 0 );
    }
    
    void Viewer :: mWireframe( void )
    {
       renderWireframe = !renderWireframe;
-      updateDisplayList();
    }
 
    void Viewer :: mRender3D( void )
    {
       render3D = !render3D;
-      updateDisplayList();
+      updateMarkers();
    }
    
    void Viewer :: mVectorField( void )
    {
       renderVectorField = ! renderVectorField;
-      updateDisplayList();
    }
 
    void Viewer :: mTaggedVertices( void )
    {
       renderTaggedVertices = ! renderTaggedVertices;
-      updateDisplayList();
    }
 
    void Viewer :: mQuasiConformal( void )
    {
       renderQuasiConformal = !renderQuasiConformal;
-      updateDisplayList();
+      renderPotential = false;
+      updateColors();
+   }
+
+   void Viewer :: mPotential( void )
+   {
+      renderPotential = !renderPotential;
+      renderQuasiConformal = false;
+      updateColors();
    }
 
    void Viewer :: mZoomIn( void )
@@ -345,6 +710,15 @@ namespace DDG
       
    void Viewer :: display( void )
    {
+      drawFrame();
+      glutSwapBuffers();
+   }
+
+   void Viewer :: drawFrame( void )
+   {
+      // bring markers up to date with any edits since the last frame
+      updateChangedMarkers();
+
       glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
       shader.enable();
 
@@ -380,280 +754,460 @@ namespace DDG
       glUniform3f( uniformLight, light[1], light[2], light[3] );
       
       camera.setView();
-      callDisplayList();
+      drawSurface();
       shader.disable();
-      glutSwapBuffers();
    }
-   
-   void Viewer :: updateDisplayList( void )
+
+   static void perspectiveMatrix( double fovy, double aspect, double zNear, double zFar, double M[16] )
+   // gets the matrix applied by gluPerspective() (in column-major order)
+   {
+      const double PI = 3.141592653589793238462;
+      double f = 1. / tan( .5 * fovy * PI / 180. );
+
+      for( int i = 0; i < 16; i++ ) M[i] = 0.;
+      M[ 0] = f / aspect;
+      M[ 5] = f;
+      M[10] = ( zFar + zNear ) / ( zNear - zFar );
+      M[11] = -1.;
+      M[14] = 2. * zFar * zNear / ( zNear - zFar );
+   }
+
+   static void lookAtMatrix( const Vector& eye, const Vector& center, const Vector& up, double M[16] )
+   // gets the matrix applied by gluLookAt() (in column-major order)
    {
-      if( surfaceDL )
+      Vector f = ( center - eye ).unit();
+      Vector s = cross( f, up ).unit();
+      Vector u = cross( s, f );
+
+      for( int k = 0; k < 3; k++ )
       {
-         glDeleteLists( surfaceDL, 1 );
-         surfaceDL = 0;
+         M[ 4*k+0 ] =  s[k];
+         M[ 4*k+1 ] =  u[k];
+         M[ 4*k+2 ] = -f[k];
+         M[ 4*k+3 ] = 0.;
       }
-      
-      surfaceDL = glGenLists( 1 );
-      glNewList( surfaceDL, GL_COMPILE );
-      setMeshMaterial();
-      drawScene();
-      glEndList();
+      M[12] = -dot( s, eye );
+      M[13] = -dot( u, eye );
+      M[14] =  dot( f, eye );
+      M[15] = 1.;
    }
-   
-   void Viewer :: setGL( void )
+
+   void Viewer :: drawFrame( Rasterizer& rasterizer )
    {
-      glClearColor( .5, .5, .5, 1. );
-      setLighting();
+      // same camera and lights as drawFrame()
+      double aspect = (double) rasterizer.width() / (double) rasterizer.height();
+      const double fovy = 50.;
+      const double clipNear = .01;
+      const double clipFar = 1000.;
+      double projection[16];
+      perspectiveMatrix( fovy, aspect, clipNear, clipFar, projection );
+
+      Quaternion    eye = Vector( 0., 0., -2.5*camera.zoom );
+      Quaternion center = Vector( 0., 0., 0. );
+      Quaternion     up = Vector( 0., 1., 0. );
+      double lookAt[16], rotation[16], modelview[16];
+      lookAtMatrix( eye.im(), center.im(), up.im(), lookAt );
+      camera.viewMatrix( rotation );
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         modelview[ i + 4*j ] = 0.;
+         for( int k = 0; k < 4; k++ )
+         {
+            modelview[ i + 4*j ] += lookAt[ i + 4*k ] * rotation[ k + 4*j ];
+         }
+      }
+      rasterizer.setView( modelview, projection );
+
+      Quaternion r = camera.currentRotation();
+      eye = r.conj() * eye * r;
+      Quaternion light = Vector( -1., 1., -2. );
+      light = r.conj() * light * r;
+      rasterizer.setLighting( eye.im(), light.im() );
+
+      // same contents as drawScene()
+      vector<GLfloat> positions, normals, texture, colors;
+      vector<GLuint> triangles, lines, points;
+      buildGeometry( positions, normals, texture, triangles, lines, points );
+
+      // in quasi conformal mode, each face is drawn from vertices of its own
+      // (edges and points still use the shared vertices)
+      vector<GLfloat> facePositions, faceNormals, faceTexture;
+      vector<GLuint> faceTriangles;
+      if( renderQuasiConformal )
+      {
+         buildFaceGeometry( facePositions, faceNormals, faceTexture, colors, faceTriangles );
+      }
+      else
+      {
+         buildColors( colors );
+      }
+      vector<GLfloat>& triPositions( renderQuasiConformal ? facePositions : positions );
+      vector<GLfloat>& triNormals( renderQuasiConformal ? faceNormals : normals );
+      vector<GLfloat>& triTexture( renderQuasiConformal ? faceTexture : texture );
+      vector<GLuint>& triIndices( renderQuasiConformal ? faceTriangles : triangles );
+
+      rasterizer.clear( Vector( .5, .5, .5 ));
+      rasterizer.setDepthOffset( 1., 1. );
+      if( render3D )
+      {
+         rasterizer.drawTriangles( triPositions, triNormals, colors, 3, triIndices );
+      }
+      else
+      {
+         // the flattened mesh lies in the plane z = 0
+         for( size_t i = 0; i < triNormals.size(); i++ )
+         {
+            triNormals[i] = ( i%3 == 2 ) ? 1. : 0.;
+         }
+         rasterizer.drawTriangles( triTexture, triNormals, colors, 3, triIndices );
+      }
+
+      if( renderVectorField )
+      {
+         vector<GLfloat> fieldPositions, fieldColors;
+         vector<GLuint> fieldLines;
+         buildVectorField( fieldPositions, fieldColors, fieldLines );
+         rasterizer.drawLines( fieldPositions, fieldColors, 4, fieldLines, 2. );
+      }
+
+      if( renderWireframe )
+      {
+         vector<GLfloat> edgeColors( 4*mesh.vertices.size(), 0. );
+         for( size_t i = 3; i < edgeColors.size(); i += 4 ) edgeColors[i] = .5;
+         rasterizer.drawLines( render3D ? positions : texture, edgeColors, 4, lines, 1. );
+      }
    }
    
-   void Viewer :: setLighting( void )
+   void Viewer :: updateBuffers( void )
    {
-      GLfloat position[4] = { 20., 30., 40., 0. };
-      glLightfv( GL_LIGHT0, GL_POSITION, position );
-      glEnable( GL_LIGHT0 );
-      glEnable( GL_NORMALIZE );
+      updateGeometry( true );
+      updateColors();
+      updateVectorField();
+      updateMarkers();
    }
-   
-   void Viewer :: setMeshMaterial( void )
-   {
-      GLfloat  diffuse[4] = { .8, .5, .3, 1. };
-      GLfloat specular[4] = { .3, .3, .3, 1. };
-      GLfloat  ambient[4] = { .2, .2, .5, 1. };
-      
-      glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE,   diffuse  );
-      glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR,  specular );
-      glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT,   ambient  );
-      glMaterialf ( GL_FRONT_AND_BACK, GL_SHININESS, 16.      );
-   }
-   
-   void Viewer :: callDisplayList( void )
+
+   void Viewer :: updateGeometry( bool buildLevels )
    {
-      glPushAttrib( GL_ALL_ATTRIB_BITS );
-      glEnable( GL_DEPTH_TEST );
-      glEnable( GL_LIGHTING );
-      glCallList( surfaceDL );
-      glPopAttrib();
+      faceSurfaceCurrent = false;
+
+      vector<GLfloat> positions, normals, texture;
+      vector<GLuint> triangles, lines, points;
+      buildGeometry( positions, normals, texture, triangles, lines, points );
+
+      // (reorders triangles and lines so that each chunk is contiguous)
+      surfaceChunks.build( positions, triangles, 3 );
+      wireframeChunks.build( positions, lines, 2 );
+
+      // back faces are hidden if the mesh has no boundary and encloses a
+      // positive volume (boundary loops are stored in mesh.boundaries
+      // rather than among the faces)
+      closedSurface = mesh.boundaries.empty();
+      double volume = 0.;
+      for( size_t i = 0; i < triangles.size(); i += 3 )
+      {
+         const GLfloat* x0 = &positions[ 3*triangles[i+0] ];
+         const GLfloat* x1 = &positions[ 3*triangles[i+1] ];
+         const GLfloat* x2 = &positions[ 3*triangles[i+2] ];
+         volume += dot( Vector( x0[0], x0[1], x0[2] ),
+                        cross( Vector( x1[0], x1[1], x1[2] ),
+                               Vector( x2[0], x2[1], x2[2] )));
+      }
+      if( volume <= 0. ) closedSurface = false;
+
+      surface.setStream( MeshBuffer::positionStream, positions, 3 );
+      surface.setStream( MeshBuffer::normalStream, normals, 3 );
+      surface.setStream( MeshBuffer::textureStream, texture, 3 );
+      surface.setIndices( MeshBuffer::triangles, triangles );
+      surface.setIndices( MeshBuffer::lines, lines );
+      surface.setIndices( MeshBuffer::points, points );
+
+      // small meshes are cheap enough to draw in full at all times
+      const size_t minLODTriangles = 100000;
+      if( buildLevels && triangles.size() / 3 > minLODTriangles )
+      {
+         lod.build( positions, triangles );
+      }
+      else
+      {
+         lod.clear();
+      }
+
+      surface.setLevels( MeshBuffer::triangles, lod.levels() );
+      surface.setLevels( MeshBuffer::lines, lod.levels() );
+      for( int level = 1; level < lod.levels(); level++ )
+      {
+         surface.setIndices( MeshBuffer::triangles, lod.triangles( level ), level );
+         surface.setIndices( MeshBuffer::lines, lod.lines( level ), level );
+      }
    }
-   
-   void Viewer :: drawScene( void )
+
+   int Viewer :: lodLevel( void )
    {
-      glPushAttrib( GL_ALL_ATTRIB_BITS );
+      // (levels are simplified in 3D, so the flattened mesh is always drawn
+      // in full)
+      if( !render3D || !camera.moving() ) return 0;
 
-      glEnable( GL_POLYGON_OFFSET_FILL );
-      glPolygonOffset( 1., 1. );
-      drawTriangles();
-      glDisable( GL_POLYGON_OFFSET_FILL );
+      // the mesh fits inside the unit ball, so no point of it is closer to
+      // the eye than the distance to the center minus one
+      GLint viewport[4];
+      glGetIntegerv( GL_VIEWPORT, viewport );
+      const double PI = 3.141592653589793238462;
+      const double fovy = 50.;
+      double distance = max( .01, fabs( 2.5*camera.zoom ) - 1. );
+      double pixelsPerUnit = viewport[3] / ( 2. * tan( .5 * fovy * PI / 180. ) * distance );
 
-      if( renderVectorField ) drawVectorField();
-      
-      if( renderWireframe ) drawWireframe();
-      
-      drawIsolatedVertices();
-      
-      if( renderTaggedVertices ) drawSelectedVertices();
-      
-      glPopAttrib();
+      // allow an error of about one pixel
+      const double tolerance = 1.;
+      return lod.select( tolerance / pixelsPerUnit );
    }
-   
-   void Viewer :: drawPolygons( void )
-   {
-      /*if( not renderQuasiConformal )
-      {
-         glColor3d( 1., .5, .25 );
-      }*/
 
-      double plainColor[3] = { 1., .5, .25 };
-      double normal2D[3] = { 0., 0., 1. };
+   void Viewer :: visibleChunks( const MeshChunks& chunks, bool cullBackfaces,
+                                 vector<int>& first, vector<int>& count )
+   {
+      GLdouble modelview[16], projection[16];
+      glGetDoublev( GL_MODELVIEW_MATRIX, modelview );
+      glGetDoublev( GL_PROJECTION_MATRIX, projection );
 
-      glEnableClientState(GL_VERTEX_ARRAY);
-      glEnableClientState(GL_NORMAL_ARRAY);
-      glEnableClientState(GL_COLOR_ARRAY);
+      double transform[16];
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         transform[4*j+i] = 0.;
+         for( int k = 0; k < 4; k++ )
+         {
+            transform[4*j+i] += projection[4*k+i] * modelview[4*j+k];
+         }
+      }
 
-      for( FaceCIter f  = mesh.faces.begin();
-          f != mesh.faces.end();
-          f ++ )
+      // the modelview matrix is a rigid motion, so the eye sits at -R^T t
+      Vector eye;
+      for( int i = 0; i < 3; i++ )
       {
-         if( f->isBoundary() ) continue;
-      
-         int V = 0;
-         HalfEdgeCIter he = f->he;
-         do { V++; he = he->next; } while( he != f->he );
+         eye[i] = -( modelview[4*i+0]*modelview[12] +
+                     modelview[4*i+1]*modelview[13] +
+                     modelview[4*i+2]*modelview[14] );
+      }
 
-         GLfloat * positions = new GLfloat[3*V];
-         GLfloat * normals   = new GLfloat[3*V];
-         GLfloat * colors    = new GLfloat[3*V];
+      // from inside a closed surface only its back faces can be seen; since
+      // the mesh fits inside the unit ball, the eye is outside beyond that
+      if( eye.norm() <= 1. ) cullBackfaces = false;
 
-         double qcValue = faceQCDistortion( f );
-         Vector qcColorVec = qcColor( qcValue );
+      chunks.visible( transform, eye, cullBackfaces, first, count );
+   }
 
-         int offset = 0;
-         he = f->he;
-         do
-         {
-            const double * ptr;
+   void Viewer :: buildGeometry( vector<GLfloat>& positions,
+                                 vector<GLfloat>& normals,
+                                 vector<GLfloat>& texture,
+                                 vector<GLuint>& triangles,
+                                 vector<GLuint>& lines,
+                                 vector<GLuint>& points )
+   {
+      const int V = mesh.vertices.size();
 
-            ptr = renderQuasiConformal ? &qcColorVec[0] : plainColor;
-            std::copy(ptr, ptr + 3, colors + offset);
+      mesh.updateNormals();
 
-            ptr = render3D ? &he->vertex->normal()[0] : normal2D;
-            std::copy(ptr, ptr + 3, normals + offset);
+      positions.resize( 3*V );
+      normals.resize( 3*V );
+      texture.resize( 3*V );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
+      {
+         Vector N = v->isIsolated() ? Vector( 0., 0., 1. ) : mesh.normal( v );
 
-            ptr = render3D ? &he->vertex->position[0] : &he->vertex->texture[0];
-            std::copy(ptr, ptr + 3, positions + offset);
-            
-            offset += 3;
-            he = he->next;
+         for( int k = 0; k < 3; k++ )
+         {
+            positions[ 3*v->index+k ] = v->position[k];
+              normals[ 3*v->index+k ] = N[k];
+              texture[ 3*v->index+k ] = v->texture[k];
          }
-         while( he != f->he );
-
-         glVertexPointer(  3, GL_FLOAT, 0, positions  );
-         glNormalPointer(     GL_FLOAT, 0, normals    );
-         glColorPointer (  3, GL_FLOAT, 0, colors     );
-         glDrawArrays(GL_POLYGON, 0, V);
+      }
 
-         delete[] positions;
-         delete[] normals;
-         delete[] colors;
+      triangles.clear();
+      triangles.reserve( 3*mesh.faces.size() );
+      for( FaceCIter f = mesh.faces.begin(); f != mesh.faces.end(); f++ )
+      {
+         if( f->isBoundary() ) continue;
 
-         /*if( renderQuasiConformal )
-         {
-            double value = faceQCDistortion( f );
-            Vector color = qcColor( value );
-            glColor3dv( &color[0] );
-         }   
-         
-         glBegin( GL_POLYGON );
-         if( render3D and renderWireframe )
+         // split polygons into triangle fans around the first vertex
+         HalfEdgeCIter he = f->he->next;
+         while( he->next != f->he )
          {
-            Vector N = f->normal();
-            glNormal3dv( &N[0] );
-         }
-         
-         HalfEdgeCIter he = f->he;
-         do
-         {
-            if( render3D and (not renderWireframe) )
-            {
-               Vector N = he->vertex->normal();
-               glNormal3dv( &N[0] );
-            }
-
-            if( not render3D )
-            {
-               glNormal3d(0.,0.,1.);
-            }
-            
-            if( render3D )
-            {
-               glVertex3dv( &he->vertex->position[0] );               
-            }
-            else
-            {
-               glVertex3dv( &he->vertex->texture[0] );
-            }
-            
+            triangles.push_back( f->he->vertex->index );
+            triangles.push_back( he->vertex->index );
+            triangles.push_back( he->next->vertex->index );
             he = he->next;
          }
-         while( he != f->he );
-         glEnd();*/
       }
 
-      glDisableClientState(GL_COLOR_ARRAY);
-      glDisableClientState(GL_NORMAL_ARRAY);
-      glDisableClientState(GL_VERTEX_ARRAY);
-   }
-   
-   void Viewer::drawTriangles( void )
-   {
-      int F = 0;
-      for( FaceCIter f  = mesh.faces.begin(); f != mesh.faces.end(); f ++ )
+      lines.clear();
+      lines.reserve( 2*mesh.edges.size() );
+      for( EdgeCIter e = mesh.edges.begin(); e != mesh.edges.end(); e++ )
       {
-         if( not f->isBoundary() ) F++;
+         lines.push_back( e->he->vertex->index );
+         lines.push_back( e->he->flip->vertex->index );
       }
 
-      GLfloat * positions = new GLfloat[3*3*F];
-      GLfloat * normals   = new GLfloat[3*3*F];
-      GLfloat * colors    = new GLfloat[3*3*F];
+      points.clear();
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
+      {
+         if( v->isIsolated() ) points.push_back( v->index );
+      }
+   }
 
-      double plainColor[3] = { 1., .5, .25 };
-      double normal2D[3] = { 0., 0., 1. };
+   void Viewer :: updateColors( void )
+   {
+      if( renderQuasiConformal )
+      {
+         if( !faceSurfaceCurrent ) updateFaceSurface();
+         return;
+      }
 
-      glEnableClientState(GL_VERTEX_ARRAY);
-      glEnableClientState(GL_NORMAL_ARRAY);
-      glEnableClientState(GL_COLOR_ARRAY);
+      vector<GLfloat> colors;
+      buildColors( colors );
 
-      int offset = 0;
+      surface.setStream( MeshBuffer::colorStream, colors, 3 );
+   }
 
-      for( FaceCIter f  = mesh.faces.begin();
-          f != mesh.faces.end();
-          f ++ )
+   void Viewer :: updateTexture( void )
+   {
+      vector<GLfloat> texture( 3*mesh.vertices.size() );
+      for( VertexCIter v = mesh.vertices.begin(); v != mesh.vertices.end(); v++ )
       {
-         if( f->isBoundary() ) continue;
-
-         double qcValue = faceQCDistortion( f );
-         Vector qcColorVec = qcColor( qcValue );
-
-         HalfEdgeIter he = f->he;
-         do
+         for( int k = 0; k < 3; k++ )
          {
-            const double * ptr;
+            texture[ 3*v->index+k ] = v->texture[k];
+         }
+      }
+      surface.setStream( MeshBuffer::textureStream, texture, 3 );
 
-            ptr = renderQuasiConformal ? &qcColorVec[0] : plainColor;
-            std::copy(ptr, ptr + 3, colors + offset);
+      // (texture coordinates are not versioned, so the picker and the
+      // separate face vertices must be told that they changed)
+      picker.invalidate();
+      faceSurfaceCurrent = false;
+   }
 
-            ptr = render3D ? &he->vertex->normal()[0] : normal2D;
-            std::copy(ptr, ptr + 3, normals + offset);
+   void Viewer :: updateFaceSurface( void )
+   {
+      vector<GLfloat> positions, normals, texture, colors;
+      vector<GLuint> triangles;
+      buildFaceGeometry( positions, normals, texture, colors, triangles );
 
-            ptr = render3D ? &he->vertex->position[0] : &he->vertex->texture[0];
-            std::copy(ptr, ptr + 3, positions + offset);
-            
-            offset += 3;
-            he = he->next;
-         }
-         while( he != f->he );
+      // (reorders triangles so that each chunk is contiguous)
+      faceChunks.build( positions, triangles, 3 );
 
-      }
+      faceSurface.setStream( MeshBuffer::positionStream, positions, 3 );
+      faceSurface.setStream( MeshBuffer::normalStream, normals, 3 );
+      faceSurface.setStream( MeshBuffer::textureStream, texture, 3 );
+      faceSurface.setStream( MeshBuffer::colorStream, colors, 3 );
+      faceSurface.setIndices( MeshBuffer::triangles, triangles );
 
-      glVertexPointer(  3, GL_FLOAT, 0, positions  );
-      glNormalPointer(     GL_FLOAT, 0, normals    );
-      glColorPointer (  3, GL_FLOAT, 0, colors     );
+      faceSurfaceCurrent = true;
+   }
 
-      glDrawArrays(GL_TRIANGLES, 0, 3*F);
+   void Viewer :: buildColors( vector<GLfloat>& colors )
+   {
+      const int V = mesh.vertices.size();
+      colors.resize( 3*V );
 
-      glDisableClientState(GL_COLOR_ARRAY);
-      glDisableClientState(GL_NORMAL_ARRAY);
-      glDisableClientState(GL_VERTEX_ARRAY);
+      // (quasi conformal distortion is constant on each face, so it is drawn
+      // from separate vertices -- see buildFaceGeometry())
+      if( renderPotential )
+      {
+         // potentials are only defined up to a constant, so the color map
+         // spans the range of values on the mesh
+         double pMin = 0., pMax = 0.;
+         for( int i = 0; i < V; i++ )
+         {
+            double p = mesh.vertices[i].potential;
+            if( i == 0 || p < pMin ) pMin = p;
+            if( i == 0 || p > pMax ) pMax = p;
+         }
+         double range = pMax > pMin ? pMax - pMin : 1.;
 
-      delete[] positions;
-      delete[] normals;
-      delete[] colors;
+         for( int i = 0; i < V; i++ )
+         {
+            Vector c = potentialColor( ( mesh.vertices[i].potential - pMin ) / range );
+            for( int k = 0; k < 3; k++ ) colors[ 3*i+k ] = c[k];
+         }
+      }
+      else
+      {
+         const GLfloat plainColor[3] = { 1., .5, .25 };
+         for( int i = 0; i < V; i++ )
+         {
+            for( int k = 0; k < 3; k++ ) colors[ 3*i+k ] = plainColor[k];
+         }
+      }
    }
 
-   void Viewer :: drawVectorField( void )
+   void Viewer :: buildFaceGeometry( vector<GLfloat>& positions,
+                                     vector<GLfloat>& normals,
+                                     vector<GLfloat>& texture,
+                                     vector<GLfloat>& colors,
+                                     vector<GLuint>& triangles )
    {
-      int F = 0;
-      for( FaceCIter f  = mesh.faces.begin(); f != mesh.faces.end(); f ++ )
+      // each triangle gets three vertices of its own, all colored by the
+      // distortion of the face it belongs to
+      mesh.updateNormals();
+
+      positions.clear();
+      normals.clear();
+      texture.clear();
+      colors.clear();
+      triangles.clear();
+      for( FaceCIter f = mesh.faces.begin(); f != mesh.faces.end(); f++ )
       {
-         if( not f->isBoundary() ) F++;
-      }
+         if( f->isBoundary() ) continue;
 
-      shader.disable();
-      glPushAttrib( GL_ALL_ATTRIB_BITS );
-      glDisable( GL_LIGHTING );
-      glEnable( GL_BLEND );
-      glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+         Vector c = qcColor( faceQCDistortion( f ));
+
+         // split polygons into triangle fans around the first vertex
+         HalfEdgeCIter he = f->he->next;
+         while( he->next != f->he )
+         {
+            VertexCIter corners[3] = { f->he->vertex, he->vertex, he->next->vertex };
+            for( int i = 0; i < 3; i++ )
+            {
+               Vector N = mesh.normal( corners[i] );
+               for( int k = 0; k < 3; k++ )
+               {
+                  positions.push_back( corners[i]->position[k] );
+                    normals.push_back( N[k] );
+                    texture.push_back( corners[i]->texture[k] );
+                     colors.push_back( c[k] );
+               }
+               triangles.push_back( triangles.size() );
+            }
+            he = he->next;
+         }
+      }
+   }
 
-      glEnableClientState(GL_VERTEX_ARRAY);
-      GLfloat * positions = new GLfloat[3*2*F];
-      glEnableClientState(GL_COLOR_ARRAY);
-      GLfloat * colors    = new GLfloat[4*2*F];
+   void Viewer :: updateVectorField( void )
+   {
+      vector<GLfloat> positions, colors;
+      vector<GLuint> lines;
+      buildVectorField( positions, colors, lines );
 
-      GLfloat color[8] = { 1.0, 1.0, 1.0, 0.0, \
-                           0.0, 0.0, 0.0, 1.0 };
+      fieldChunks.build( positions, lines, 2 );
 
-      glLineWidth( 2. );
+      field.setStream( MeshBuffer::positionStream, positions, 3 );
+      field.setStream( MeshBuffer::colorStream, colors, 4 );
+      field.setIndices( MeshBuffer::lines, lines );
+   }
 
-      int offset = 0;
+   void Viewer :: buildVectorField( vector<GLfloat>& positions,
+                                    vector<GLfloat>& colors,
+                                    vector<GLuint>& lines )
+   {
+      // each face gets a short line segment through its incenter,
+      // fading from transparent white to opaque black
+      const GLfloat color[8] = { 1.0, 1.0, 1.0, 0.0,
+                                 0.0, 0.0, 0.0, 1.0 };
+
+      positions.clear();
+      colors.clear();
+      lines.clear();
       for( FaceCIter f  = mesh.faces.begin(); f != mesh.faces.end(); f ++ )
       {
          if( f->isBoundary() ) continue;
@@ -669,27 +1223,119 @@ namespace DDG
          double l2 = (v0-v1).norm();
 
          Vector center = ( l0*v0 + l1*v1 + l2*v2 ) / ( l0 + l1 + l2 );
-         double radius = 2. * f->area() / ( l0 + l1 + l2 );
+         double radius = 2. * mesh.area( f ) / ( l0 + l1 + l2 );
 
          Vector p1 = center - 0.8 * radius * f->direction;
-         std::copy(&p1[0],    &p1[0] + 3, positions + 3 * offset);
-         std::copy(color,     color + 4,  colors +    4 * offset);
-         ++ offset;
-
          Vector p2 = center + 0.8 * radius * f->direction;
-         std::copy(&p2[0],    &p2[0] + 3, positions + 3 * offset);
-         std::copy(color + 4, color + 8,  colors +    4 * offset);
-         ++ offset;
+
+         lines.push_back( positions.size()/3 );
+         positions.insert( positions.end(), &p1[0], &p1[0] + 3 );
+         colors.insert( colors.end(), color, color + 4 );
+
+         lines.push_back( positions.size()/3 );
+         positions.insert( positions.end(), &p2[0], &p2[0] + 3 );
+         colors.insert( colors.end(), color + 4, color + 8 );
       }
+   }
+   
+   void Viewer :: setGL( void )
+   {
+      glClearColor( .5, .5, .5, 1. );
+      setLighting();
+   }
+   
+   void Viewer :: setLighting( void )
+   {
+      GLfloat position[4] = { 20., 30., 40., 0. };
+      glLightfv( GL_LIGHT0, GL_POSITION, position );
+      glEnable( GL_LIGHT0 );
+      glEnable( GL_NORMALIZE );
+   }
+   
+   void Viewer :: setMeshMaterial( void )
+   {
+      GLfloat  diffuse[4] = { .8, .5, .3, 1. };
+      GLfloat specular[4] = { .3, .3, .3, 1. };
+      GLfloat  ambient[4] = { .2, .2, .5, 1. };
+      
+      glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE,   diffuse  );
+      glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR,  specular );
+      glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT,   ambient  );
+      glMaterialf ( GL_FRONT_AND_BACK, GL_SHININESS, 16.      );
+   }
+   
+   void Viewer :: drawSurface( void )
+   {
+      glPushAttrib( GL_ALL_ATTRIB_BITS );
+      glEnable( GL_DEPTH_TEST );
+      glEnable( GL_LIGHTING );
+      setMeshMaterial();
+      drawScene();
+      glPopAttrib();
+   }
+   
+   void Viewer :: drawScene( void )
+   {
+      glPushAttrib( GL_ALL_ATTRIB_BITS );
 
-      glVertexPointer(  3, GL_FLOAT, 0, positions  );
-      glColorPointer (  4, GL_FLOAT, 0, colors     );
-      glDrawArrays(GL_LINES, 0, 2*F);
+      glEnable( GL_POLYGON_OFFSET_FILL );
+      glPolygonOffset( 1., 1. );
+      drawTriangles();
+      glDisable( GL_POLYGON_OFFSET_FILL );
 
-      delete[] positions;
-      glDisableClientState(GL_VERTEX_ARRAY);
-      delete[] colors;
-      glDisableClientState(GL_COLOR_ARRAY);
+      if( renderVectorField ) drawVectorField();
+      
+      if( renderWireframe ) drawWireframe();
+      
+      drawIsolatedVertices();
+      
+      if( renderTaggedVertices ) drawSelectedVertices();
+      
+      glPopAttrib();
+   }
+   
+   void Viewer::drawTriangles( void )
+   {
+      // in quasi conformal mode each face has its own color, and is drawn
+      // from separate vertices (always in full, since the triangles of the
+      // simplified levels are not faces of the mesh)
+      const MeshBuffer& buffer( renderQuasiConformal ? faceSurface : surface );
+      const MeshChunks& chunks( renderQuasiConformal ? faceChunks : surfaceChunks );
+
+      if( render3D )
+      {
+         int level = renderQuasiConformal ? 0 : lodLevel();
+         if( level == 0 )
+         {
+            vector<int> first, count;
+            visibleChunks( chunks, closedSurface, first, count );
+            buffer.draw( MeshBuffer::triangles, first, count, MeshBuffer::positionStream );
+         }
+         else
+         {
+            buffer.draw( MeshBuffer::triangles, MeshBuffer::positionStream, true, true, 1, level );
+         }
+      }
+      else
+      {
+         // the flattened mesh lies in the plane z = 0
+         glNormal3d( 0., 0., 1. );
+         buffer.draw( MeshBuffer::triangles, MeshBuffer::textureStream, false );
+      }
+   }
+
+   void Viewer :: drawVectorField( void )
+   {
+      shader.disable();
+      glPushAttrib( GL_ALL_ATTRIB_BITS );
+      glDisable( GL_LIGHTING );
+      glEnable( GL_BLEND );
+      glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+      glLineWidth( 2. );
+
+      vector<int> first, count;
+      visibleChunks( fieldChunks, false, first, count );
+      field.draw( MeshBuffer::lines, first, count, MeshBuffer::positionStream, false, true );
 
       glPopAttrib();
    }
@@ -704,53 +1350,21 @@ namespace DDG
       glEnable( GL_BLEND );
       glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 
-      const int E = mesh.edges.size();
-
-      GLfloat * positions = new GLfloat[3*2*E];
-
-      glEnableClientState(GL_VERTEX_ARRAY);
-
-      int offset = 0;
-      for( EdgeCIter e  = mesh.edges.begin();
-          e != mesh.edges.end();
-          e ++ )
+      int level = lodLevel();
+      if( render3D && level == 0 )
       {
-         const double * ptr;
-
-         ptr = &e->he->vertex->position[0];
-         std::copy(ptr, ptr + 3, positions + offset);
-         offset += 3;
-
-         ptr = &e->he->flip->vertex->position[0];
-         std::copy(ptr, ptr + 3, positions + offset);
-         offset += 3;
+         // (edges on the silhouette border a back face, so only the
+         // frustum is used for culling)
+         vector<int> first, count;
+         visibleChunks( wireframeChunks, false, first, count );
+         surface.draw( MeshBuffer::lines, first, count, MeshBuffer::positionStream, false, false );
       }
-
-      glVertexPointer(3, GL_FLOAT, 0, positions);
-      glDrawArrays(GL_LINES, 0, 2*E);
-
-      glDisableClientState(GL_VERTEX_ARRAY);
-
-      delete[] positions;
-      
-      /*glBegin( GL_LINES );
-      for( EdgeCIter e  = mesh.edges.begin();
-          e != mesh.edges.end();
-          e ++ )
+      else
       {
-            if( render3D )
-            {
-               glVertex3dv( &e->he->vertex->position[0] );
-               glVertex3dv( &e->he->flip->vertex->position[0] );
-            }
-            else
-            {
-               glVertex3dv( &e->he->vertex->texture[0] );
-               glVertex3dv( &e->he->flip->vertex->texture[0] );
-            }
-         
+         surface.draw( MeshBuffer::lines,
+                       render3D ? MeshBuffer::positionStream : MeshBuffer::textureStream,
+                       false, false, 1, level );
       }
-      glEnd();*/
       
       glPopAttrib();
    }
@@ -764,48 +1378,13 @@ namespace DDG
       glEnable( GL_POINT_SMOOTH );
       glColor3f( 1., 0., 0. );
       
-      glBegin( GL_POINTS );
-      for( VertexCIter v  = mesh.vertices.begin();
-          v != mesh.vertices.end();
-          v ++ )
-      {
-         if( v->isIsolated() )
-         {
-            if( render3D )
-            {
-               glVertex3dv( &v->position[0] );
-            }
-            else
-            {
-               glVertex3dv( &v->texture[0] );
-            }
-         }
-      }
-      glEnd();
+      surface.draw( MeshBuffer::points,
+                    render3D ? MeshBuffer::positionStream : MeshBuffer::textureStream,
+                    false, false );
       
       glPopAttrib();
    }
    
-   void Viewer::drawVertices( void )
-   {
-      for( VertexCIter v = mesh.vertices.begin();
-          v != mesh.vertices.end();
-          v ++ )
-      {
-         glLoadName(v->index);
-         glBegin(GL_POINTS);
-         if( render3D )
-         {
-            glVertex3dv( &v->position[0] );
-         }
-         else
-         {
-            glVertex3dv( &v->texture[0] );
-         }
-         glEnd();
-      }
-   }
-   
    void Viewer::drawSelectedVertices( void )
    {
       shader.disable();
@@ -815,137 +1394,121 @@ namespace DDG
       glEnable(GL_BLEND);
       glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-      for( std::list<int>::const_iterator it = mesh.taggedVertices.cbegin();
-          it != mesh.taggedVertices.cend();
-          it ++ )
+      markers.draw( markerShader );
+      highlights.draw( markerShader );
+
+      glPopAttrib();
+   }
+
+   static double markerRadius( const Vertex& v, bool render3D )
+   // returns half the length of the shortest edge around v
+   {
+      if( v.isIsolated() ) return 0.02;
+
+      double radius = 100;
+      HalfEdgeCIter he = v.he;
+      do
       {
-         const Vertex * v = &mesh.vertices[*it];
+         double len = render3D ?
+            ( he->vertex->position - he->flip->vertex->position ).norm() :
+            ( he->vertex->texture - he->flip->vertex->texture ).norm();
 
-         double radius = v->isIsolated() ? 0.02 : 100;
+         if ( radius > len ) radius = len;
+         he = he->flip->next;
+      } while ( he != v.he );
 
-         if ( not v->isIsolated() )
-         {
-            HalfEdgeIter he = v->he;
-            do
-            {
-               double len = render3D ? \
-                  ( he->vertex->position - he->flip->vertex->position ).norm() : \
-                  ( he->vertex->texture - he->flip->vertex->texture ).norm();
+      return 0.5 * radius;
+   }
 
-               if ( radius > len ) radius = len;
-               he = he->flip->next;
-            } while ( he != v->he );
+   static MarkerBuffer::Marker tagMarker( const Vertex& v, bool render3D )
+   // tagged vertices are colored by winding number (white if zero, red if
+   // positive, blue if negative)
+   {
+      MarkerBuffer::Marker m;
 
-            radius *= 0.5;
-         }
+      m.center = render3D ? v.position : v.texture;
+      m.radius = markerRadius( v, render3D );
+      m.color[0] = v.winding < 0 ? 0. : 1.;
+      m.color[1] = v.winding == 0 ? 1. : 0.;
+      m.color[2] = v.winding > 0 ? 0. : 1.;
+      m.color[3] = 0.5;
+      m.specular = 1.;
 
-         if ( v->winding == 0 )
-         {
-            GLfloat  diffuse[4] = { 1.0, 1.0, 1.0, 0.5 };
-            glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE,   diffuse  );
-         }
-         else if ( v->winding > 0 )
-         {
-            GLfloat  diffuse[4] = { 1.0, 0.0, 0.0, 0.5 };
-            glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE,   diffuse  );
-         }
-         else
-         {
-            GLfloat  diffuse[4] = { 0.0, 0.0, 1.0, 0.5 };
-            glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE,   diffuse  );
-         }
+      return m;
+   }
+
+   static MarkerBuffer::Marker highlightMarker( const Vertex& v, bool render3D )
+   // highlighted vertices are surrounded by a larger translucent sphere
+   // whose size grows with the winding number
+   {
+      MarkerBuffer::Marker m;
 
-         GLfloat specular[4] = { 1.0, 1.0, 1.0, 0.5 };
-         GLfloat  ambient[4] = { 0.0, 0.0, 0.0, 1.0 };
-         glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR,  specular );
-         glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT,   ambient  );
-         glMaterialf ( GL_FRONT_AND_BACK, GL_SHININESS, 16.      );
+      m.center = render3D ? v.position : v.texture;
+      m.radius = markerRadius( v, render3D );
+      m.radius *= v.winding == 0 ? 1.1 : 0.1 + abs( v.winding );
+      m.color[3] = 0.2;
+      m.specular = 0.;
 
-         const double * vecPtr = render3D ? &v->position[0] : &v->texture[0];
+      return m;
+   }
 
-         glMatrixMode( GL_MODELVIEW );
-         glPushMatrix();
-         glTranslatef( vecPtr[0], vecPtr[1], vecPtr[2] );
-         glutSolidSphere( radius, 16, 16 );
+   void Viewer :: updateMarkers( void )
+   {
+      markers.removeMarkers();
+      highlights.removeMarkers();
 
-         glPopMatrix();
+      for( std::list<int>::const_iterator it = mesh.taggedVertices.begin();
+          it != mesh.taggedVertices.end();
+          it ++ )
+      {
+         markers.setMarker( *it, tagMarker( mesh.vertices[*it], render3D ));
       }
 
-      for( std::list<int>::const_iterator it = mesh.hledVertices.cbegin();
-          it != mesh.hledVertices.cend();
+      for( std::list<int>::const_iterator it = mesh.hledVertices.begin();
+          it != mesh.hledVertices.end();
           it ++ )
       {
-         const Vertex * v = &mesh.vertices[*it];
+         highlights.setMarker( *it, highlightMarker( mesh.vertices[*it], render3D ));
+      }
 
-         double radius = v->isIsolated() ? 0.02 : 100;
+      // (everything is up to date)
+      mesh.clearVertexChanges();
+   }
 
-         if ( not v->isIsolated() )
+   void Viewer :: updateChangedMarkers( void )
+   {
+      const Mesh::VertexAttribute attributes[3] = {
+         Mesh::vertexTag, Mesh::vertexHighlight, Mesh::vertexWinding
+      };
+
+      // (the winding number changes the appearance of both markers, so all
+      // markers of a changed vertex are refreshed)
+      vector<int> changed;
+      for( int a = 0; a < 3; a++ )
+      {
+         mesh.takeVertexChanges( attributes[a], changed );
+         for( size_t i = 0; i < changed.size(); i++ )
          {
-            HalfEdgeIter he = v->he;
-            do
-            {
-               double len = render3D ? \
-                  ( he->vertex->position - he->flip->vertex->position ).norm() : \
-                  ( he->vertex->texture - he->flip->vertex->texture ).norm();
-
-               if ( radius > len ) radius = len;
-               he = he->flip->next;
-            } while ( he != v->he );
-
-            radius *= 0.5;
+            updateVertexMarkers( changed[i] );
          }
-
-         GLfloat  diffuseW[4] = { 1.0, 1.0, 1.0, 0.2 };
-         GLfloat specularW[4] = { 0.0, 0.0, 0.0, 0.2 };
-         glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE,   diffuseW  );
-         glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR,  specularW );
-         
-         const double * vecPtr = render3D ? &v->position[0] : &v->texture[0];
-
-         glMatrixMode( GL_MODELVIEW );
-         glPushMatrix();
-         glTranslatef( vecPtr[0], vecPtr[1], vecPtr[2] );
-         if ( v->winding == 0 )
-            glutSolidSphere( 1.1 * radius, 16, 16 );
-         else
-            glutSolidSphere( (0.1+abs(v->winding)) * radius, 16, 16 );
-
-         glPopMatrix();
       }
+   }
 
-      glDisable(GL_BLEND);
-
-      glPopAttrib();
-
-      /*shader.disable();
-      glPushAttrib( GL_ALL_ATTRIB_BITS );
+   void Viewer :: updateVertexMarkers( int index )
+   {
+      const Vertex& v( mesh.vertices[index] );
 
-      glEnable(GL_COLOR_MATERIAL);
-      glHint( GL_POINT_SMOOTH_HINT, GL_NICEST );
-      glEnable( GL_POINT_SMOOTH );
-      glColor3f( 0., 0., 0.5 );
-      glPointSize( 20 );
+      if( v.tag ) markers.setMarker( index, tagMarker( v, render3D ));
+      else        markers.removeMarker( index );
 
-      glBegin(GL_POINTS);
-      for( VertexCIter v = mesh.vertices.begin();
-          v != mesh.vertices.end();
-          v ++ )
+      if( find( mesh.hledVertices.begin(), mesh.hledVertices.end(), index ) != mesh.hledVertices.end() )
       {
-         if( v->tag ) 
-         {
-            if( render3D )
-            {
-               glVertex3dv( &v->position[0] );
-            }
-            else
-            {
-               glVertex3dv( &v->texture[0] );
-            }
-         }
+         highlights.setMarker( index, highlightMarker( v, render3D ));
+      }
+      else
+      {
+         highlights.removeMarker( index );
       }
-      glEnd();
-      
-      glPopAttrib();*/
    }
 
    int Viewer::getMouseVertexID(int x, int y)
@@ -955,51 +1518,24 @@ namespace DDG
       int width  = glutGet(GLUT_WINDOW_WIDTH );
       int height = glutGet(GLUT_WINDOW_HEIGHT);
       if( x < 0 || x >= width || y < 0 || y >= height ) return NOID;
-      
-      int bufSize = mesh.vertices.size();
-      GLuint* buf = new GLuint[bufSize];
-      glSelectBuffer(bufSize, buf);
-      
+
+      // (the matrices still hold the view used to draw the last frame)
       GLint viewport[4];
-      GLdouble projection[16];
+      GLdouble modelview[16], projection[16];
       glGetIntegerv( GL_VIEWPORT, viewport );
-      glGetDoublev(GL_PROJECTION_MATRIX, projection);
-      
-      glRenderMode(GL_SELECT);
-      glInitNames();
-      glPushName(0);
-      
-      glMatrixMode(GL_PROJECTION);
-      glPushMatrix();
-      glLoadIdentity();
-      gluPickMatrix(x, viewport[3]-y, 10, 10, viewport);
-      glMultMatrixd(projection);
-      
-      glMatrixMode(GL_MODELVIEW);
-      glPushMatrix();
-      drawVertices();
-      glPopMatrix();
-      
-      glMatrixMode(GL_PROJECTION);
-      glPopMatrix();
-      
-      glMatrixMode(GL_MODELVIEW);
-      long hits = glRenderMode(GL_RENDER);
-      
-      int index = NOID;
-      double min_z = 1.0e100;
-      for( long i = 0; i < hits; ++i )
-      {
-         double distance = buf[4*i + 1];
-         if( distance < min_z )
-         {
-            index = buf[4*i + 3];
-            min_z = distance;
-         }
-      }
-      delete[] buf;
+      glGetDoublev( GL_MODELVIEW_MATRIX, modelview );
+      glGetDoublev( GL_PROJECTION_MATRIX, projection );
+
+      picker.update( mesh, render3D ? MeshBVH::positionCoordinates : MeshBVH::textureCoordinates );
 
-      return index;
+      // accept vertices within five pixels of the cursor
+      const double pickRadius = 5.;
+      Vector origin, direction, origin2, direction2;
+      MeshBVH::pixelRay( x, viewport[3]-y, modelview, projection, viewport, origin, direction );
+      MeshBVH::pixelRay( x+pickRadius, viewport[3]-y, modelview, projection, viewport, origin2, direction2 );
+      double tolerance = cross( direction, direction2 ).norm() / dot( direction, direction2 );
+
+      return picker.pickVertex( origin, direction, tolerance );
    }
 
    void Viewer::pickVertex( int x, int y ) 
@@ -1008,8 +1544,8 @@ namespace DDG
 
       if (index >= 0)
       {
+         meshRevision++;
          mesh.toggleVertexTag( index );
-         updateDisplayList();
       }
    }
 
@@ -1019,31 +1555,31 @@ namespace DDG
 
       if (index >= 0)
       {
+         meshRevision++;
          mesh.toggleVertexHL( index );
-         updateDisplayList();
       }
    }
 
    void Viewer::mIncWinding( void )
    {
+      meshRevision++;
       for ( std::list<int>::const_iterator it = mesh.hledVertices.cbegin(); 
             it != mesh.hledVertices.cend(); it++ )
       {
          ++ mesh.vertices[*it].winding;
+         mesh.markVertexChanged( *it, Mesh::vertexWinding );
       }
-
-      updateDisplayList();
    }
 
    void Viewer::mDecWinding( void )
    {
+      meshRevision++;
       for ( std::list<int>::const_iterator it = mesh.hledVertices.cbegin(); 
             it != mesh.hledVertices.cend(); it++ )
       {
          -- mesh.vertices[*it].winding;
+         mesh.markVertexChanged( *it, Mesh::vertexWinding );
       }
-      
-      updateDisplayList();
    }
 }
 
@@ -1,22 +1,228 @@
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 using namespace std;
 
 #include "Viewer.h"
 #include "DenseMatrix.h"
+#include "LinearContext.h"
 using namespace DDG;
 
+namespace DDG
+{
+   extern LinearContext context;
+}
+
+static int parseMeshOption( int i, int argc, char** argv, Mesh& mesh )
+// if argv[i] is a mesh option, applies it and returns the number of
+// arguments it used; returns zero if argv[i] is not a mesh option, or
+// -1 if its value is missing or invalid
+{
+   if( string( argv[i] ) != "-reorder" ) return 0;
+   if( i+1 == argc ) return -1;
+
+   string value( argv[i+1] );
+        if( value == "file"   ) mesh.elementOrdering = Mesh::fileOrder;
+   else if( value == "rcm"    ) mesh.elementOrdering = Mesh::cuthillMcKeeOrder;
+   else if( value == "morton" ) mesh.elementOrdering = Mesh::mortonOrder;
+   else if( value == "nesdis" ) mesh.elementOrdering = Mesh::nestedDissectionOrder;
+   else return -1;
+
+   return 2;
+}
+
+static int parseRenderOption( int i, int argc, const char* const* argv, RenderJob& job )
+// if argv[i] is a rendering option, applies it to job and returns the number
+// of arguments it used; returns zero if argv[i] is not a rendering option, or
+// -1 if its value is missing or invalid
+{
+   string option( argv[i] );
+
+   // options without a value
+   if( option == "-wireframe" ) { job.wireframe   = true; return 1; }
+   if( option == "-field"     ) { job.vectorField = true; return 1; }
+   if( option == "-process"   ) { job.process     = true; return 1; }
+
+   // options with values
+   int n;
+        if( option == "-tag"    ) n = 1;
+   else if( option == "-view"   ) n = 1;
+   else if( option == "-color"  ) n = 1;
+   else if( option == "-zoom"   ) n = 1;
+   else if( option == "-size"   ) n = 2;
+   else if( option == "-rotate" ) n = 4;
+   else return 0;
+   if( i+n >= argc ) return -1;
+   string value( argv[i+1] );
+
+   if( option == "-tag" )
+   {
+      int index = atoi( argv[i+1] );
+      if( index < 0 ) return -1;
+      job.tags.push_back( index );
+   }
+   else if( option == "-view" )
+   {
+           if( value == "2d" ) job.render3D = false;
+      else if( value == "3d" ) job.render3D = true;
+      else return -1;
+   }
+   else if( option == "-color" )
+   {
+           if( value == "plain"     ) job.colors = RenderJob::plainColors;
+      else if( value == "qc"        ) job.colors = RenderJob::quasiConformalColors;
+      else if( value == "potential" ) job.colors = RenderJob::potentialColors;
+      else return -1;
+   }
+   else if( option == "-zoom" )
+   {
+      job.zoom = atof( argv[i+1] );
+   }
+   else if( option == "-size" )
+   {
+      job.width  = atoi( argv[i+1] );
+      job.height = atoi( argv[i+2] );
+      if( job.width <= 0 || job.height <= 0 ) return -1;
+   }
+   else // -rotate
+   {
+      Quaternion q( atof( argv[i+1] ), atof( argv[i+2] ),
+                    atof( argv[i+3] ), atof( argv[i+4] ));
+      if( q.norm() == 0. ) return -1;
+      job.rotation = q.unit();
+   }
+
+   return n+1;
+}
+
+static bool readBatch( const string& filename, const RenderJob& defaults, vector<RenderJob>& jobs )
+// reads a list of jobs, one per line, each of the form
+//    [rendering options] in.obj out.tga
+// where any options not given are taken from defaults; blank lines and
+// lines starting with '#' are ignored
+{
+   ifstream in( filename.c_str() );
+   if( !in.is_open() )
+   {
+      cerr << "Error: could not open file " << filename << " for input!" << endl;
+      return false;
+   }
+
+   string line;
+   int lineNumber = 0;
+   while( getline( in, line ))
+   {
+      lineNumber++;
+
+      vector<string> tokens;
+      stringstream ss( line );
+      string token;
+      while( ss >> token ) tokens.push_back( token );
+      if( tokens.empty() || tokens[0][0] == '#' ) continue;
+
+      vector<const char*> args;
+      for( size_t i = 0; i < tokens.size(); i++ )
+      {
+         args.push_back( tokens[i].c_str() );
+      }
+
+      RenderJob job = defaults;
+      int argc = args.size();
+      int k = 0;
+      while( k < argc-2 )
+      {
+         int n = parseRenderOption( k, argc, &args[0], job );
+         if( n <= 0 ) break;
+         k += n;
+      }
+
+      if( k != argc-2 )
+      {
+         cerr << "Error: could not parse " << filename << ", line " << lineNumber << endl;
+         return false;
+      }
+
+      job.input  = args[k];
+      job.output = args[k+1];
+      jobs.push_back( job );
+   }
+
+   return true;
+}
+
 int main( int argc, char** argv )
 {
-   if( argc != 2 )
+   Viewer viewer;
+   RenderJob job;
+   string renderOutput, batchFile;
+   int nWorkers = 1;
+   bool software = false;
+
+   int k = 1;
+   while( k < argc )
    {
-      cerr << "usage: " << argv[0] << " in.obj" << endl;
+      string option( argv[k] );
+      int n = context.parseOption( k, argc, argv );
+      if( n == 0 ) n = parseMeshOption( k, argc, argv, viewer.mesh );
+      if( n == 0 ) n = parseRenderOption( k, argc, argv, job );
+      if( n == 0 && k+1 < argc )
+      {
+              if( option == "-render" ) { renderOutput = argv[k+1]; n = 2; }
+         else if( option == "-batch"  ) { batchFile    = argv[k+1]; n = 2; }
+         else if( option == "-jobs"   ) { nWorkers = atoi( argv[k+1] ); n = nWorkers > 0 ? 2 : -1; }
+      }
+      if( n == 0 && option == "-software" ) { software = true; n = 1; }
+      if( n <= 0 ) break;
+      k += n;
+   }
+
+   // a batch file names its own meshes; otherwise the last argument is the mesh
+   int nArgs = batchFile.empty() ? 1 : 0;
+   if( k != argc-nArgs || ( !batchFile.empty() && !renderOutput.empty() ))
+   {
+      cerr << "usage: " << argv[0] << " [options] in.obj" << endl;
+      cerr << "       " << argv[0] << " [options] -render out.tga in.obj" << endl;
+      cerr << "       " << argv[0] << " [options] -batch jobs.txt" << endl;
+      cerr << "mesh options:" << endl;
+      cerr << "   -reorder file|rcm|morton|nesdis              element ordering (default: file)" << endl;
+      cerr << "rendering options (without a window):" << endl;
+      cerr << "   -render out.tga                              render in.obj to an image" << endl;
+      cerr << "   -batch jobs.txt                              render each line \"[options] in.obj out.tga\"" << endl;
+      cerr << "   -jobs n                                      number of worker processes for -batch" << endl;
+      cerr << "   -software                                    draw on the CPU even if OpenGL is available" << endl;
+      cerr << "   -process                                     run Process Mesh before rendering (flattens a" << endl;
+      cerr << "                                                mesh with boundary; a closed mesh needs -tag)" << endl;
+      cerr << "   -tag i                                       tag vertex i of in.obj (from 0) for -process" << endl;
+      cerr << "   -view 2d|3d                                  show the flattening or the surface" << endl;
+      cerr << "   -color plain|qc|potential                    surface colors" << endl;
+      cerr << "   -wireframe                                   draw edges" << endl;
+      cerr << "   -field                                       draw the vector field" << endl;
+      cerr << "   -size w h                                    image size (default: 512 512)" << endl;
+      cerr << "   -rotate w x y z                              camera rotation (a quaternion)" << endl;
+      cerr << "   -zoom z                                      camera zoom" << endl;
+      cerr << LinearContext::usage();
       return 1;
    }
 
-   Viewer viewer;
-   viewer.mesh.read( argv[1] );
+   if( !batchFile.empty() )
+   {
+      vector<RenderJob> jobs;
+      if( !readBatch( batchFile, job, jobs )) return 1;
+      return Viewer::renderOffscreen( jobs, nWorkers, software ) ? 0 : 1;
+   }
+
+   if( !renderOutput.empty() )
+   {
+      job.input  = argv[k];
+      job.output = renderOutput;
+      return Viewer::renderOffscreen( vector<RenderJob>( 1, job ), 1, software ) ? 0 : 1;
+   }
+
+   viewer.mesh.read( argv[k] );
    viewer.init();
 
    return 0;
 }
-
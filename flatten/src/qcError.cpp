@@ -89,6 +89,16 @@ namespace DDG
       return HSV( (2.0-4.0*(qc-1.0))/3.0, .7, 0.65 );
    }
 
+   Vector potentialColor( double s )
+   // color map for values in [0,1], from blue (0) to red (1)
+   {
+      // clamp to range [0,1]
+      s = max( 0., min( 1., s ));
+
+      // compute color
+      return HSV( (1.0-s)*2.0/3.0, .7, 0.65 );
+   }
+
    double quasiConformalDistortion( Vector p1, Vector p2, Vector p3,
                                     Vector q1, Vector q2, Vector q3 )
    // computes the quasi-conformal distortion in a triangle with